@@ -3,357 +3,824 @@
 // ----------------------------------------------------
 
 #include <SoftwareSerial.h>
+#include <avr/sleep.h>
+#include "device_registry.h"
+#include "command_table.h"
+#include "ntc_table.h"
+#include "status_frame.h"
+#include "spsc_ring.h"
+#include "serial_log.h"
+#include "http_request_parser.h"
+#include "centi_celsius.h"
 
 // --- Wi-Fi Configuration ---
 // !! CHANGE THESE TO YOUR NETWORK DETAILS !!
-const char* WIFI_SSID = "WE8B19F7";
-const char* WIFI_PASSWORD = "F707F21F";
+const char WIFI_SSID[] PROGMEM = "WE8B19F7";
+const char WIFI_PASSWORD[] PROGMEM = "F707F21F";
 const int SERVER_PORT = 80;
 
+// Uncomment to time the status serializer against the old String version at boot
+// #define BENCHMARK_STATUS_SERIALIZER
+// Uncomment to time the fixed-point temperature routines against float at boot
+// #define BENCHMARK_TEMPERATURE
+
 // ESP8266 Connection (Using SoftwareSerial on D10/D11)
 const int WIFI_RX_PIN = 10; // Connects to the ESP8266 TX pin
 const int WIFI_TX_PIN = 11; // Connects to the ESP8266 RX pin
 SoftwareSerial esp8266(WIFI_RX_PIN, WIFI_TX_PIN);
 const long ESP_BAUD_RATE = 74880;
 
-// --- Actuator/Sensor Pin Definitions ---
-const int LAMP_RELAY_PIN = 7;
-const int PLUG_RELAY_PIN = 6;
-const int DOOR_SENSOR_PIN = 2;
-const int BUZZER_PIN = 8;
+// --- Devices ---
+// The status reply lists the devices in table order, and every relay or
+// alarm row gets /<NAME>_ON, /<NAME>_OFF and /<NAME>_TOGGLE (see
+// device_registry.h)
+enum DeviceId : uint8_t {
+    DEVICE_TEMP,
+    DEVICE_DOOR,
+    DEVICE_LAMP,
+    DEVICE_PLUG,
+    DEVICE_ALARM,
+    DEVICE_COUNT
+};
+
+constexpr DeviceSpec DEVICE_SPECS[DEVICE_COUNT] = {
+    // name    pin  kind                activeLow  on       off
+    { "TEMP",  A0, KIND_ANALOG_SENSOR, false,     NULL,    NULL     },  // NTC voltage divider output
+    { "DOOR",  2,  KIND_BINARY_SENSOR, true,      "OPEN",  "CLOSED" },  // INT0
+    { "LAMP",  7,  KIND_RELAY,         true,      "ON",    "OFF"    },  // Physical switch in series creates XOR
+    { "PLUG",  6,  KIND_RELAY,         true,      "ON",    "OFF"    },
+    { "ALARM", 8,  KIND_ALARM,         false,     "ALARM", "SAFE"   },  // Buzzer
+};
+
+typedef DeviceNameIndex<DEVICE_SPECS, DEVICE_COUNT> DeviceIndex;
+const DeviceTable DEVICES = { DEVICE_SPECS, DEVICE_COUNT, DeviceIndex::slots, DeviceIndex::BITS, DeviceIndex::SEED };
+
+static_assert(deviceCountOfKind(DEVICE_SPECS, DEVICE_COUNT, KIND_ANALOG_SENSOR) == 1, "TEMP is the only analog device");
+static_assert(deviceNamesFit(DEVICE_SPECS, DEVICE_COUNT, BATCH_ENTRY_BUFFER_SIZE), "A device name is too long for its commands");
+// The app decodes the v1 frame flags with these bits
+static_assert(deviceFrameBit(DEVICE_SPECS, DEVICE_DOOR) == 0 && deviceFrameBit(DEVICE_SPECS, DEVICE_LAMP) == 1
+              && deviceFrameBit(DEVICE_SPECS, DEVICE_PLUG) == 2 && deviceFrameBit(DEVICE_SPECS, DEVICE_ALARM) == 3,
+              "Frame flag order changed");
 
 // --- NTC Thermistor Configuration ---
-const int NTC_PIN = A0; // Analog pin connected to the NTC voltage divider output
-const float NOMINAL_RESISTANCE = 100000; // 100k Ohms
-const float NOMINAL_TEMPERATURE = 25;    // 25C 
-const int BETA_COEFFICIENT = 3950;       // B-value for 100k NTC
-const float REFERENCE_RESISTANCE = 100000; // Fixed 100k Ohm resistor in the voltage divider
-const int ADC_RESOLUTION = 1024;
+constexpr uint8_t NTC_PIN = DEVICE_SPECS[DEVICE_TEMP].pin;
+constexpr float NOMINAL_RESISTANCE = 100000; // 100k Ohms
+constexpr float NOMINAL_TEMPERATURE = 25;    // 25C 
+constexpr int BETA_COEFFICIENT = 3950;       // B-value for 100k NTC
+constexpr float REFERENCE_RESISTANCE = 100000; // Fixed 100k Ohm resistor in the voltage divider
+constexpr int ADC_RESOLUTION = 1024;
+
+// --- Compile-time NTC Lookup Table (ntc_table.h) ---
+// 5V --- [NTC] --- A0 --- [100k Fixed Resistor] --- GND
+struct NtcThermistor {
+    // -B: the same sign convention as the original float code
+    static constexpr int16_t centiCelsiusAt(int adc) {
+        return ntcBetaCentiCelsius(ntcResistanceToSupply(adc, ADC_RESOLUTION, REFERENCE_RESISTANCE, NOMINAL_RESISTANCE),
+                                   NOMINAL_RESISTANCE, NOMINAL_TEMPERATURE, -BETA_COEFFICIENT);
+    }
+};
+
+typedef NtcLookupTable<NtcThermistor, MakeIndexList<ADC_RESOLUTION>::type> NtcTable;  // 2 KB of flash, no RAM
 
 // Alarm Settings (now settable from App)
-float alarmTempThreshold = 27.0;
+CentiCelsius alarmThresholdCenti = 2700;
 
 // --- State Variables ---
-// Lamp: App toggles relay, physical switch in series creates XOR effect
-bool lampRelayState = false;   // Current relay state (controlled by app)
-bool plugState = false;
-bool buzzerAppOverride = false; // App can override buzzer
-bool previousDoorState = true; // HIGH=CLOSED, LOW=OPEN
-String currentCommand = "";
+DeviceBits<DEVICE_COUNT> devicesCommanded = {};  // Outputs as set by the app (ALARM: the override)
+DeviceBits<DEVICE_COUNT> devicesOn = {};         // Output pins and debounced binary inputs
+uint32_t stateVersion = 0;     // Bumped whenever a status field changes
+StatusFrame reportedStatus;    // Status behind stateVersion
+
+// --- Door Sensor Interrupt ---
+// onDoorEdge() (INT0 on pin 2) timestamps reed switch edges. The first edge
+// after a quiet period is queued at once; edges within DOOR_DEBOUNCE_US of
+// it are contact bounce and only update doorLastEdgeUs. loop() drains the
+// queue on every pass, and once the line has been quiet for the debounce
+// time it reads the pin once, which catches a pulse that ended inside the
+// window.
+constexpr uint8_t DOOR_SENSOR_PIN = DEVICE_SPECS[DEVICE_DOOR].pin;
+const uint32_t DOOR_DEBOUNCE_US = 20000;
+const uint8_t DOOR_EVENT_RING_SIZE = 8;
+
+struct DoorEvent {
+    uint32_t atUs;   // micros() at the edge
+    bool level;      // Pin level after the edge (DEVICE_SPECS[DEVICE_DOOR] maps it to OPEN/CLOSED)
+};
+
+SpscRing<DoorEvent, DOOR_EVENT_RING_SIZE> doorEvents;  // ISR -> loop()
+volatile uint32_t doorLastEdgeUs = 0;   // Every edge, bounce included
+uint32_t doorAcceptedEdgeUs = 0;        // ISR only: start of the debounce window
+
+bool doorLevel = HIGH;                  // Debounced level, loop() only
+uint32_t doorSettledEdgeUs = 0;         // Last edge the settled level was checked for
+
+// Explicit prototype: the IDE's generated ones would precede DoorEvent
+void recordDoorEvent(const DoorEvent& event);
 
 // Variables for managing status updates
 unsigned long lastStatusUpdateTime = 0;
+unsigned long lastSensorUpdateTime = 0;
 const unsigned long STATUS_REPORT_INTERVAL_MS = 5000; // Report status every 5 seconds
+const unsigned long SENSOR_INTERVAL_MS = 500;         // Sensing/alarm period (was delay(500))
+constexpr size_t STATUS_BUFFER_SIZE = deviceStatusLength(DEVICE_SPECS, DEVICE_COUNT)
+                                   + sizeof(",THRESHOLD:") + DEVICE_ANALOG_TEXT_SIZE;
+const size_t HTTP_HEADER_BUFFER_SIZE = 128;
+
+// --- Serial Log ---
+// LOG_* lines (serial_log.h) are printed at once during setup(); after that
+// they are queued here and loop() hands HardwareSerial only what fits in its
+// 64-byte transmit buffer, so a status report never stalls the ESP8266 pump
+// for the ~100 ms it takes at 9600 baud. Lines that find the queue full are
+// dropped and counted in the [POWER] report.
+const uint16_t SERIAL_LOG_SIZE = 256;   // One status report (two lines) plus a command or two
+
+SerialLog<SERIAL_LOG_SIZE> serialLog;
+
+// --- Idle Sleep ---
+// Every loop() pass ends in SLEEP_MODE_IDLE: the CPU clock stops until the
+// next interrupt (Timer0's millis() tick every 1.024 ms, an ESP8266 byte on
+// the SoftwareSerial pin change, the door on INT0) while timers and the
+// UART keep running, so nothing else changes. Passes are timed for the
+// duty cycle in the status report.
+uint32_t awakeUs = 0;            // Time spent in loop() passes; wraps, read differences
+uint32_t reportedAwakeUs = 0;    // awakeUs and micros() at the last status report
+uint32_t reportedAtUs = 0;
+uint32_t worstDoorWakeUs = 0;    // Door edge -> handled by loop()
+
+// --- ESP8266 AT Transport ---
+// pumpEsp8266() parses the ESP8266 output byte by byte: result lines (OK,
+// ERROR, SEND OK...) and the '>' prompt are recorded as they arrive, and
+// +IPD payloads go to the request handler. Replies are sent by a small state
+// machine advanced from loop(), so nothing waits out a fixed timeout.
+enum AtResult : uint8_t { AT_NONE, AT_OK, AT_ERROR, AT_PROMPT, AT_SEND_OK, AT_SEND_FAIL };
+enum TxState : uint8_t { TX_IDLE, TX_WAIT_PROMPT, TX_WAIT_SEND_OK, TX_WAIT_CLOSE };
+
+const uint8_t MAX_ESP_CONNECTIONS = 5;          // CIPMUX=1 link ids 0-4
+const unsigned long TX_STEP_TIMEOUT_MS = 2000;  // Give up on a reply step after this
+const size_t AT_LINE_BUFFER_SIZE = 32;
+
+char atLine[AT_LINE_BUFFER_SIZE];
+uint8_t atLineLength = 0;
+AtResult atResult = AT_NONE;     // Latest result for the AT command in flight
+bool atEchoToSerial = false;     // Mirror ESP output to the monitor (setup only)
+
+int ipdConnection = -1;          // Link id of the +IPD payload being read
+int ipdRemaining = 0;            // Payload bytes left in that frame
+
+bool replyPending[MAX_ESP_CONNECTIONS];
+bool replyAsFrame[MAX_ESP_CONNECTIONS];   // Requested /STATUS.bin
+TxState txState = TX_IDLE;
+int txConnection = -1;
+unsigned long txStepStartedAt = 0;
+char txStatus[STATUS_BUFFER_SIZE];
+size_t txStatusLength = 0;
+bool txAsFrame = false;
+
+// --- HTTP Request Parsing ---
+// +IPD payload bytes are fed to the parser one at a time; each request line
+// it completes goes to handleWiFiCommand() (http_request_parser.h)
+const uint8_t REQUEST_LINE_BUFFER_SIZE = 96;  // Room for a /BATCH of ~5 commands
+
+HttpRequestParser<MAX_ESP_CONNECTIONS, REQUEST_LINE_BUFFER_SIZE> requestParser;
+
+// Explicit prototype: the IDE's generated ones would precede the TxState enum
+void advanceTx(TxState next);
 
 
 void setup() {
     Serial.begin(9600);    // Hardware Serial for debugging
     esp8266.begin(ESP_BAUD_RATE); // Software Serial for ESP8266
 
-    // Initialize Actuator Pins and set them OFF (HIGH for Active LOW relays)
-    pinMode(LAMP_RELAY_PIN, OUTPUT);
-    pinMode(PLUG_RELAY_PIN, OUTPUT);
-    pinMode(BUZZER_PIN, OUTPUT);
-    digitalWrite(LAMP_RELAY_PIN, LOW);
-    digitalWrite(PLUG_RELAY_PIN, HIGH);
-    digitalWrite(BUZZER_PIN, LOW);
+    // Outputs start OFF (HIGH for Active LOW relays), binary sensors get the pull-up
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (deviceIsOutput(spec)) {
+            pinMode(spec.pin, OUTPUT);
+            digitalWrite(spec.pin, deviceLevel(spec, false));
+        } else if (spec.kind == KIND_BINARY_SENSOR) {
+            pinMode(spec.pin, INPUT_PULLUP);
+        }
+    }
 
-    // Initialize Sensor Pins
-    pinMode(DOOR_SENSOR_PIN, INPUT_PULLUP);
-    previousDoorState = digitalRead(DOOR_SENSOR_PIN);
+    doorLevel = digitalRead(DOOR_SENSOR_PIN);
+    devicesOn.set(DEVICE_DOOR, deviceOnAtLevel(DEVICE_SPECS[DEVICE_DOOR], doorLevel));
+    attachInterrupt(digitalPinToInterrupt(DOOR_SENSOR_PIN), onDoorEdge, CHANGE);
 
-    Serial.println("Smart Home Prototype Initializing Wi-Fi and NTC...");
+    LOG_INFO(F("Smart Home Prototype Initializing Wi-Fi and NTC..."));
 
     // Connect to Wi-Fi and start server
     connectToWiFi();
+#ifdef BENCHMARK_STATUS_SERIALIZER
+    benchmarkStatusSerializer();
+#endif
+#ifdef BENCHMARK_TEMPERATURE
+    benchmarkTemperature();
+#endif
+    serialLog.blocking = false;
 }
 
 void loop() {
-    // 1. Handle incoming Wi-Fi commands (Actuator Control)
-    if (esp8266.available()) {
-        if (esp8266.find("+IPD,")) {
-            delay(50);
-            int connectionId = esp8266.read() - '0';
-            Serial.print("\n> COMMAND RECEIVED on CID: ");
-            Serial.println(connectionId);
-            readWiFiCommand(connectionId);
-        }
+    uint32_t passStartUs = micros();
+    loopPass();
+    serialLog.drain();
+    awakeUs += micros() - passStartUs;
+
+    idleUntilInterrupt();
+}
+
+void loopPass() {
+    // 1. Service the ESP8266: parse incoming bytes, then advance any pending reply
+    pumpEsp8266();
+    serviceEspTransport();
+
+    // 2. Door Status Change Alert: every edge queued by the interrupt
+    serviceDoorEvents();
+
+    // Sensing runs on a fixed interval instead of delay(), so serial data
+    // from the ESP8266 is drained on every pass
+    if (millis() - lastSensorUpdateTime < SENSOR_INTERVAL_MS) {
+        return;
     }
+    lastSensorUpdateTime = millis();
 
-    // 2. Read Sensors
-    float currentTemp = readNTC();
-    bool currentDoorState = digitalRead(DOOR_SENSOR_PIN);
-    
-    // 3. Lamp control is handled by commands - relay state + physical switch in series = XOR
+    // 3. Read Sensors
+    CentiCelsius currentTemp = readNTC();
+    pollBinarySensors();
+
+    // Lamp control is handled by commands - relay state + physical switch in series = XOR
     // No need to read switch, XOR happens in hardware
 
-    // 4. Temperature Alarm Logic (using settable threshold)
-    bool shouldAlarm = currentTemp > alarmTempThreshold;
-    if (shouldAlarm || buzzerAppOverride) {
-        digitalWrite(BUZZER_PIN, HIGH); // Physical Alarm ON
-        if (digitalRead(BUZZER_PIN) == HIGH) {
-            Serial.println(">>> HIGH TEMP ALARM ACTIVE! Buzzer ON.");
+    // 4. Temperature Alarm Logic (using settable threshold), for every alarm output
+    bool overTemp = currentTemp > alarmThresholdCenti;
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (spec.kind != KIND_ALARM) {
+            continue;
         }
-    }
-    else {
-        digitalWrite(BUZZER_PIN, LOW); // Physical Alarm OFF
-    }
 
-    // 5. Door Status Change Alert (Immediate Report to monitor)
-    if (currentDoorState != previousDoorState) {
-        Serial.print(">>> DOOR STATUS CHANGE: ");
-        Serial.println((currentDoorState == LOW) ? "CLOSED" : "OPENED");
-        previousDoorState = currentDoorState;
-        delay(200);
+        bool shouldAlarm = overTemp || devicesCommanded.get(i);
+        digitalWrite(spec.pin, deviceLevel(spec, shouldAlarm));
+        devicesOn.set(i, shouldAlarm);
+        if (shouldAlarm) {
+            LOG_WARN(F(">>> HIGH TEMP ALARM ACTIVE! "), spec.name, F(" ON."));
+        }
     }
 
-    // 6. Periodic Status Reporting (for monitor and app polling reference)
+    // 5. Periodic Status Reporting (for monitor and app polling reference)
     if (millis() - lastStatusUpdateTime >= STATUS_REPORT_INTERVAL_MS) {
-        Serial.print("STATUS UPDATE: ");
-        Serial.print(currentTemp, 2);
-        Serial.print(" C. Door: ");
-        Serial.print((currentDoorState == LOW) ? "CLOSED" : "OPENED");
-        Serial.print(" | Threshold: ");
-        Serial.print(alarmTempThreshold, 1);
-        Serial.println(" C");
+        LOG_INFO(F("STATUS UPDATE: "), logFixed(currentTemp, 2),
+                 F(" C. Door: "), deviceStateText(DEVICE_SPECS[DEVICE_DOOR], devicesOn.get(DEVICE_DOOR)),
+                 F(" | Threshold: "), logFixed(centiCelsiusScaled(alarmThresholdCenti, 1), 1), F(" C"));
+
+        // Hundredths of a percent; the divisor loses under 0.1% over a report interval
+        uint32_t nowUs = micros();
+        uint32_t elapsedPer10k = (nowUs - reportedAtUs) / 10000;
+        LOG_INFO(F("[POWER] Awake: "), logFixed(elapsedPer10k ? (awakeUs - reportedAwakeUs) / elapsedPer10k : 0, 2),
+                 F("%, worst door wake: "), worstDoorWakeUs, F(" us, log lines dropped: "), serialLog.dropped);
+        reportedAwakeUs = awakeUs;
+        reportedAtUs = nowUs;
 
         lastStatusUpdateTime = millis();
     }
+}
 
-    delay(500); // Reduced delay for more responsive XOR control
+// Sleeps until the next interrupt, unless one already left work for loop().
+// Interrupts stay off from the check to the SLEEP instruction (SEI takes
+// effect one instruction late), so an edge cannot slip in between.
+void idleUntilInterrupt() {
+    if (esp8266.available() > 0) {
+        return;
+    }
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    noInterrupts();
+    if (!doorEvents.empty()) {
+        interrupts();
+        return;
+    }
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
 }
 
-// --- NTC Thermistor Function ---
+// --- Door Sensor Functions ---
 
-float readNTC() {
-    // 1. Read the raw ADC value
-    int adc_reading = analogRead(NTC_PIN);
+void onDoorEdge() {
+    uint32_t nowUs = micros();
+    doorLastEdgeUs = nowUs;
+    if (nowUs - doorAcceptedEdgeUs < DOOR_DEBOUNCE_US) {
+        return;  // Contact bounce
+    }
+
+    doorAcceptedEdgeUs = nowUs;
+    DoorEvent event = { nowUs, (bool)digitalRead(DOOR_SENSOR_PIN) };
+    doorEvents.push(event);
+}
 
-    // 2. Convert ADC reading to Resistance (R_thermistor)
-    // R_thermistor = R_ref * (V_supply / V_out - 1)
-    float resistance;
-    if (adc_reading == 0) {
-        resistance = NOMINAL_RESISTANCE; // Avoid division by zero
+// Applies queued edges, then checks the settled level once per quiet period
+// instead of polling the pin
+void serviceDoorEvents() {
+    DoorEvent event;
+    while (doorEvents.pop(event)) {
+        uint32_t wakeUs = micros() - event.atUs;
+        if (wakeUs > worstDoorWakeUs) {
+            worstDoorWakeUs = wakeUs;
+        }
+        recordDoorEvent(event);
     }
-    else {
-        resistance = REFERENCE_RESISTANCE * ((float)ADC_RESOLUTION / adc_reading - 1.0);
+
+    // A 32-bit read is not atomic on AVR; the ISR may be mid-write
+    noInterrupts();
+    uint32_t lastEdgeUs = doorLastEdgeUs;
+    interrupts();
+
+    if (lastEdgeUs != doorSettledEdgeUs && micros() - lastEdgeUs >= DOOR_DEBOUNCE_US) {
+        doorSettledEdgeUs = lastEdgeUs;
+        DoorEvent settled = { lastEdgeUs, (bool)digitalRead(DOOR_SENSOR_PIN) };
+        recordDoorEvent(settled);
     }
+}
 
-    // 3. Apply Steinhart-Hart Equation (Simplified Beta Model)
-    float temp_kelvin = NOMINAL_TEMPERATURE + 273.15;
+void recordDoorEvent(const DoorEvent& event) {
+    if (event.level == doorLevel) {
+        return;  // Bounce that ended where it started
+    }
 
-    float log_resistance_ratio = -log(resistance / NOMINAL_RESISTANCE);
+    bool opened = deviceOnAtLevel(DEVICE_SPECS[DEVICE_DOOR], event.level);
+    doorLevel = event.level;
+    devicesOn.set(DEVICE_DOOR, opened);
+    LOG_INFO(F(">>> DOOR STATUS CHANGE: "), deviceStateText(DEVICE_SPECS[DEVICE_DOOR], opened), F(" at "), event.atUs, F(" us"));
+}
 
-    float one_over_T = (1.0 / temp_kelvin) + (1.0 / BETA_COEFFICIENT) * log_resistance_ratio;
 
-    float temp_K = 1.0 / one_over_T;
+// --- NTC Thermistor Function ---
 
-    // 4. Convert to Celsius
-    float temp_C = temp_K - 273.15;
+CentiCelsius readNTC() {
+    // 1. Read the raw ADC value
+    int adc_reading = analogRead(NTC_PIN);
 
-    return temp_C;
+    // 2. Look up the precomputed temperature (centi-degrees) from flash
+    return (CentiCelsius)pgm_read_word(&NtcTable::centiC[adc_reading]);
 }
 
 
-// --- Wi-Fi Communication Functions (Mostly Unchanged) ---
+// --- Wi-Fi Communication Functions ---
 
-void sendCommand(String command, const int timeout) {
+// Sends an AT command and returns as soon as the ESP8266 answers OK or
+// ERROR, or when the timeout expires. Blocking, so only used from setup().
+bool sendCommand(const __FlashStringHelper* command, const unsigned long timeout) {
+    atResult = AT_NONE;
     esp8266.print(command);
-    long startTime = millis();
+    return awaitCommand(timeout);
+}
 
-    while (millis() - startTime < timeout) {
-        while (esp8266.available()) {
-            Serial.write(esp8266.read());
-        }
+// Echoes the ESP8266's output until it answers OK or ERROR to the command
+// just written, or the timeout expires
+bool awaitCommand(const unsigned long timeout) {
+    atEchoToSerial = true;
+    unsigned long startTime = millis();
+    while (millis() - startTime < timeout && atResult != AT_OK && atResult != AT_ERROR) {
+        pumpEsp8266();
     }
+
+    atEchoToSerial = false;
+    return atResult == AT_OK;
 }
 
 void connectToWiFi() {
     // First, test basic AT communication
-    Serial.println("Testing ESP8266 communication...");
-    Serial.println("Sending AT command (should respond with OK):");
-    sendCommand("AT\r\n", 2000);
-    Serial.println("\n---");
+    LOG_INFO(F("Testing ESP8266 communication..."));
+    LOG_INFO(F("Sending AT command (should respond with OK):"));
+    sendCommand(F("AT\r\n"), 2000);
+    LOG_INFO(F("\n---"));
     
-    sendCommand("AT+CWMODE=3\r\n", 2000);
+    sendCommand(F("AT+CWMODE=3\r\n"), 2000);
     delay(1000);
 
-    String cmd = "AT+CWJAP=\"";
-    cmd += WIFI_SSID;
-    cmd += "\",\"";
-    cmd += WIFI_PASSWORD;
-    cmd += "\"\r\n";
-    Serial.print("Connecting to Wi-Fi...");
-    sendCommand(cmd, 10000);
-    Serial.println("...Done!");
-
-    // Get and display IP Address
-    Serial.println("\n=== IMPORTANT: ARDUINO IP ADDRESS ===");
+    // Written in pieces straight from flash, without a String on the heap
+    LOG_PART(LOG_LEVEL_INFO, F("Connecting to Wi-Fi..."));
+    atResult = AT_NONE;
+    esp8266.print(F("AT+CWJAP=\""));
+    esp8266.print((const __FlashStringHelper*)WIFI_SSID);
+    esp8266.print(F("\",\""));
+    esp8266.print((const __FlashStringHelper*)WIFI_PASSWORD);
+    esp8266.print(F("\"\r\n"));
+    awaitCommand(10000);
+    LOG_INFO(F("...Done!"));
+
+    // Get and display IP Address (printed by handleAtLine() as it arrives)
+    LOG_INFO(F("\n=== IMPORTANT: ARDUINO IP ADDRESS ==="));
+    sendCommand(F("AT+CIFSR\r\n"), 3000);
+    LOG_INFO(F("\n======================================"));
+    LOG_INFO(F("If no IP shown above, check ESP8266 connection"));
     
-    // Clear any pending data first
+    sendCommand(F("AT+CIPMUX=1\r\n"), 1000);
+
+    atResult = AT_NONE;
+    esp8266.print(F("AT+CIPSERVER=1,"));
+    esp8266.print(SERVER_PORT);
+    esp8266.print(F("\r\n"));
+    awaitCommand(1000);
+
+    LOG_INFO(F("Wi-Fi Server Started!"));
+}
+
+// Reads every byte the ESP8266 has sent so far. Never blocks.
+void pumpEsp8266() {
     while (esp8266.available()) {
-        esp8266.read();
-    }
-    
-    // Send AT+CIFSR command
-    esp8266.print("AT+CIFSR\r\n");
-    
-    // Wait and collect response with timeout
-    String ipResponse = "";
-    unsigned long startTime = millis();
-    while (millis() - startTime < 3000) { // 3 second timeout
-        while (esp8266.available()) {
-            char c = esp8266.read();
-            ipResponse += c;
-            Serial.write(c); // Echo each character to debug
+        char c = esp8266.read();
+        if (atEchoToSerial) {
+            Serial.write(c);
+        }
+
+        // Inside a +IPD frame the next ipdRemaining bytes are request payload
+        if (ipdRemaining > 0) {
+            ipdRemaining--;
+            requestParser.feed(ipdConnection, c, handleWiFiCommand);
+            continue;
+        }
+
+        if (c == '\n') {
+            atLine[atLineLength] = '\0';
+            handleAtLine();
+            atLineLength = 0;
+            continue;
+        }
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '>' && atLineLength == 0) {
+            atResult = AT_PROMPT;  // CIPSEND is ready for data
+            continue;
+        }
+        if (atLineLength < AT_LINE_BUFFER_SIZE - 1) {
+            atLine[atLineLength++] = c;
+        }
+
+        // "+IPD,<id>,<len>:" has no line ending; the payload follows the colon
+        if (c == ':' && atLineLength > 5 && strncmp_P(atLine, PSTR("+IPD,"), 5) == 0) {
+            atLine[atLineLength] = '\0';
+            beginIpdFrame();
+            atLineLength = 0;
         }
-        delay(10);
     }
-    
-    Serial.println(""); // New line after raw output
-    
-    // Try to parse the IP address from response
-    int staipStart = ipResponse.indexOf("STAIP,\"");
-    if (staipStart != -1) {
-        int ipStart = staipStart + 7;
-        int ipEnd = ipResponse.indexOf("\"", ipStart);
-        if (ipEnd != -1) {
-            String ipAddress = ipResponse.substring(ipStart, ipEnd);
-            Serial.print("\n>>> YOUR IP ADDRESS: ");
-            Serial.println(ipAddress);
+}
+
+void beginIpdFrame() {
+    const char* lengthField = strchr(atLine + 5, ',');
+    if (lengthField == NULL) {
+        return;
+    }
+
+    ipdConnection = atoi(atLine + 5);
+    ipdRemaining = atoi(lengthField + 1);
+}
+
+// Classifies one complete line of ESP8266 output
+void handleAtLine() {
+    if (strcmp_P(atLine, PSTR("OK")) == 0) {
+        atResult = AT_OK;
+    }
+    else if (strcmp_P(atLine, PSTR("ERROR")) == 0 || strcmp_P(atLine, PSTR("FAIL")) == 0) {
+        atResult = AT_ERROR;
+    }
+    else if (strcmp_P(atLine, PSTR("SEND OK")) == 0) {
+        atResult = AT_SEND_OK;
+    }
+    else if (strcmp_P(atLine, PSTR("SEND FAIL")) == 0) {
+        atResult = AT_SEND_FAIL;
+    }
+    else if (atLineLength == 8 && strcmp_P(atLine + 1, PSTR(",CLOSED")) == 0) {
+        // Client hung up; drop its reply unless it is already being sent
+        int id = atLine[0] - '0';
+        if (id >= 0 && id < MAX_ESP_CONNECTIONS) {
+            requestParser.close(id);
+            if (id != txConnection) {
+                replyPending[id] = false;
+            }
         }
     }
-    
-    // Also try alternative format (some ESP firmware uses different format)
-    int altStart = ipResponse.indexOf("+CIFSR:STAIP,\"");
-    if (altStart != -1) {
-        int ipStart = altStart + 14;
-        int ipEnd = ipResponse.indexOf("\"", ipStart);
-        if (ipEnd != -1) {
-            String ipAddress = ipResponse.substring(ipStart, ipEnd);
-            Serial.print("\n>>> YOUR IP ADDRESS: ");
-            Serial.println(ipAddress);
+    else {
+        // Both "+CIFSR:STAIP,\"ip\"" and the older "STAIP,\"ip\"" format
+        const char* staip = strstr_P(atLine, PSTR("STAIP,\""));
+        if (staip != NULL) {
+            const char* ipStart = staip + 7;
+            const char* ipEnd = strchr(ipStart, '"');
+            if (ipEnd != NULL) {
+                Serial.print(F("\n>>> YOUR IP ADDRESS: "));
+                Serial.write((const uint8_t*)ipStart, ipEnd - ipStart);
+                Serial.println();
+            }
         }
     }
-    
-    Serial.println("\n======================================");
-    Serial.println("If no IP shown above, check ESP8266 connection");
-    
-    sendCommand("AT+CIPMUX=1\r\n", 1000);
+}
 
-    String serverCmd = "AT+CIPSERVER=1,";
-    serverCmd += SERVER_PORT;
-    serverCmd += "\r\n";
-    sendCommand(serverCmd, 1000);
+// Writes "<prefix><connectionId>[,<length>]\r\n" to the ESP8266
+void sendLinkCommand(const __FlashStringHelper* prefix, int connectionId, long length) {
+    char command[24];
+    size_t commandLength = appendText(command, sizeof(command), 0, prefix);
+    commandLength = appendFixedPoint(command, sizeof(command), commandLength, connectionId, 0);
+    if (length >= 0) {
+        commandLength = appendText(command, sizeof(command), commandLength, F(","));
+        commandLength = appendFixedPoint(command, sizeof(command), commandLength, length, 0);
+    }
+    appendText(command, sizeof(command), commandLength, F("\r\n"));
 
-    Serial.println("Wi-Fi Server Started!");
+    atResult = AT_NONE;
+    esp8266.print(command);
 }
 
-void readWiFiCommand(int connectionId) {
-    currentCommand = "";
-    while (esp8266.available()) {
-        currentCommand += (char)esp8266.read();
-    }
-
-    int start = currentCommand.indexOf("GET /");
-    int end = currentCommand.indexOf(" HTTP/1.1");
-    String action = "";
-
-    if (start != -1 && end != -1) {
-        action = currentCommand.substring(start + 5, end);
-        Serial.print("   Action: ");
-        Serial.println(action);
-    }
-
-    // Actuator Control Logic
-    // Lamp: Toggle relay state - physical switch in series creates XOR
-    if (action.equals("LAMP_ON")) {
-        lampRelayState = true;
-        digitalWrite(LAMP_RELAY_PIN, LOW); // Active LOW relay ON
-        Serial.println("   Lamp relay ON");
-    }
-    else if (action.equals("LAMP_OFF")) {
-        lampRelayState = false;
-        digitalWrite(LAMP_RELAY_PIN, HIGH); // Active LOW relay OFF
-        Serial.println("   Lamp relay OFF");
-    }
-    else if (action.equals("LAMP_TOGGLE")) {
-        lampRelayState = !lampRelayState;
-        digitalWrite(LAMP_RELAY_PIN, lampRelayState ? LOW : HIGH);
-        Serial.print("   Lamp relay toggled to: ");
-        Serial.println(lampRelayState ? "ON" : "OFF");
-    }
-    else if (action.equals("PLUG_ON")) {
-        digitalWrite(PLUG_RELAY_PIN, LOW);
-        plugState = true;
-    }
-    else if (action.equals("PLUG_OFF")) {
-        digitalWrite(PLUG_RELAY_PIN, HIGH);
-        plugState = false;
-    }
-    else if (action.startsWith("SET_THRESHOLD:")) {
-        String thresholdStr = action.substring(14);
-        float newThreshold = thresholdStr.toFloat();
-        if (newThreshold > 0 && newThreshold < 100) {
-            alarmTempThreshold = newThreshold;
-            Serial.print("   Threshold set to: ");
-            Serial.println(alarmTempThreshold);
+// HTTP response header with CORS for browser/app compatibility
+size_t formatHttpHeader(char* buffer, size_t bufferSize, bool asFrame, size_t contentLength) {
+    size_t length = 0;
+    length = appendText(buffer, bufferSize, length, F("HTTP/1.1 200 OK\r\n"
+                                                      "Access-Control-Allow-Origin: *\r\n"
+                                                      "Content-Type: "));
+    length = appendText(buffer, bufferSize, length, asFrame ? (const __FlashStringHelper*)STATUS_FRAME_CONTENT_TYPE
+                                                            : F("text/plain"));
+    length = appendText(buffer, bufferSize, length, F("\r\nContent-Length: "));
+    length = appendFixedPoint(buffer, bufferSize, length, contentLength, 0);
+    length = appendText(buffer, bufferSize, length, F("\r\n\r\n"));
+    return length;
+}
+
+void advanceTx(TxState next) {
+    txState = next;
+    txStepStartedAt = millis();
+}
+
+// Reply state machine: CIPSEND -> '>' -> data -> SEND OK -> CIPCLOSE -> OK.
+// Each step only checks what pumpEsp8266() has seen, so it never waits.
+void serviceEspTransport() {
+    if (txState != TX_IDLE && millis() - txStepStartedAt > TX_STEP_TIMEOUT_MS) {
+        LOG_WARN(F("   Reply to CID "), txConnection, F(" timed out"));
+        replyPending[txConnection] = false;
+        txConnection = -1;
+        txState = TX_IDLE;
+    }
+
+    switch (txState) {
+        case TX_IDLE:
+            for (int id = 0; id < MAX_ESP_CONNECTIONS; id++) {
+                if (replyPending[id]) {
+                    // 1. Build the status now and announce the total length
+                    CentiCelsius temp = readNTC();
+                    StatusFrame status = currentStatusFrame(temp);
+
+                    txConnection = id;
+                    txAsFrame = replyAsFrame[id];
+                    if (txAsFrame) {
+                        txStatusLength = encodeStatusFrame((uint8_t*)txStatus, sizeof(txStatus), status);
+                    }
+                    else {
+                        txStatusLength = sendCurrentStatus(txStatus, sizeof(txStatus), temp);
+                    }
+                    char header[HTTP_HEADER_BUFFER_SIZE];
+                    size_t headerLength = formatHttpHeader(header, sizeof(header), txAsFrame, txStatusLength);
+                    sendLinkCommand(F("AT+CIPSEND="), id, headerLength + txStatusLength);
+                    advanceTx(TX_WAIT_PROMPT);
+                    break;
+                }
+            }
+            break;
+
+        case TX_WAIT_PROMPT:
+            if (atResult == AT_PROMPT) {
+                // 2. Send the actual data straight from the buffers
+                char header[HTTP_HEADER_BUFFER_SIZE];
+                size_t headerLength = formatHttpHeader(header, sizeof(header), txAsFrame, txStatusLength);
+                atResult = AT_NONE;
+                esp8266.write((const uint8_t*)header, headerLength);
+                esp8266.write((const uint8_t*)txStatus, txStatusLength);
+                advanceTx(TX_WAIT_SEND_OK);
+            }
+            else if (atResult == AT_ERROR) {
+                replyPending[txConnection] = false;
+                txConnection = -1;
+                txState = TX_IDLE;
+            }
+            break;
+
+        case TX_WAIT_SEND_OK:
+            if (atResult == AT_SEND_OK || atResult == AT_SEND_FAIL || atResult == AT_ERROR) {
+                // 3. Close the connection
+                sendLinkCommand(F("AT+CIPCLOSE="), txConnection, -1);
+                advanceTx(TX_WAIT_CLOSE);
+            }
+            break;
+
+        case TX_WAIT_CLOSE:
+            if (atResult == AT_OK || atResult == AT_ERROR) {
+                replyPending[txConnection] = false;
+                txConnection = -1;
+                txState = TX_IDLE;
+            }
+            break;
+    }
+}
+
+// Applies the command (or /BATCH of commands) named by a GET path, without
+// the leading '/', and queues one status reply. Unknown commands and bad
+// arguments only get the status, as before; a batch with any bad entry is
+// not applied at all.
+void handleWiFiCommand(int connectionId, const char* action) {
+    LOG_INFO(F("\n> COMMAND RECEIVED on CID: "), connectionId);
+
+    if (*action) {
+        LOG_INFO(F("   Action: "), action);
+    }
+
+    CommandBatch batch;
+    bool asFrame = false;
+    if (parseCommandBatch(action, DEVICES, batch) == COMMAND_OK) {
+        asFrame = (batch.count == 1 && batch.commands[0].type == CMD_STATUS_FRAME);
+        applyCommands(batch);
+    }
+
+    if (connectionId >= 0 && connectionId < MAX_ESP_CONNECTIONS) {
+        replyPending[connectionId] = true;
+        replyAsFrame[connectionId] = asFrame;
+    }
+}
+
+// Actuator Control Logic: update the state for every command, then write
+// the outputs once so a batch switches the relays together
+void applyCommands(const CommandBatch& batch) {
+    DeviceBits<DEVICE_COUNT> commandedBefore = devicesCommanded;
+    for (uint8_t i = 0; i < batch.count; i++) {
+        applyStateChange(batch.commands[i]);
+    }
+
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        bool on = devicesCommanded.get(i);
+        // Alarm outputs follow a changed override at once; loop() adds the temperature
+        if (spec.kind == KIND_RELAY || (spec.kind == KIND_ALARM && on != commandedBefore.get(i))) {
+            digitalWrite(spec.pin, deviceLevel(spec, on));
+            devicesOn.set(i, on);
+        }
+    }
+}
+
+void applyStateChange(const ParsedCommand& command) {
+    switch (command.type) {
+        // Relays and alarm overrides (the lamp relay has a physical switch in series: XOR)
+        case CMD_DEVICE_ON:
+        case CMD_DEVICE_OFF:
+        case CMD_DEVICE_TOGGLE: {
+            const DeviceSpec& spec = DEVICE_SPECS[command.device];
+            bool on = command.type == CMD_DEVICE_ON
+                   || (command.type == CMD_DEVICE_TOGGLE && !devicesCommanded.get(command.device));
+            devicesCommanded.set(command.device, on);
+            LOG_INFO(F("   "), spec.name, F(" set to: "), deviceStateText(spec, on));
+            break;
+        }
+        case CMD_SET_THRESHOLD:
+            alarmThresholdCenti = command.value;
+            LOG_INFO(F("   Threshold set to: "), logFixed(alarmThresholdCenti, 2));
+            break;
+        case CMD_STATUS:
+            LOG_DEBUG(F("   Status poll received."));
+            break;
+        case CMD_STATUS_FRAME:
+        case CMD_BATCH:
+            break;
+    }
+}
+
+// Binary sensors other than the door (which has its interrupt) are read on
+// every sensing pass
+void pollBinarySensors() {
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (spec.kind == KIND_BINARY_SENSOR && i != DEVICE_DOOR) {
+            devicesOn.set(i, deviceOnAtLevel(spec, digitalRead(spec.pin)));
         }
     }
-    else if (action.equals("ALARM_ON")) {
-        buzzerAppOverride = true;
-        digitalWrite(BUZZER_PIN, HIGH);
-        Serial.println("   App activated alarm");
+}
+
+// Device states as reported: alarm outputs from the live temperature, the
+// rest as last written or read
+DeviceBits<DEVICE_COUNT> currentDevicesOn(CentiCelsius temp) {
+    DeviceBits<DEVICE_COUNT> on = devicesOn;
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        if (DEVICE_SPECS[i].kind == KIND_ALARM) {
+            on.set(i, temp > alarmThresholdCenti || devicesCommanded.get(i));
+        }
     }
-    else if (action.equals("ALARM_OFF")) {
-        buzzerAppOverride = false;
-        digitalWrite(BUZZER_PIN, LOW);
-        Serial.println("   App deactivated alarm");
+    return on;
+}
+
+// --- Status Serialization ---
+// The status reply is written into a caller-provided buffer with hand-rolled
+// fixed-point formatting, so building it never touches the heap.
+
+// Appends text, truncating at capacity - 1. Always NUL-terminates.
+size_t appendText(char* buffer, size_t capacity, size_t length, const char* text) {
+    while (*text && length + 1 < capacity) {
+        buffer[length++] = *text++;
     }
-    else if (action.equals("STATUS")) {
-        Serial.println("   Status poll received.");
+    buffer[length] = '\0';
+    return length;
+}
+
+// Same, for F("...") text read from flash
+size_t appendText(char* buffer, size_t capacity, size_t length, const __FlashStringHelper* text) {
+    PGM_P next = reinterpret_cast<PGM_P>(text);
+    for (char c = pgm_read_byte(next); c != '\0' && length + 1 < capacity; c = pgm_read_byte(++next)) {
+        buffer[length++] = c;
     }
+    buffer[length] = '\0';
+    return length;
+}
 
-    // Prepare Status Response
-    String statusResponse = sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN));
+// Appends scaled / 10^decimals, e.g. (2734, 2) -> "27.34", (-5, 2) -> "-0.05"
+size_t appendFixedPoint(char* buffer, size_t capacity, size_t length, long scaled, uint8_t decimals) {
+    char digits[12];
+    uint8_t count = 0;
+    unsigned long magnitude = (scaled < 0) ? 0UL - (unsigned long)scaled : (unsigned long)scaled;
 
-    // Send HTTP Response with CORS header for browser/app compatibility
-    String header = "HTTP/1.1 200 OK\r\n";
-    header += "Access-Control-Allow-Origin: *\r\n";
-    header += "Content-Type: text/plain\r\n";
-    header += "Content-Length: ";
-    header += statusResponse.length();
-    header += "\r\n\r\n";
+    do {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= decimals);
 
-    String finalResponse = header + statusResponse;
+    if (scaled < 0 && length + 1 < capacity) {
+        buffer[length++] = '-';
+    }
+    while (count > 0 && length + 1 < capacity) {
+        if (count == decimals) {
+            buffer[length++] = '.';
+            if (length + 1 >= capacity) break;
+        }
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = '\0';
+    return length;
+}
 
-    // 1. Send command length
-    String cipSend = "AT+CIPSEND=";
-    cipSend += connectionId;
-    cipSend += ",";
-    cipSend += finalResponse.length();
-    cipSend += "\r\n";
-    sendCommand(cipSend, 500);
+// Function to format the status data for the Android App.
+// Writes into buffer (NUL-terminated) and returns the length written.
+// Format: "TEMP:XX.XX,DOOR:STATUS,LAMP:STATUS,PLUG:STATUS,ALARM:STATUS,THRESHOLD:XX.X",
+// one NAME:value field per DEVICE_SPECS row
+size_t sendCurrentStatus(char* buffer, size_t bufferSize, CentiCelsius temp) {
+    DeviceBits<DEVICE_COUNT> on = currentDevicesOn(temp);
+
+    size_t length = 0;
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        length = appendText(buffer, bufferSize, length, spec.name);
+        length = appendText(buffer, bufferSize, length, F(":"));
+        if (deviceIsBinary(spec)) {
+            length = appendText(buffer, bufferSize, length, deviceStateText(spec, on.get(i)));
+        } else {
+            length = appendFixedPoint(buffer, bufferSize, length, temp, 2);
+        }
+        length = appendText(buffer, bufferSize, length, F(","));
+    }
+    length = appendText(buffer, bufferSize, length, F("THRESHOLD:"));
+    length = appendFixedPoint(buffer, bufferSize, length, centiCelsiusScaled(alarmThresholdCenti, 1), 1);
 
-    // 2. Send the actual data
-    esp8266.print(finalResponse);
-    delay(100);
+    return length;
+}
 
-    // 3. Close the connection
-    String cipClose = "AT+CIPCLOSE=";
-    cipClose += connectionId;
-    cipClose += "\r\n";
-    sendCommand(cipClose, 1000);
+// Binary form of the same status (see status_frame.h); flag bits follow the
+// binary devices in table order. Also advances stateVersion when any field
+// differs from the last status built.
+StatusFrame currentStatusFrame(CentiCelsius temp) {
+    DeviceBits<DEVICE_COUNT> on = currentDevicesOn(temp);
+
+    StatusFrame frame;
+    frame.temperatureCenti = temp;
+    frame.thresholdCenti = alarmThresholdCenti;
+    frame.flags = 0;
+    uint8_t bit = 0;
+    for (uint8_t i = 0; i < DEVICE_COUNT && bit < STATUS_FRAME_FLAG_BITS; i++) {
+        if (deviceIsBinary(DEVICE_SPECS[i])) {
+            frame.flags |= (uint8_t)(on.get(i) << bit);
+            bit++;
+        }
+    }
+
+    if (!sameStatus(frame, reportedStatus)) {
+        reportedStatus = frame;
+        stateVersion++;
+    }
+    frame.sequence = stateVersion;
+    return frame;
 }
 
-// Function to format the status data for the Android App
-String sendCurrentStatus(float temp, bool doorSensorReading) {
-    String doorStatusStr = (doorSensorReading == LOW) ? "OPEN" : "CLOSED";
-    String lampStatusStr = lampRelayState ? "ON" : "OFF";
-    String plugStatusStr = plugState ? "ON" : "OFF";
-    String alarmStatusStr = (temp > alarmTempThreshold || buzzerAppOverride) ? "ALARM" : "SAFE";
+#ifdef BENCHMARK_STATUS_SERIALIZER
+// Previous String-based implementation, kept only for the boot-time comparison
+String legacySendCurrentStatus(CentiCelsius centi) {
+    DeviceBits<DEVICE_COUNT> on = currentDevicesOn(centi);
+    float temp = centi / 100.0;
+    String doorStatusStr = on.get(DEVICE_DOOR) ? "OPEN" : "CLOSED";
+    String lampStatusStr = on.get(DEVICE_LAMP) ? "ON" : "OFF";
+    String plugStatusStr = on.get(DEVICE_PLUG) ? "ON" : "OFF";
+    String alarmStatusStr = on.get(DEVICE_ALARM) ? "ALARM" : "SAFE";
 
-    // Format: "TEMP:XX.XX,DOOR:STATUS,LAMP:STATUS,PLUG:STATUS,ALARM:STATUS,THRESHOLD:XX.X"
     String statusMessage = "";
     statusMessage += "TEMP:";
     statusMessage += String(temp, 2);
@@ -366,7 +833,125 @@ String sendCurrentStatus(float temp, bool doorSensorReading) {
     statusMessage += ",ALARM:";
     statusMessage += alarmStatusStr;
     statusMessage += ",THRESHOLD:";
-    statusMessage += String(alarmTempThreshold, 1);
+    statusMessage += String(centiCelsiusToFloat(alarmThresholdCenti), 1);
 
     return statusMessage;
-}
\ No newline at end of file
+}
+
+// Times both serializers over the same inputs and prints microseconds per call
+void benchmarkStatusSerializer() {
+    const int ITERATIONS = 1000;
+    char buffer[STATUS_BUFFER_SIZE];
+    volatile size_t sink = 0;
+
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += legacySendCurrentStatus(2000 + i).length();
+    }
+    unsigned long legacyUs = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += sendCurrentStatus(buffer, sizeof(buffer), 2000 + i);
+    }
+    unsigned long bufferUs = micros() - start;
+
+    LOG_INFO(F("[BENCH] String status: "), logFixed(legacyUs / (ITERATIONS / 100), 2),
+             F(" us/call, buffer status: "), logFixed(bufferUs / (ITERATIONS / 100), 2), F(" us/call"));
+}
+#endif
+
+#ifdef BENCHMARK_TEMPERATURE
+// The float versions the sketch used before centi_celsius.h, kept only for
+// this comparison. With the benchmark off nothing references them and the
+// float library is not linked.
+bool parseFloatCelsius(const char* text, float& value) {
+    char* end;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    value = (float)parsed;
+    return true;
+}
+
+// Cycles per call, from the time of ITERATIONS calls
+unsigned long benchCycles(unsigned long us, int iterations) {
+    return us * clockCyclesPerMicrosecond() / iterations;
+}
+
+// Times each step of the temperature path, float then fixed point, over the
+// same inputs, and prints CPU cycles per call (loop overhead included in
+// both). The inputs are volatile so the compiler cannot fold them.
+void benchmarkTemperature() {
+    const int ITERATIONS = 1000;
+    static const char* const THRESHOLDS[] = { "27", "27.5", "31.25", "8.05" };
+    volatile int16_t tableCenti = 2734;
+    volatile float sinkFloat = 0;
+    volatile long sink = 0;
+    char buffer[STATUS_BUFFER_SIZE];
+
+    // Table lookup to degrees: the old readNTC() divided by 100.0
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sinkFloat = (int16_t)(tableCenti + i) / 100.0;
+    }
+    unsigned long floatConvertUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink = (CentiCelsius)(tableCenti + i);
+    }
+    unsigned long fixedConvertUs = micros() - start;
+
+    // Alarm check
+    volatile float tempFloat = 27.34;
+    volatile float thresholdFloat = 27.0;
+    volatile CentiCelsius tempCenti = 2734;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += tempFloat > thresholdFloat;
+    }
+    unsigned long floatCompareUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += tempCenti > alarmThresholdCenti;
+    }
+    unsigned long fixedCompareUs = micros() - start;
+
+    // SET_THRESHOLD argument
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        float value;
+        parseFloatCelsius(THRESHOLDS[i & 3], value);
+        sinkFloat = value;
+    }
+    unsigned long floatParseUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        CentiCelsius value;
+        parseCentiCelsius(THRESHOLDS[i & 3], value);
+        sink += value;
+    }
+    unsigned long fixedParseUs = micros() - start;
+
+    // "27.34" for the status reply; the float side rounds like String(temp, 2)
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        float temp = tempFloat;
+        sink += appendFixedPoint(buffer, sizeof(buffer), 0, (long)(temp * 100 + (temp < 0 ? -0.5f : 0.5f)), 2);
+    }
+    unsigned long floatFormatUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += appendFixedPoint(buffer, sizeof(buffer), 0, tempCenti, 2);
+    }
+    unsigned long fixedFormatUs = micros() - start;
+
+    LOG_INFO(F("[BENCH] cycles/call float -> fixed: convert "), benchCycles(floatConvertUs, ITERATIONS),
+             F(" -> "), benchCycles(fixedConvertUs, ITERATIONS),
+             F(", compare "), benchCycles(floatCompareUs, ITERATIONS), F(" -> "), benchCycles(fixedCompareUs, ITERATIONS),
+             F(", parse "), benchCycles(floatParseUs, ITERATIONS), F(" -> "), benchCycles(fixedParseUs, ITERATIONS),
+             F(", format "), benchCycles(floatFormatUs, ITERATIONS), F(" -> "), benchCycles(fixedFormatUs, ITERATIONS));
+    (void)sinkFloat;
+}
+#endif
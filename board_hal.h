@@ -0,0 +1,294 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Board Abstraction Layer
+// ----------------------------------------------------
+// Included by esp32_main_code.cpp. When building with the Arduino IDE, keep
+// this file in the sketch folder.
+//
+// The firmware reaches the hardware, network and RTOS only through:
+//   - this subset of the Arduino core: pinMode, digitalWrite, digitalRead,
+//     analogRead, attachInterrupt, millis, micros, delay, Serial, String,
+//     PROGMEM/pgm_read_byte
+//   - WebServer and WiFiClient, limited to the calls the handlers use
+//   - a UDP socket through boardUdpOpen/Receive/Send
+//   - FreeRTOS tasks, queues and notifications: xTaskCreatePinnedToCore,
+//     vTaskDelay(Until), xTaskGetTickCount, vTaskDelete,
+//     xQueueCreate/Send/Receive, xTaskNotifyGive, vTaskNotifyGiveFromISR,
+//     portYIELD_FROM_ISR, ulTaskNotifyTake
+//   - the board* functions and BoardJournalStorage below, for everything
+//     that is ESP32-specific, including the wall clock and the settings
+//     kept in NVS
+//
+// On the ESP32 these are the core's own objects and functions, so the
+// layer costs nothing. Host builds (no ARDUINO macro, see CMakeLists.txt)
+// get the Linux backend in host/. It serves HTTP on a real local socket and
+// simulates the sensors and relays.
+
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "journal_storage.h"
+
+// Source or destination of a datagram, both in network byte order
+struct BoardUdpPeer {
+    uint32_t address;
+    uint16_t port;
+};
+
+// The access point and IPv4 lease of the last good connection, saved so the
+// next connect can skip the scan and DHCP. Addresses in network byte order.
+struct BoardWiFiLink {
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+#if defined(ARDUINO)
+#include <WiFi.h>
+#include <Preferences.h>
+#include <lwip/sockets.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include <time.h>
+
+// The UART driver gets a transmit ring of txBufferSize bytes, which its
+// interrupt empties, so Serial.write() of up to availableForWrite() bytes
+// returns at once
+inline void boardSerialBegin(unsigned long baud, size_t txBufferSize) {
+    Serial.setTxBufferSize(txBufferSize);
+    Serial.begin(baud);
+}
+
+// 12-bit readings (0-4095) over the full 3.3V range
+inline void boardConfigureAdc() {
+    analogReadResolution(12);
+    analogSetAttenuation(ADC_11db);
+}
+
+// Starts connecting and returns at once; poll boardWiFiConnected(). With
+// a cached link the station joins that access point on its channel and
+// takes its old address, so there is neither a scan nor a DHCP exchange;
+// without one it scans and asks DHCP. The core's own reconnect is off:
+// the firmware decides when to try again.
+inline void boardWiFiBegin(const char* ssid, const char* password, const BoardWiFiLink* cached) {
+    WiFi.persistent(false);   // Credentials come from the sketch; no flash write per attempt
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+    WiFi.disconnect();
+    if (cached) {
+        WiFi.config(IPAddress(cached->ip), IPAddress(cached->gateway), IPAddress(cached->subnet), IPAddress(cached->dns));
+        WiFi.begin(ssid, password, cached->channel, cached->bssid);
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);   // Back to DHCP
+        WiFi.begin(ssid, password);
+    }
+}
+
+// Abandons a connection attempt or drops the link
+inline void boardWiFiDisconnect() {
+    WiFi.disconnect();
+}
+
+inline bool boardWiFiConnected() {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+inline String boardLocalIP() {
+    return WiFi.localIP().toString();
+}
+
+// The current access point and lease; false while not connected
+inline bool boardWiFiLinkInfo(BoardWiFiLink& link) {
+    const uint8_t* bssid = WiFi.BSSID();
+    if (WiFi.status() != WL_CONNECTED || bssid == NULL) {
+        return false;
+    }
+    memcpy(link.bssid, bssid, sizeof(link.bssid));
+    link.channel = WiFi.channel();
+    link.ip = (uint32_t)WiFi.localIP();
+    link.gateway = (uint32_t)WiFi.gatewayIP();
+    link.subnet = (uint32_t)WiFi.subnetMask();
+    link.dns = (uint32_t)WiFi.dnsIP(0);
+    return true;
+}
+
+inline void boardRestart() {
+    ESP.restart();
+}
+
+// Scales the CPU between 80 and 240 MHz and lets the idle task enter light
+// sleep whenever every task is blocked; Wi-Fi stays associated in modem
+// sleep and wakes for each DTIM beacon. GPIO interrupts do not fire in
+// light sleep. Returns false if the core was built without power
+// management (CONFIG_PM_ENABLE and tickless idle).
+inline bool boardEnableLightSleep() {
+    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    esp_pm_config_esp32_t config;
+    config.max_freq_mhz = 240;
+    config.min_freq_mhz = 80;
+    config.light_sleep_enable = true;
+    return esp_pm_configure(&config) == ESP_OK;
+}
+
+// Microseconds since boot; 64-bit, so it never wraps
+inline int64_t boardUptimeUs() {
+    return esp_timer_get_time();
+}
+
+// CPU cycle counter of the calling core; wraps every ~18 s at 240 MHz, so
+// only use it for short intervals measured on one core
+inline uint32_t boardCycleCount() {
+    return ESP.getCycleCount();
+}
+
+inline uint32_t boardCyclesPerUs() {
+    return ESP.getCpuFreqMHz();
+}
+
+inline uint32_t boardFreeHeap() {
+    return ESP.getFreeHeap();
+}
+
+// Largest single allocation that can currently succeed
+inline uint32_t boardLargestFreeBlock() {
+    return ESP.getMaxAllocHeap();
+}
+
+// 32 random bits from the hardware generator (true random once the radio
+// is on, pseudo-random before)
+inline uint32_t boardRandom() {
+    return esp_random();
+}
+
+// Sets the time zone (POSIX TZ string) and starts SNTP, which sets the clock
+// in the background once Wi-Fi is up
+inline void boardStartClock(const char* timezone) {
+    configTzTime(timezone, "pool.ntp.org");
+}
+
+// Local minutes since midnight, or -1 while the clock is not set
+inline int boardMinuteOfDay() {
+    time_t now = time(NULL);
+    if (now < 1600000000) {
+        return -1;   // Still counting from 1970
+    }
+    struct tm local;
+    localtime_r(&now, &local);
+    return local.tm_hour * 60 + local.tm_min;
+}
+
+// Settings survive a reboot as blobs in the "smart_home" NVS namespace.
+// Saving an empty blob removes the key.
+inline bool boardSaveSetting(const char* key, const void* data, size_t length) {
+    Preferences settings;
+    if (!settings.begin("smart_home", false)) {
+        return false;
+    }
+    bool saved = length == 0 ? (settings.remove(key) || true) : settings.putBytes(key, data, length) == length;
+    settings.end();
+    return saved;
+}
+
+// Returns the stored length, or 0 if the key is missing or longer than capacity
+inline size_t boardLoadSetting(const char* key, void* data, size_t capacity) {
+    Preferences settings;
+    if (!settings.begin("smart_home", true)) {
+        return 0;
+    }
+    size_t length = settings.getBytesLength(key);
+    length = (length > 0 && length <= capacity) ? settings.getBytes(key, data, length) : 0;
+    settings.end();
+    return length;
+}
+
+// A datagram socket on port, on all interfaces and open to broadcasts.
+// Returns the socket, or -1.
+inline int boardUdpOpen(uint16_t port) {
+    int socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketFd < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(socketFd);
+        return -1;
+    }
+    return socketFd;
+}
+
+// Blocks the calling task until a datagram arrives; returns its length
+// (truncated to capacity) or -1
+inline int boardUdpReceive(int socketFd, void* buffer, size_t capacity, BoardUdpPeer& from) {
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    int length = recvfrom(socketFd, buffer, capacity, 0, (struct sockaddr*)&address, &addressLength);
+    from.address = address.sin_addr.s_addr;
+    from.port = address.sin_port;
+    return length;
+}
+
+inline bool boardUdpSend(int socketFd, const void* data, size_t length, const BoardUdpPeer& to) {
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = to.address;
+    address.sin_port = to.port;
+    return sendto(socketFd, data, length, 0, (struct sockaddr*)&address, sizeof(address)) == (int)length;
+}
+
+typedef EspPartitionJournalStorage BoardJournalStorage;
+
+#else
+// Linux backend: host/Arduino.h, host/WebServer.h, host/host_board.cpp
+void boardSerialBegin(unsigned long baud, size_t txBufferSize);
+void boardConfigureAdc();
+// Wi-Fi is simulated, with the delays and drops set in host/host_board.cpp
+void boardWiFiBegin(const char* ssid, const char* password, const BoardWiFiLink* cached);
+void boardWiFiDisconnect();
+bool boardWiFiConnected();
+String boardLocalIP();
+bool boardWiFiLinkInfo(BoardWiFiLink& link);
+void boardRestart();
+bool boardEnableLightSleep();   // false: there is no sleep on Linux
+int64_t boardUptimeUs();
+uint32_t boardCycleCount();    // Nanoseconds of a steady clock
+uint32_t boardCyclesPerUs();   // 1000
+uint32_t boardFreeHeap();
+uint32_t boardLargestFreeBlock();
+uint32_t boardRandom();        // std::random_device
+void boardStartClock(const char* timezone);   // Sets TZ; the system clock is already set
+int boardMinuteOfDay();
+
+// UDP on a local socket; the port is $HOST_UDP_PORT if set, and ports
+// below 1024 get 8000 added, as for HTTP
+int boardUdpOpen(uint16_t port);
+int boardUdpReceive(int socketFd, void* buffer, size_t capacity, BoardUdpPeer& from);
+bool boardUdpSend(int socketFd, const void* data, size_t length, const BoardUdpPeer& to);
+
+// Settings are files named "<key>.setting" in $HOST_DATA_DIR
+bool boardSaveSetting(const char* key, const void* data, size_t length);
+size_t boardLoadSetting(const char* key, void* data, size_t capacity);
+
+// Journal partitions are image files named "<label>.img" in $HOST_DATA_DIR
+// (default: the working directory)
+class HostJournalStorage : public FileJournalStorage {
+public:
+    HostJournalStorage();
+    bool begin(const char* label);
+    const char* label() const;
+
+private:
+    char partitionLabel[17];
+    char imagePath[256];
+};
+
+typedef HostJournalStorage BoardJournalStorage;
+#endif
@@ -0,0 +1,80 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Fixed-Point Temperatures
+// ----------------------------------------------------
+// Included by both firmwares. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// A temperature is an int16 count of hundredths of a degree C (27.35 C is
+// 2735), the unit of the NTC table, the status frame and the journal.
+// Compare them as plain integers. The Uno has no FPU: with these routines
+// its sensing, alarm check, SET_THRESHOLD and status text stay in integer
+// arithmetic, and no float code is linked in.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int16_t CentiCelsius;
+
+const CentiCelsius CENTI_CELSIUS_MIN = -32768;
+const CentiCelsius CENTI_CELSIUS_MAX = 32767;
+
+// Parses "[-]digits[.digits]", e.g. "27", "27.5" or "-0.25". Digits past
+// the second decimal round half away from zero. Returns false for anything
+// else (no exponent or spaces) and outside -327.68 .. 327.67.
+inline bool parseCentiCelsius(const char* text, CentiCelsius& value) {
+    bool negative = (*text == '-');
+    if (negative) {
+        text++;
+    }
+
+    int32_t centi = 0;
+    uint8_t digits = 0;
+    for (; *text >= '0' && *text <= '9'; text++, digits++) {
+        centi = centi * 10 + (*text - '0');
+        if (centi > -(int32_t)CENTI_CELSIUS_MIN / 100) {
+            return false;   // Out of range, before the sum can overflow
+        }
+    }
+    centi *= 100;
+
+    if (*text == '.') {
+        text++;
+        int32_t scale = 10;
+        for (; *text >= '0' && *text <= '9'; text++, digits++) {
+            if (scale > 0) {
+                centi += (*text - '0') * scale;
+                scale /= 10;
+            } else if (scale == 0) {
+                centi += (*text >= '5');   // Third decimal rounds, the rest are ignored
+                scale = -1;
+            }
+        }
+    }
+    if (digits == 0 || *text != '\0') {
+        return false;
+    }
+
+    if (negative) {
+        centi = -centi;
+    }
+    if (centi < CENTI_CELSIUS_MIN || centi > CENTI_CELSIUS_MAX) {
+        return false;
+    }
+    value = (CentiCelsius)centi;
+    return true;
+}
+
+// value rounded half away from zero to decimals (0-2) places and scaled by
+// 10^decimals, for a fixed-point formatter: (2735, 1) -> 274 for "27.4"
+inline int32_t centiCelsiusScaled(CentiCelsius value, uint8_t decimals) {
+    int32_t divisor = decimals >= 2 ? 1 : decimals == 1 ? 10 : 100;
+    int32_t half = value < 0 ? -divisor / 2 : divisor / 2;
+    return (value + half) / divisor;
+}
+
+// For code that keeps float state (the ESP32)
+inline float centiCelsiusToFloat(CentiCelsius value) {
+    return value / 100.0f;
+}
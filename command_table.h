@@ -0,0 +1,302 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Shared Command Table
+// ----------------------------------------------------
+// Included by both esp32_main_code.cpp and arduino_main_code.cpp. When
+// building with the Arduino IDE, keep this file in the sketch folder.
+//
+// Every fixed command the app can send is listed once in COMMAND_SPECS. The
+// compiler searches for a hash seed that gives each name its own slot in a
+// 16-entry table, so looking up a command is one hash, one table read and
+// one string compare, whatever the number of commands. Names the table does
+// not know are tried as "<DEVICE>_ON/_OFF/_TOGGLE" through the same kind of
+// index over the sketch's device table (DeviceNameIndex, device_registry.h).
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "device_registry.h"
+#include "centi_celsius.h"
+#include "index_list.h"
+
+// --- Commands ---
+// Values are stored in the event journal, so they are never reused: 0-6 were
+// the fixed LAMP/PLUG/ALARM commands now generated from the device table
+enum CommandType : uint8_t {
+    CMD_SET_THRESHOLD = 7,
+    CMD_STATUS,
+    CMD_STATUS_FRAME,
+    CMD_BATCH,
+    CMD_DEVICE_ON,       // "<DEVICE>_ON", device in ParsedCommand::device
+    CMD_DEVICE_OFF,
+    CMD_DEVICE_TOGGLE
+};
+
+// Names of the retired values, for journal records written before the change
+const char* const RETIRED_COMMAND_NAMES[CMD_SET_THRESHOLD] = {
+    "LAMP_ON", "LAMP_OFF", "LAMP_TOGGLE", "PLUG_ON", "PLUG_OFF", "ALARM_ON", "ALARM_OFF"
+};
+
+// How the text after "NAME:" is parsed and validated
+enum CommandArg : uint8_t {
+    ARG_NONE,      // No ':' allowed
+    ARG_CELSIUS,   // Decimal degrees C, 0 < value < 100, kept as CentiCelsius
+    ARG_LIST       // Comma-separated commands, see parseCommandBatch()
+};
+
+struct CommandSpec {
+    const char* name;
+    CommandType type;
+    CommandArg arg;
+};
+
+// The request path is "/NAME" or "/NAME:<arg>"
+constexpr CommandSpec COMMAND_SPECS[] = {
+    { "SET_THRESHOLD", CMD_SET_THRESHOLD, ARG_CELSIUS },
+    { "STATUS",        CMD_STATUS,        ARG_NONE },
+    { "STATUS.bin",    CMD_STATUS_FRAME,  ARG_NONE },    // Binary status, see status_frame.h
+    { "BATCH",         CMD_BATCH,         ARG_LIST },
+};
+
+constexpr uint8_t COMMAND_COUNT = sizeof(COMMAND_SPECS) / sizeof(COMMAND_SPECS[0]);
+constexpr uint8_t COMMAND_SLOT_BITS = 4;
+constexpr uint8_t COMMAND_SLOTS = 1 << COMMAND_SLOT_BITS;  // > COMMAND_COUNT
+constexpr uint8_t COMMAND_NAME_SIZE = 14;   // Longest name + NUL
+constexpr uint8_t NO_COMMAND = 0xFF;
+constexpr uint8_t MAX_BATCH_COMMANDS = 8;
+constexpr uint8_t BATCH_ENTRY_BUFFER_SIZE = 24;  // "SET_THRESHOLD:" + number + NUL, or "<DEVICE>_TOGGLE" + NUL
+
+enum CommandParseResult : uint8_t {
+    COMMAND_OK,
+    COMMAND_UNKNOWN,     // Name not in the table
+    COMMAND_BAD_ARG      // Known name, missing/unexpected/invalid argument
+};
+
+struct ParsedCommand {
+    CommandType type;
+    uint8_t device;     // Device table index for CMD_DEVICE_*, else 0
+    CentiCelsius value; // Validated argument (ARG_CELSIUS), else 0
+};
+
+// Commands applied together, in order; a single command is a batch of one
+struct CommandBatch {
+    uint8_t count;
+    ParsedCommand commands[MAX_BATCH_COMMANDS];
+};
+
+// Writes the name a command is sent by: the table name, e.g.
+// "SET_THRESHOLD", or for CMD_DEVICE_* the device's name from the sketch's
+// device table with its action, e.g. "LAMP_ON". Retired values (older
+// journal records) get their old names. Writes "" and returns false for a
+// value or device with no name. BATCH_ENTRY_BUFFER_SIZE fits any name.
+inline bool commandName(CommandType type, uint8_t device, const DeviceTable& devices, char* name, size_t size) {
+    const char* base = NULL;
+    const char* suffix = "";
+    if (type < CMD_SET_THRESHOLD) {
+        base = RETIRED_COMMAND_NAMES[type];
+    } else if (type >= CMD_DEVICE_ON && type <= CMD_DEVICE_TOGGLE) {
+        if (device < devices.count) {
+            base = devices.specs[device].name;
+            suffix = DEVICE_ACTION_SUFFIXES[type - CMD_DEVICE_ON];
+        }
+    } else {
+        for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+            if (COMMAND_SPECS[i].type == type) {
+                base = COMMAND_SPECS[i].name;
+            }
+        }
+    }
+
+    if (size == 0) {
+        return false;
+    }
+    name[0] = '\0';
+    if (base == NULL) {
+        return false;
+    }
+    strncat(name, base, size - 1);
+    strncat(name, suffix, size - 1 - strlen(name));
+    return true;
+}
+
+// --- Compile-time Perfect Hash ---
+// FNV-1a over the name, stopping at ':' so "SET_THRESHOLD:27.5" hashes like
+// "SET_THRESHOLD". Tail-recursive, so at runtime it compiles to a loop.
+constexpr uint32_t commandHash(const char* name, uint32_t hash) {
+    return (*name == '\0' || *name == ':') ? hash
+         : commandHash(name + 1, (hash ^ (uint8_t)*name) * 16777619UL);
+}
+
+// The top bits are used: FNV's low bits only depend on the low bits of the input
+constexpr uint8_t commandSlotOf(const char* name, uint32_t seed) {
+    return commandHash(name, 2166136261UL ^ seed) >> (32 - COMMAND_SLOT_BITS);
+}
+
+constexpr bool commandSlotClashes(uint32_t seed, uint8_t i, uint8_t j) {
+    return j >= COMMAND_COUNT ? false
+         : commandSlotOf(COMMAND_SPECS[i].name, seed) == commandSlotOf(COMMAND_SPECS[j].name, seed)
+           || commandSlotClashes(seed, i, j + 1);
+}
+
+constexpr bool commandSeedIsPerfect(uint32_t seed, uint8_t i) {
+    return i >= COMMAND_COUNT ? true
+         : !commandSlotClashes(seed, i, i + 1) && commandSeedIsPerfect(seed, i + 1);
+}
+
+constexpr uint32_t findCommandSeed(uint32_t seed) {
+    return (seed > 200 || commandSeedIsPerfect(seed, 0)) ? seed : findCommandSeed(seed + 1);
+}
+
+constexpr uint32_t COMMAND_HASH_SEED = findCommandSeed(0);
+static_assert(commandSeedIsPerfect(COMMAND_HASH_SEED, 0), "No collision-free seed; grow COMMAND_SLOTS");
+
+constexpr uint8_t commandNameLength(const char* name) {
+    return (*name == '\0' || *name == ':') ? 0 : 1 + commandNameLength(name + 1);
+}
+
+constexpr bool commandNamesFit(uint8_t i) {
+    return i >= COMMAND_COUNT ? true
+         : commandNameLength(COMMAND_SPECS[i].name) < COMMAND_NAME_SIZE && commandNamesFit(i + 1);
+}
+static_assert(commandNamesFit(0), "A command name does not fit COMMAND_NAME_SIZE");
+
+// Index into COMMAND_SPECS of the command hashed to a slot, or NO_COMMAND
+constexpr uint8_t commandAtSlot(uint8_t slot, uint8_t i) {
+    return i >= COMMAND_COUNT ? NO_COMMAND
+         : commandSlotOf(COMMAND_SPECS[i].name, COMMAND_HASH_SEED) == slot ? i
+         : commandAtSlot(slot, i + 1);
+}
+
+constexpr char commandNameChar(const char* name, int index) {
+    return *name == '\0' ? '\0' : index == 0 ? *name : commandNameChar(name + 1, index - 1);
+}
+
+// Slots hold the name inline so the whole table can live in flash
+struct CommandSlot {
+    char name[COMMAND_NAME_SIZE];   // Empty for unused slots
+    uint8_t type;
+    uint8_t arg;
+};
+
+template<int Slot, class Chars> struct CommandSlotBuilder;
+template<int Slot, int... Cs> struct CommandSlotBuilder<Slot, IndexList<Cs...> > {
+    static constexpr uint8_t spec = commandAtSlot(Slot, 0);
+    static constexpr CommandSlot make() {
+        return spec == NO_COMMAND ? CommandSlot{ { '\0' }, 0, 0 }
+             : CommandSlot{ { commandNameChar(COMMAND_SPECS[spec].name, Cs)... },
+                            COMMAND_SPECS[spec].type, COMMAND_SPECS[spec].arg };
+    }
+};
+
+template<class Slots> struct CommandSlotTable;
+template<int... Ss> struct CommandSlotTable<IndexList<Ss...> > {
+    static const CommandSlot slots[sizeof...(Ss)] PROGMEM;
+};
+template<int... Ss> const CommandSlot CommandSlotTable<IndexList<Ss...> >::slots[sizeof...(Ss)] PROGMEM = {
+    CommandSlotBuilder<Ss, MakeIndexList<COMMAND_NAME_SIZE>::type>::make()...
+};
+
+typedef CommandSlotTable<MakeIndexList<COMMAND_SLOTS>::type> CommandTable;
+
+// --- Runtime Lookup ---
+
+// Parses an ARG_CELSIUS argument; the whole text must be a number in range
+inline bool parseCelsiusArg(const char* text, CentiCelsius& value) {
+    CentiCelsius parsed;
+    if (!parseCentiCelsius(text, parsed) || parsed <= 0 || parsed >= 100 * 100) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// "<DEVICE>_<ACTION>" for an output of the device table; takes no argument
+inline CommandParseResult parseDeviceCommand(const char* action, uint8_t nameLength,
+                                             const DeviceTable& devices, ParsedCommand& command) {
+    uint8_t device;
+    DeviceAction deviceAction;
+    if (!findDeviceCommand(action, nameLength, devices, device, deviceAction)) {
+        return COMMAND_UNKNOWN;
+    }
+
+    command.type = (CommandType)(CMD_DEVICE_ON + deviceAction);
+    command.device = device;
+    command.value = 0;
+    return action[nameLength] == '\0' ? COMMAND_OK : COMMAND_BAD_ARG;
+}
+
+// Looks up "NAME" or "NAME:<arg>" (no leading '/') and validates the
+// argument. command is only meaningful when COMMAND_OK is returned.
+inline CommandParseResult parseCommand(const char* action, const DeviceTable& devices, ParsedCommand& command) {
+    uint8_t nameLength = commandNameLength(action);
+    if (nameLength == 0) {
+        return COMMAND_UNKNOWN;
+    }
+
+    const CommandSlot* slot = &CommandTable::slots[commandSlotOf(action, COMMAND_HASH_SEED)];
+    if (nameLength >= COMMAND_NAME_SIZE || strncmp_P(action, slot->name, nameLength) != 0
+        || pgm_read_byte(&slot->name[nameLength]) != '\0') {
+        return parseDeviceCommand(action, nameLength, devices, command);
+    }
+
+    command.type = (CommandType)pgm_read_byte(&slot->type);
+    command.device = 0;
+    command.value = 0;
+
+    const char* arg = action + nameLength;
+    bool argValid = false;
+    switch ((CommandArg)pgm_read_byte(&slot->arg)) {
+        case ARG_NONE:
+            argValid = (*arg == '\0');
+            break;
+        case ARG_CELSIUS:
+            argValid = (*arg == ':' && parseCelsiusArg(arg + 1, command.value));
+            break;
+        case ARG_LIST:
+            argValid = (*arg == ':' && arg[1] != '\0');
+            break;
+    }
+    return argValid ? COMMAND_OK : COMMAND_BAD_ARG;
+}
+
+// Parses "NAME[:arg]" as a batch of one, or
+// "BATCH:NAME[:arg],NAME[:arg],..." as up to MAX_BATCH_COMMANDS commands.
+// Every entry is validated before anything is returned, so a batch with one
+// bad entry comes back as COMMAND_BAD_ARG and none of it is applied.
+inline CommandParseResult parseCommandBatch(const char* action, const DeviceTable& devices, CommandBatch& batch) {
+    batch.count = 0;
+
+    CommandParseResult result = parseCommand(action, devices, batch.commands[0]);
+    if (result != COMMAND_OK || batch.commands[0].type != CMD_BATCH) {
+        batch.count = (result == COMMAND_OK) ? 1 : 0;
+        return result;
+    }
+
+    const char* entry = action + commandNameLength(action) + 1;
+    while (true) {
+        const char* entryEnd = strchr(entry, ',');
+        size_t entryLength = entryEnd ? (size_t)(entryEnd - entry) : strlen(entry);
+        if (entryLength == 0 || entryLength >= BATCH_ENTRY_BUFFER_SIZE || batch.count >= MAX_BATCH_COMMANDS) {
+            batch.count = 0;
+            return COMMAND_BAD_ARG;
+        }
+
+        char entryText[BATCH_ENTRY_BUFFER_SIZE];
+        memcpy(entryText, entry, entryLength);
+        entryText[entryLength] = '\0';
+
+        ParsedCommand& command = batch.commands[batch.count];
+        if (parseCommand(entryText, devices, command) != COMMAND_OK || command.type == CMD_BATCH) {
+            batch.count = 0;
+            return COMMAND_BAD_ARG;
+        }
+        batch.count++;
+
+        if (entryEnd == NULL) {
+            return COMMAND_OK;
+        }
+        entry = entryEnd + 1;
+    }
+}
@@ -0,0 +1,249 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Device Registry
+// ----------------------------------------------------
+// Included by both firmwares. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// Each sketch lists its relays and sensors once, in a constexpr DEVICE_SPECS
+// table indexed by its DeviceId enum. Pin setup, the relay commands
+// ("/<NAME>_ON", "_OFF", "_TOGGLE"), the status reply, /EVENTS deltas and
+// the binary frame flags are generated by walking the table, and on/off
+// state is kept one bit per device in DeviceBits. Relay commands find their
+// device through a perfect-hash index the compiler builds from the table
+// (DeviceNameIndex below). Adding a relay is one table row.
+
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "index_list.h"
+
+enum DeviceKind : uint8_t {
+    KIND_RELAY,           // Output switched by commands
+    KIND_ALARM,           // Output on while commanded on or while the temperature alarm holds
+    KIND_BINARY_SENSOR,   // Input with the internal pull-up, e.g. a reed switch to ground
+    KIND_ANALOG_SENSOR    // ADC input reported as a number: the sketch's NTC
+};
+
+struct DeviceSpec {
+    const char* name;      // Status field name and command prefix
+    uint8_t pin;
+    DeviceKind kind;
+    bool activeLow;        // The pin is LOW while the device is on
+    const char* onText;    // Status text of binary devices (NULL for analog)
+    const char* offText;
+};
+
+// A sketch's table with its name index, as passed to parseCommandBatch():
+//
+//   typedef DeviceNameIndex<DEVICE_SPECS, DEVICE_COUNT> DeviceIndex;
+//   const DeviceTable DEVICES = { DEVICE_SPECS, DEVICE_COUNT, DeviceIndex::slots, DeviceIndex::BITS, DeviceIndex::SEED };
+struct DeviceTable {
+    const DeviceSpec* specs;
+    uint8_t count;
+    const uint8_t* slots;    // In flash: device index by name hash
+    uint8_t slotBits;
+    uint32_t seed;
+};
+
+const uint8_t MAX_DEVICES = 32;
+const uint8_t STATUS_FRAME_FLAG_BITS = 8;  // Binary devices carried by the v1 frame
+
+// On/off state, one bit per device, indexed like the table
+template<uint8_t N> struct DeviceBits {
+    static_assert(N <= MAX_DEVICES, "Too many devices");
+    uint8_t bytes[(N + 7) / 8];
+
+    bool get(uint8_t device) const {
+        return (bytes[device >> 3] >> (device & 7)) & 1;
+    }
+
+    void set(uint8_t device, bool on) {
+        uint8_t mask = 1 << (device & 7);
+        bytes[device >> 3] = on ? (bytes[device >> 3] | mask) : (bytes[device >> 3] & ~mask);
+    }
+
+    bool operator==(const DeviceBits& other) const {
+        return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+
+    bool operator!=(const DeviceBits& other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr bool deviceIsOutput(const DeviceSpec& spec) {
+    return spec.kind == KIND_RELAY || spec.kind == KIND_ALARM;
+}
+
+inline bool deviceIsBinary(const DeviceSpec& spec) {
+    return spec.kind != KIND_ANALOG_SENSOR;
+}
+
+// Pin level that puts an output in the given state
+inline uint8_t deviceLevel(const DeviceSpec& spec, bool on) {
+    return on != spec.activeLow ? HIGH : LOW;
+}
+
+// State of an input at the given pin level
+inline bool deviceOnAtLevel(const DeviceSpec& spec, int level) {
+    return (level == HIGH) != spec.activeLow;
+}
+
+inline const char* deviceStateText(const DeviceSpec& spec, bool on) {
+    return on ? spec.onText : spec.offText;
+}
+
+// --- Commands ---
+// Every output accepts "<NAME>_ON", "<NAME>_OFF" and "<NAME>_TOGGLE"
+enum DeviceAction : uint8_t {
+    DEVICE_ON,
+    DEVICE_OFF,
+    DEVICE_TOGGLE,
+    DEVICE_ACTION_COUNT
+};
+
+const char* const DEVICE_ACTION_SUFFIXES[DEVICE_ACTION_COUNT] = { "_ON", "_OFF", "_TOGGLE" };
+
+// --- Device Name Index ---
+// Device commands are looked up like the fixed commands in command_table.h:
+// the compiler searches for a seed that gives every output's name its own
+// slot, so resolving "<NAME>_<ACTION>" is one hash of NAME, one table read
+// and one string compare, whatever the number of devices. The table has at
+// least eight slots per device, one byte each, so a seed is found within a
+// few tries even for MAX_DEVICES similar names.
+constexpr uint8_t NO_DEVICE = 0xFF;
+
+// FNV-1a over the first length characters. Tail-recursive, so at runtime
+// it compiles to a loop.
+constexpr uint32_t deviceNameHash(const char* name, uint8_t length, uint32_t hash) {
+    return length == 0 ? hash : deviceNameHash(name + 1, length - 1, (hash ^ (uint8_t)*name) * 16777619UL);
+}
+
+// FNV's top bits hardly depend on the low bits of the last character, so
+// names like "LIGHT0" and "LIGHT1" would share a slot whatever the seed. A
+// multiply-xorshift round (MurmurHash3's finalizer, in part) spreads every
+// bit before the top ones are taken.
+constexpr uint32_t deviceHashShift(uint32_t hash) {
+    return hash ^ (hash >> 13);
+}
+
+constexpr uint32_t deviceHashMix(uint32_t hash) {
+    return deviceHashShift((hash ^ (hash >> 16)) * 0x85EBCA6BUL);
+}
+
+constexpr uint8_t deviceSlotOf(const char* name, uint8_t length, uint32_t seed, uint8_t bits) {
+    return deviceHashMix(deviceNameHash(name, length, 2166136261UL ^ seed)) >> (32 - bits);
+}
+
+constexpr uint8_t deviceSlotBits(uint8_t count, uint8_t bits) {
+    return (1u << bits) >= 8u * count ? bits : deviceSlotBits(count, bits + 1);
+}
+
+constexpr uint8_t deviceTextLength(const char* text) {
+    return (text == NULL || *text == '\0') ? 0 : 1 + deviceTextLength(text + 1);
+}
+
+constexpr uint8_t deviceSpecSlot(const DeviceSpec& spec, uint32_t seed, uint8_t bits) {
+    return deviceSlotOf(spec.name, deviceTextLength(spec.name), seed, bits);
+}
+
+constexpr bool deviceSlotClashes(const DeviceSpec* specs, uint8_t count, uint32_t seed, uint8_t bits, uint8_t i, uint8_t j) {
+    return j >= count ? false
+         : (deviceIsOutput(specs[j]) && deviceSpecSlot(specs[i], seed, bits) == deviceSpecSlot(specs[j], seed, bits))
+           || deviceSlotClashes(specs, count, seed, bits, i, j + 1);
+}
+
+constexpr bool deviceSeedIsPerfect(const DeviceSpec* specs, uint8_t count, uint32_t seed, uint8_t bits, uint8_t i) {
+    return i >= count ? true
+         : (!deviceIsOutput(specs[i]) || !deviceSlotClashes(specs, count, seed, bits, i, i + 1))
+           && deviceSeedIsPerfect(specs, count, seed, bits, i + 1);
+}
+
+constexpr uint32_t findDeviceSeed(const DeviceSpec* specs, uint8_t count, uint8_t bits, uint32_t seed) {
+    return (seed > 200 || deviceSeedIsPerfect(specs, count, seed, bits, 0)) ? seed
+         : findDeviceSeed(specs, count, bits, seed + 1);
+}
+
+// Output hashed to a slot, or NO_DEVICE
+constexpr uint8_t deviceAtSlot(const DeviceSpec* specs, uint8_t count, uint32_t seed, uint8_t bits, uint8_t slot, uint8_t i) {
+    return i >= count ? NO_DEVICE
+         : deviceIsOutput(specs[i]) && deviceSpecSlot(specs[i], seed, bits) == slot ? i
+         : deviceAtSlot(specs, count, seed, bits, slot, i + 1);
+}
+
+template<const DeviceSpec* Specs, uint8_t Count, class Slots> struct DeviceSlotTable;
+template<const DeviceSpec* Specs, uint8_t Count, int... Ss> struct DeviceSlotTable<Specs, Count, IndexList<Ss...> > {
+    static constexpr uint8_t BITS = deviceSlotBits(Count, 3);
+    static constexpr uint32_t SEED = findDeviceSeed(Specs, Count, BITS, 0);
+    static_assert(Count <= MAX_DEVICES, "Too many devices");
+    static_assert(deviceSeedIsPerfect(Specs, Count, SEED, BITS, 0), "No collision-free seed for the device names");
+    static const uint8_t slots[sizeof...(Ss)] PROGMEM;
+};
+template<const DeviceSpec* Specs, uint8_t Count, int... Ss>
+const uint8_t DeviceSlotTable<Specs, Count, IndexList<Ss...> >::slots[sizeof...(Ss)] PROGMEM = {
+    deviceAtSlot(Specs, Count, SEED, BITS, Ss, 0)...
+};
+
+// The index of a sketch's DEVICE_SPECS, 2^BITS bytes of flash
+template<const DeviceSpec* Specs, uint8_t Count> struct DeviceNameIndex
+    : DeviceSlotTable<Specs, Count, typename MakeIndexList<1 << deviceSlotBits(Count, 3)>::type> {};
+
+// Resolves the first length characters of name as "<NAME>_<ACTION>" for an
+// output in the table: the suffix is one of three, and NAME goes through
+// the table's name index.
+inline bool findDeviceCommand(const char* name, uint8_t length, const DeviceTable& devices,
+                              uint8_t& device, DeviceAction& action) {
+    for (uint8_t a = 0; a < DEVICE_ACTION_COUNT; a++) {
+        uint8_t suffixLength = strlen(DEVICE_ACTION_SUFFIXES[a]);
+        if (length <= suffixLength || strncmp(name + length - suffixLength, DEVICE_ACTION_SUFFIXES[a], suffixLength) != 0) {
+            continue;
+        }
+
+        uint8_t nameLength = length - suffixLength;
+        uint8_t d = pgm_read_byte(&devices.slots[deviceSlotOf(name, nameLength, devices.seed, devices.slotBits)]);
+        if (d >= devices.count) {
+            return false;
+        }
+        const DeviceSpec& spec = devices.specs[d];
+        if (strncmp(name, spec.name, nameLength) != 0 || spec.name[nameLength] != '\0') {
+            return false;
+        }
+        device = d;
+        action = (DeviceAction)a;
+        return true;
+    }
+    return false;
+}
+
+// --- Compile-time Sizing ---
+const uint8_t DEVICE_ANALOG_TEXT_SIZE = 7;   // "-327.68"
+
+// ",NAME:" plus the longest value
+constexpr size_t deviceFieldLength(const DeviceSpec& spec) {
+    return 2 + deviceTextLength(spec.name)
+         + (spec.kind == KIND_ANALOG_SENSOR ? DEVICE_ANALOG_TEXT_SIZE
+            : deviceTextLength(spec.onText) > deviceTextLength(spec.offText) ? deviceTextLength(spec.onText)
+            : deviceTextLength(spec.offText));
+}
+
+// Longest "NAME:value,NAME:value,..." the table can produce (one comma extra)
+constexpr size_t deviceStatusLength(const DeviceSpec* specs, uint8_t count) {
+    return count == 0 ? 0 : deviceFieldLength(specs[0]) + deviceStatusLength(specs + 1, count - 1);
+}
+
+// Bit of a binary device in the status frame flags: its position among the
+// binary devices of the table
+constexpr uint8_t deviceFrameBit(const DeviceSpec* specs, uint8_t device) {
+    return device == 0 ? 0 : (specs[0].kind != KIND_ANALOG_SENSOR ? 1 : 0) + deviceFrameBit(specs + 1, device - 1);
+}
+
+constexpr uint8_t deviceCountOfKind(const DeviceSpec* specs, uint8_t count, DeviceKind kind) {
+    return count == 0 ? 0 : (specs[0].kind == kind ? 1 : 0) + deviceCountOfKind(specs + 1, count - 1, kind);
+}
+
+// Names must fit the command parser's buffer with the longest suffix
+constexpr bool deviceNamesFit(const DeviceSpec* specs, uint8_t count, uint8_t limit) {
+    return count == 0 ? true : deviceTextLength(specs[0].name) + 7 < limit && deviceNamesFit(specs + 1, count - 1, limit);
+}
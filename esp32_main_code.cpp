@@ -3,370 +3,2697 @@
 // ----------------------------------------------------
 // This code is converted from Arduino + ESP8266 module to native ESP32
 // The ESP32 has built-in Wi-Fi, so no external module is needed!
+// Hardware, network and RTOS access goes through board_hal.h, so the same
+// code also builds and runs on Linux (see CMakeLists.txt).
 
-#include <WiFi.h>
-#include <WebServer.h>
+#include "board_hal.h"
+#include <atomic>
+#include "device_registry.h"
+#include "command_table.h"
+#include "ntc_table.h"
+#include "status_frame.h"
+#include "spsc_ring.h"
+#include "event_journal.h"
+#include "metrics.h"
+#include "rules_engine.h"
+#include "udp_channel.h"
+#include "websocket.h"
+#include "serial_log.h"
+// The CMake build generates its own copy from web/; the IDE uses this one
+#ifdef SMART_HOME_WEB_ASSETS_H
+#include SMART_HOME_WEB_ASSETS_H
+#else
+#include "web_assets.h"
+#endif
 
 // --- Wi-Fi Configuration ---
 // !! CHANGE THESE TO YOUR NETWORK DETAILS !!
 const char* WIFI_SSID = "WE8B19F7";
 const char* WIFI_PASSWORD = "F707F21F";
 const int SERVER_PORT = 80;
+const char* TIMEZONE = "UTC0";   // POSIX TZ string for TIME in /RULES, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+
+// Uncomment to time the status serializer against the old String version at boot
+// #define BENCHMARK_STATUS_SERIALIZER
 
 // Create a WebServer on port 80
 WebServer server(SERVER_PORT);
 
-// --- Actuator/Sensor Pin Definitions (ESP32 GPIO) ---
-// Using ESP32-friendly pins that don't conflict with boot/flash
-const int LAMP_RELAY_PIN = 26;   // GPIO26 - safe output pin
-const int PLUG_RELAY_PIN = 27;   // GPIO27 - safe output pin
-const int DOOR_SENSOR_PIN = 14;  // GPIO14 - safe input with internal pullup
-const int BUZZER_PIN = 25;       // GPIO25 - safe output pin
+// --- Devices (ESP32 GPIO) ---
+// Using ESP32-friendly pins that don't conflict with boot/flash. The status
+// reply lists the devices in table order, and every relay or alarm row gets
+// /<NAME>_ON, /<NAME>_OFF and /<NAME>_TOGGLE (see device_registry.h).
+enum DeviceId : uint8_t {
+    DEVICE_TEMP,
+    DEVICE_DOOR,
+    DEVICE_LAMP,
+    DEVICE_PLUG,
+    DEVICE_ALARM,
+    DEVICE_COUNT
+};
+
+constexpr DeviceSpec DEVICE_SPECS[DEVICE_COUNT] = {
+    // name    pin  kind                activeLow  on       off
+    { "TEMP",  34, KIND_ANALOG_SENSOR, false,     NULL,    NULL     },  // GPIO34 (ADC1_CH6), see below
+    { "DOOR",  14, KIND_BINARY_SENSOR, false,     "OPEN",  "CLOSED" },  // GPIO14 - safe input with internal pullup
+    { "LAMP",  26, KIND_RELAY,         true,      "ON",    "OFF"    },  // GPIO26 - safe output pin
+    { "PLUG",  27, KIND_RELAY,         true,      "ON",    "OFF"    },  // GPIO27 - safe output pin
+    { "ALARM", 25, KIND_ALARM,         false,     "ALARM", "SAFE"   },  // GPIO25 - buzzer
+};
+
+typedef DeviceNameIndex<DEVICE_SPECS, DEVICE_COUNT> DeviceIndex;
+const DeviceTable DEVICES = { DEVICE_SPECS, DEVICE_COUNT, DeviceIndex::slots, DeviceIndex::BITS, DeviceIndex::SEED };
+
+static_assert(deviceCountOfKind(DEVICE_SPECS, DEVICE_COUNT, KIND_ANALOG_SENSOR) == 1, "TEMP is the only analog device");
+static_assert(deviceNamesFit(DEVICE_SPECS, DEVICE_COUNT, BATCH_ENTRY_BUFFER_SIZE), "A device name is too long for its commands");
+// The app decodes the v1 frame flags with these bits
+static_assert(deviceFrameBit(DEVICE_SPECS, DEVICE_DOOR) == 0 && deviceFrameBit(DEVICE_SPECS, DEVICE_LAMP) == 1
+              && deviceFrameBit(DEVICE_SPECS, DEVICE_PLUG) == 2 && deviceFrameBit(DEVICE_SPECS, DEVICE_ALARM) == 3,
+              "Frame flag order changed");
 
 // --- NTC Thermistor Configuration ---
 // ESP32 ADC1 pins: GPIO32, GPIO33, GPIO34, GPIO35, GPIO36, GPIO39
 // Note: ADC2 pins cannot be used when Wi-Fi is active!
 // !! IMPORTANT: Verify your NTC and resistor values !!
-const int NTC_PIN = 34;          // GPIO34 (ADC1_CH6)
-const float NOMINAL_RESISTANCE = 100000;    // 100k Ohm NTC (at 25°C) - CHANGE if your NTC is different!
-const float NOMINAL_TEMPERATURE = 25;       // 25C 
-const int BETA_COEFFICIENT = 3950;          // B-value for NTC
-const float REFERENCE_RESISTANCE = 100000;  // 100k Fixed resistor (confirmed by user)
-const int ADC_RESOLUTION = 4096;            // ESP32 has 12-bit ADC (0-4095)
+constexpr uint8_t NTC_PIN = DEVICE_SPECS[DEVICE_TEMP].pin;
+constexpr float NOMINAL_RESISTANCE = 100000;    // 100k Ohm NTC (at 25°C) - CHANGE if your NTC is different!
+constexpr float NOMINAL_TEMPERATURE = 25;       // 25C 
+constexpr int BETA_COEFFICIENT = 3950;          // B-value for NTC
+constexpr float REFERENCE_RESISTANCE = 100000;  // 100k Fixed resistor (confirmed by user)
+constexpr int ADC_RESOLUTION = 4096;            // ESP32 has 12-bit ADC (0-4095)
+
+// --- Compile-time NTC Lookup Table (ntc_table.h) ---
+// User's Circuit: 3.3V --- [100k Fixed Resistor] --- GPIO34 --- [NTC] --- GND
+struct NtcThermistor {
+    static constexpr int16_t centiCelsiusAt(int adc) {
+        return ntcBetaCentiCelsius(ntcResistanceToGround(adc, ADC_RESOLUTION, REFERENCE_RESISTANCE, NOMINAL_RESISTANCE),
+                                   NOMINAL_RESISTANCE, NOMINAL_TEMPERATURE, BETA_COEFFICIENT);
+    }
+};
+
+typedef NtcLookupTable<NtcThermistor, MakeIndexList<ADC_RESOLUTION>::type> NtcTable;
 
 // Alarm Settings (now settable from App)
 float alarmTempThreshold = 27.0;
 
 // --- State Variables ---
-bool lampRelayState = false;   // Current relay state (controlled by app)
-bool plugState = false;
-bool buzzerAppOverride = false;
-bool previousDoorState = true; // HIGH=CLOSED, LOW=OPEN
+// Owned by the control task; other code reads them through readDeviceSnapshot()
+DeviceBits<DEVICE_COUNT> devicesCommanded = {};  // Outputs as set by the app (ALARM: the override)
+DeviceBits<DEVICE_COUNT> devicesOn = {};         // Output pins and debounced binary inputs
+
+uint32_t loggedDoorEvents = 0; // Web task's view, for the door change log
 
 // Variables for managing status updates
 unsigned long lastStatusUpdateTime = 0;
 const unsigned long STATUS_REPORT_INTERVAL_MS = 5000; // Report status every 5 seconds
+constexpr size_t STATUS_BUFFER_SIZE = deviceStatusLength(DEVICE_SPECS, DEVICE_COUNT)
+                                   + sizeof(",THRESHOLD:") + DEVICE_ANALOG_TEXT_SIZE;
+
+// --- Conditional Status (/STATUS) ---
+// Every status reply carries "<boot nonce>-<stateVersion>" as its ETag. A
+// poll whose If-None-Match names the current one gets 304 without a body,
+// and /STATUS?since=<nonce>-<version> returns only the fields that changed
+// after that version. The version moves when a device, the threshold or
+// the reported temperature changes; the reported temperature follows the
+// filtered one in STATUS_TEMP_STEP_CENTI steps, so sensor noise does not
+// make every poll a full reply.
+//
+// The nonce is drawn at random on every boot, so a version seen before a
+// restart never matches one after it, even where the counters overlap: an
+// If-None-Match or since= from another boot gets the full status. Versions
+// themselves start at the journal's boot count << 16, so the binary
+// frame's sequence keeps increasing across restarts (without a journal it
+// restarts from 0).
+const int16_t STATUS_TEMP_STEP_CENTI = 10;          // 0.1 degrees C
+const uint8_t STATUS_FIELD_COUNT = DEVICE_COUNT + 1; // The devices, then THRESHOLD
+const size_t STATUS_ETAG_SIZE = 32;                  // "\"4294967295-4294967295.bin\"" + NUL
+
+// --- Serial Log ---
+// Messages go through serial_log.h. setup() writes each one out at once;
+// after that the web server task formats into serialLog and hands the UART
+// what fits in its driver buffer at the end of every pass.
+const uint16_t SERIAL_LOG_SIZE = 2048;
+const size_t SERIAL_TX_BUFFER_SIZE = 1024;   // UART driver ring, emptied by its interrupt
+
+SerialLog<SERIAL_LOG_SIZE> serialLog;
+
+// --- Door Sensor Interrupt ---
+// onDoorEdge() timestamps reed switch edges in the GPIO interrupt. The first
+// edge after a quiet period is queued at once; edges within DOOR_DEBOUNCE_US
+// of it are contact bounce and only update doorLastEdgeUs. The control task
+// drains the queue, and once the line has been quiet for the debounce time
+// it reads the pin once, which catches a pulse that ended inside the window.
+constexpr uint8_t DOOR_SENSOR_PIN = DEVICE_SPECS[DEVICE_DOOR].pin;
+const uint32_t DOOR_DEBOUNCE_US = 20000;
+const uint8_t DOOR_EVENT_RING_SIZE = 16;
+const uint8_t DOOR_EVENT_LOG_SIZE = 4;    // Recent events carried in the snapshot
+
+struct DoorEvent {
+    uint32_t atUs;   // micros() at the edge
+    bool level;      // Pin level after the edge (DEVICE_SPECS[DEVICE_DOOR] maps it to OPEN/CLOSED)
+};
+
+SpscRing<DoorEvent, DOOR_EVENT_RING_SIZE> doorEvents;  // ISR -> control task
+volatile uint32_t doorLastEdgeUs = 0;   // Every edge, bounce included
+uint32_t doorAcceptedEdgeUs = 0;        // ISR only: start of the debounce window
+
+// Control task only
+bool doorLevel = HIGH;
+uint32_t doorSettledEdgeUs = 0;         // Last edge the settled level was checked for
+DoorEvent doorEventLog[DOOR_EVENT_LOG_SIZE];
+uint32_t doorEventCount = 0;
+
+// --- Event Journal (/LOG) ---
+// Door, alarm and command events are kept in flash by event_journal.h. The
+// control task only queues them (flash writes stall both cores' caches);
+// the web server task appends them and writes a batch every
+// JOURNAL_FLUSH_INTERVAL_MS, or sooner once JOURNAL_BATCH_RECORDS are waiting.
+const uint8_t JOURNAL_QUEUE_SIZE = 32;
+const unsigned long JOURNAL_FLUSH_INTERVAL_MS = 10000;
+const size_t JOURNAL_CHUNK_SIZE = 512;   // /LOG lines are sent in chunks of up to this
+const size_t JOURNAL_LINE_SIZE = 64;     // "seq,boot,time_ms,EVENT,value\n" + NUL
+
+struct JournalEvent {
+    uint32_t atMs;
+    uint8_t type;      // JournalEventType
+    uint8_t detail;
+    int16_t value;
+};
+
+SpscRing<JournalEvent, JOURNAL_QUEUE_SIZE> journalQueue;  // Control task -> web server task
+
+BoardJournalStorage journalStorage;
+EventJournal journal(journalStorage);
+bool journalReady = false;
+unsigned long lastJournalFlushTime = 0;
+
+// --- Dual-core Task Layout ---
+// Core 1: controlTask samples the NTC every NTC_SAMPLE_PERIOD_MS and drives
+//         the buzzer. Between samples it blocks; a door edge or a queued
+//         command wakes it at once with a task notification. It is the only
+//         writer of device state and never touches Serial or the network.
+// Core 0: webServerTask serves HTTP, /EVENTS, /WS and serial reporting, next to
+//         the Wi-Fi stack. Handlers submit commands through commandQueue and
+//         read state from a seqlock snapshot, so a slow client cannot delay
+//         the alarm and the control task never blocks a response. Between
+//         passes it blocks until the control task publishes a change or the
+//         next WEB_POLL_INTERVAL_MS poll is due.
+//         udpTask, above it, blocks on the UDP socket and submits datagram
+//         commands the same way, so they never wait for a web server pass.
+// While both tasks are blocked the idle task can put the chip into light
+// sleep (boardEnableLightSleep()); TaskLoad tracks how often each wakes.
+const int NTC_RING_SIZE = 20;                      // Moving-average window (samples)
+const unsigned long NTC_SAMPLE_PERIOD_MS = 50;     // 20 x 50 ms = 1 s window
+const unsigned long WEB_POLL_INTERVAL_MS = 20;     // WebServer cannot wake the task on a new connection
+const unsigned long NTC_STALE_AFTER_MS = 1000;     // Snapshot older than this is stale
+const int COMMAND_QUEUE_LENGTH = 8;
+const unsigned long COMMAND_APPLY_TIMEOUT_MS = 50; // Handler wait for the control task
+
+// Each task that submits commands numbers them on its own, so tickets
+// stay in queue order per source
+enum CommandSource : uint8_t {
+    COMMAND_SOURCE_HTTP,   // webServerTask
+    COMMAND_SOURCE_UDP,    // udpTask
+    COMMAND_SOURCE_COUNT
+};
+
+// A /BATCH travels as one queue item, so the control task applies all of
+// it in the same pass and the relays switch together
+struct DeviceCommand {
+    CommandBatch batch;
+    uint32_t ticket;    // Increasing id per source; the snapshot reports the last one applied
+    uint32_t queuedUs;  // micros() at submission, for the wake latency metric
+    uint8_t source;     // CommandSource
+};
+
+struct DeviceSnapshot {
+    float temperatureC;        // Filtered temperature (interpolated from NtcTable)
+    int adcReading;            // Filtered (averaged) raw ADC value
+    unsigned long sampledAtMs; // millis() when the temperature was sampled
+    uint32_t doorEventCount;   // Door changes since boot
+    DoorEvent doorEventLog[DOOR_EVENT_LOG_SIZE];  // Latest changes, [count % size] is next
+    DeviceBits<DEVICE_COUNT> devicesOn;         // DOOR: debounced, ALARM: temp > threshold || override
+    DeviceBits<DEVICE_COUNT> devicesCommanded;
+    float threshold;
+    uint32_t commandsApplied[COMMAND_SOURCE_COUNT];  // Ticket of the last applied command, per source
+    int16_t statusTempCenti;   // Temperature in status replies, moved in STATUS_TEMP_STEP_CENTI steps
+    uint32_t stateVersion;     // Bumped whenever a status field changes
+    uint32_t fieldVersions[STATUS_FIELD_COUNT];  // stateVersion at each field's last change
+};
+
+int ntcRing[NTC_RING_SIZE];
+int ntcRingHead = 0;
+long ntcRingSum = 0;
+
+QueueHandle_t commandQueue = NULL;
+TaskHandle_t controlTaskHandle = NULL;
+TaskHandle_t webServerTaskHandle = NULL;
+TaskHandle_t udpTaskHandle = NULL;
+TaskHandle_t* const COMMAND_SOURCE_TASKS[COMMAND_SOURCE_COUNT] = { &webServerTaskHandle, &udpTaskHandle };
+uint32_t nextCommandTicket[COMMAND_SOURCE_COUNT] = { 1, 1 };  // Each written by its source's task only
+
+// Seqlock: the sequence is odd while the control task is writing. Readers
+// retry until they see the same even sequence before and after copying.
+std::atomic<uint32_t> snapshotSequence(0);
+DeviceSnapshot deviceSnapshot;
+StatusFrame publishedStatus;      // Control task only: last status behind stateVersion
+uint32_t statusBootNonce = 0;     // Set once in setup(): tells this boot's versions from others
+bool statusPublished = false;     // Control task only: publishedStatus is set
+
+// Worst-case timings measured by the control task (microseconds)
+volatile uint32_t worstControlLatenessUs = 0; // Woke up later than scheduled
+volatile uint32_t worstAlarmReactionUs = 0;   // Sample deadline (or command wake) -> buzzer write on an alarm edge
+
+// Time a task spends awake, for the duty cycle in reportStatus()
+struct TaskLoad {
+    volatile uint32_t busyUs;    // Written by the task itself; wraps, so read differences
+    volatile uint32_t wakeups;
+    uint32_t reportedBusyUs;     // Web server task: values at the last report
+    uint32_t reportedWakeups;
+    float duty;                  // Fraction of the last report interval spent awake
+    float wakeupsPerS;
+};
+
+TaskLoad controlLoad;
+TaskLoad webServerLoad;
+int64_t lastLoadReportUs = 0;
+
+// --- Server-Sent Events (/EVENTS) ---
+// Subscribers keep one connection open. They get a full status on connect,
+// then only the fields that changed, plus a heartbeat comment.
+const int MAX_EVENT_SUBSCRIBERS = 4;
+const unsigned long EVENT_HEARTBEAT_INTERVAL_MS = 15000;
+const float EVENT_TEMP_DEADBAND = 0.2;   // Push TEMP only when it moves at least this far (°C)
+
+WiFiClient eventSubscribers[MAX_EVENT_SUBSCRIBERS];
+unsigned long lastEventHeartbeatTime = 0;
+
+// Last values pushed to subscribers, used to compute deltas
+float eventTemp = 0;
+DeviceBits<DEVICE_COUNT> eventDevicesOn = {};
+float eventThreshold = 0;
+
+// --- WebSocket Commands (/WS) ---
+// A client upgrades GET /WS once and keeps the connection for its session.
+// It sends commands as text frames, written as in the URL path without the
+// '/' ("LAMP_TOGGLE", "BATCH:LAMP_ON,PLUG_OFF"), and gets a text frame back
+// for each: OK, BUSY, BAD_ARG or UNKNOWN, or the full status for STATUS.
+// Like /EVENTS subscribers it gets the full status on connect, then every
+// change as the same "FIELD:VALUE,..." delta; a reply never contains ':'.
+// Frames are read into a fixed buffer per client in the web server task.
+const int MAX_WEBSOCKET_CLIENTS = 4;
+const size_t WEBSOCKET_MESSAGE_SIZE = 128;   // Longest command frame accepted (payload)
+
+struct WebSocketClient {
+    WiFiClient client;
+    uint8_t buffer[WEBSOCKET_CLIENT_HEADER_MAX + WEBSOCKET_MESSAGE_SIZE + 1];  // One frame, and a NUL
+    size_t length;         // Bytes of buffer in use
+};
+
+WebSocketClient webSocketClients[MAX_WEBSOCKET_CLIENTS];
+
+// --- Temperature History (/HISTORY) ---
+// The web server task records the filtered temperature once a second into
+// three fixed rings, so the history uses the same ~14 KB from boot on:
+//   1 s samples for 10 minutes, 1 min min/avg/max for a day, 1 h for 30 days.
+// Every second also feeds a minute and an hour accumulator; a bucket is
+// pushed into its ring when the next one starts. Times are seconds of uptime.
+const uint16_t HISTORY_RAW_POINTS = 600;       // 10 min of 1 s samples
+const uint16_t HISTORY_MINUTE_POINTS = 1440;   // 1 day of 1 min buckets
+const uint16_t HISTORY_HOUR_POINTS = 720;      // 30 days of 1 h buckets
+const uint32_t HISTORY_MINUTE_S = 60;
+const uint32_t HISTORY_HOUR_S = 3600;
+const size_t HISTORY_CHUNK_SIZE = 512;         // Response lines are sent in chunks of up to this
+const size_t HISTORY_LINE_SIZE = 40;           // "4294967295,-327.68,-327.68,-327.68\n" + NUL
+
+struct HistoryPoint {
+    int16_t minCenti;
+    int16_t avgCenti;
+    int16_t maxCenti;
+};
+
+// Consecutive buckets, newest last. Bucket numbers are implied by position,
+// so no timestamps are stored.
+template<class T, uint16_t N> struct HistoryRing {
+    T points[N];
+    uint16_t count;
+    uint16_t next;
+    uint32_t newestBucket;
+
+    void push(uint32_t bucket, const T& point) {
+        points[next] = point;
+        next = (next + 1) % N;
+        if (count < N) {
+            count++;
+        }
+        newestBucket = bucket;
+    }
+
+    uint32_t oldestBucket() const {
+        return newestBucket + 1 - count;
+    }
+
+    // bucket must be within [oldestBucket(), newestBucket]
+    const T& at(uint32_t bucket) const {
+        return points[(next + N - 1 - (newestBucket - bucket)) % N];
+    }
+};
+
+// Min/avg/max of the bucket currently being filled
+struct HistoryAccumulator {
+    uint32_t bucket;
+    int32_t sumCenti;
+    uint16_t samples;
+    int16_t minCenti;
+    int16_t maxCenti;
+
+    // Adds a sample to bucket. Returns true, with the finished point, when
+    // this sample starts a new bucket.
+    bool add(uint32_t sampleBucket, int16_t centi, HistoryPoint& finished) {
+        bool rolled = samples > 0 && sampleBucket != bucket;
+        if (rolled) {
+            finished = point();
+        }
+        if (rolled || samples == 0) {
+            bucket = sampleBucket;
+            sumCenti = 0;
+            samples = 0;
+            minCenti = centi;
+            maxCenti = centi;
+        }
+
+        sumCenti += centi;
+        samples++;
+        if (centi < minCenti) minCenti = centi;
+        if (centi > maxCenti) maxCenti = centi;
+        return rolled;
+    }
+
+    HistoryPoint point() const {
+        HistoryPoint result = { minCenti, (int16_t)(sumCenti / (int32_t)samples), maxCenti };
+        return result;
+    }
+};
+
+// Web server task only
+HistoryRing<int16_t, HISTORY_RAW_POINTS> historySeconds;
+HistoryRing<HistoryPoint, HISTORY_MINUTE_POINTS> historyMinutes;
+HistoryRing<HistoryPoint, HISTORY_HOUR_POINTS> historyHours;
+HistoryAccumulator minuteAccumulator;
+HistoryAccumulator hourAccumulator;
+
+// --- Metrics (/METRICS) ---
+// Per-phase and per-route latency histograms (metrics.h), timed with the
+// CPU cycle counter and served in Prometheus text format, plus how long
+// the control task takes to react to a door edge or a command. With
+// METRICS_ENABLED false the tables are empty, every MetricsScope folds away
+// and /METRICS is not registered.
+constexpr bool METRICS_ENABLED = true;
+const size_t METRICS_CHUNK_SIZE = 512;   // /METRICS lines are sent in chunks of up to this
+const size_t METRICS_LINE_SIZE = 112;    // Longest bucket line + NUL
+
+enum Metric : uint8_t {
+    // Phases of the two task loops
+    METRIC_HANDLE_CLIENT,    // Web task: server.handleClient(), including the handler
+    METRIC_JOURNAL,          // Web task: serviceJournal(), including flash writes
+    METRIC_SERIAL_REPORT,    // Web task: reportStatus()
+    METRIC_NTC_SAMPLE,       // Control task: ADC read and filter
+    METRIC_RULES,            // Control task: /RULES evaluation and the commands it fires
+    METRIC_ALARM,            // Control task: threshold check and buzzer
+    // Wake-up latency of the control task
+    METRIC_WAKE_DOOR,        // Door edge interrupt -> edge applied
+    METRIC_WAKE_COMMAND,     // Command queued -> applied
+    // Requests, by route
+    METRIC_ROUTE_ASSET,      // The control page and its files (web_assets.h)
+    METRIC_ROUTE_STATUS,     // /STATUS and /STATUS.bin
+    METRIC_ROUTE_COMMAND,    // Relay, alarm, threshold and /BATCH commands
+    METRIC_ROUTE_EVENTS,     // /EVENTS connect only
+    METRIC_ROUTE_HISTORY,
+    METRIC_ROUTE_LOG,
+    METRIC_ROUTE_RULES,
+    METRIC_ROUTE_METRICS,
+    METRIC_ROUTE_UDP,        // Datagrams on the UDP command channel
+    METRIC_ROUTE_WEBSOCKET,  // /WS upgrades and command frames
+    METRIC_ROUTE_BAD_REQUEST,
+    METRIC_ROUTE_NOT_FOUND,
+    METRIC_COUNT
+};
+
+// Each group is one Prometheus histogram; its metrics are told apart by label
+struct MetricGroup {
+    uint8_t first;       // First Metric of the group; it runs to the next group
+    const char* name;
+    const char* label;
+};
+
+const uint8_t METRIC_GROUP_COUNT = 3;
+const MetricGroup METRIC_GROUPS[METRIC_GROUP_COUNT] = {
+    { METRIC_HANDLE_CLIENT, "smart_home_phase_duration_seconds", "phase" },
+    { METRIC_WAKE_DOOR, "smart_home_wake_latency_seconds", "source" },
+    { METRIC_ROUTE_ASSET, "smart_home_request_duration_seconds", "route" },
+};
+
+const char* const METRIC_LABELS[METRIC_COUNT] = {
+    "handle_client", "journal", "serial_report", "ntc_sample", "rules", "alarm",
+    "door", "command",
+    "asset", "status", "command", "events", "history", "log", "rules", "metrics", "udp", "websocket", "bad_request", "not_found"
+};
+
+// Each histogram has one writer, as its seqlock requires: control task
+// phases and wake latencies are written there, the udp route in udpTask,
+// everything else in the web server task. Under light sleep the CPU clock
+// scales between 80 and 240 MHz, so a scope that spans a frequency change is
+// converted at the frequency at its end.
+MetricsTable<METRICS_ENABLED, METRIC_COUNT> metrics;
+volatile int64_t firstRequestUs = 0;   // Uptime when the first request on any route was answered; 0: none yet
+
+// Records the time from construction to destruction under metric. A
+// handler can move its request to another route by changing metric.
+struct MetricsScope {
+    uint8_t metric;
+    uint32_t startCycles;
+
+    explicit MetricsScope(uint8_t metric)
+        : metric(metric), startCycles(METRICS_ENABLED ? boardCycleCount() : 0) {}
+
+    ~MetricsScope() {
+        if (METRICS_ENABLED) {
+            metrics.record(metric, (boardCycleCount() - startCycles) / boardCyclesPerUs());
+        }
+        if (metric >= METRIC_ROUTE_ASSET && firstRequestUs == 0) {
+            firstRequestUs = boardUptimeUs();   // Boot to first served request, for /METRICS
+        }
+    }
+};
+
+// --- Local Automation Rules (/RULES) ---
+// POST /RULES compiles rule text (rules_engine.h) into the spare one of two
+// rule sets, stores it in NVS and hands it to the control task, which swaps
+// it in on its next pass. The control task evaluates the active set on
+// every pass in which an operand changed, so a rule on the door reacts in
+// the same pass that applies the edge, without a round trip to the app.
+const uint16_t MAX_RULES = 128;             // Rule actions (one per action of each rule)
+const uint16_t MAX_RULE_CONDITIONS = 256;
+const uint8_t RULE_CHAIN_PASSES = 4;        // Re-evaluations after rules switched outputs
+const uint8_t RULE_FIRINGS_PER_PASS = 16;
+const size_t RULES_SOURCE_LIMIT = 8192;     // Longest accepted POST body
+const size_t RULES_CHUNK_SIZE = 1024;       // /RULES lines are sent in chunks of up to this
+const size_t RULES_LINE_SIZE = 416;         // Longest rule line (RULE_*_PER_RULE, 16-character names) + NUL
+const char* RULES_SETTING_KEY = "rules";
+
+typedef RuleSet<MAX_RULES, MAX_RULE_CONDITIONS> DeviceRules;
+
+DeviceRules ruleSets[2];
+std::atomic<uint8_t> activeRules(0);        // Index in ruleSets the control task evaluates
+std::atomic<bool> rulesPending(false);      // The other set holds new rules to swap in
+int16_t ruleFacts[RULE_OPERAND_COUNT];      // Control task: operands at the last evaluation
+
+// --- UDP Command Channel ---
+// udpTask answers udp_channel.h datagrams: commands, with the resulting
+// status in the reply, and discovery probes. It blocks in the socket between
+// datagrams and talks to the control task like the HTTP handlers do.
+const char UDP_DEVICE_NAME[] = "ESP32 Smart Home";   // Sent in discovery replies
+static_assert(sizeof(UDP_DEVICE_NAME) - 1 <= UDP_REPLY_SIZE - UDP_REPLY_HEADER_SIZE - STATUS_FRAME_SIZE,
+              "UDP_DEVICE_NAME does not fit the discovery reply");
+
+int udpSocket = -1;
+UdpClientTable udpClients = {};   // udpTask only
+
+// --- Wi-Fi Supervisor ---
+// setup() only starts connecting; serviceWiFi() in the web server task
+// follows the link from there without blocking, so sensing and the alarm
+// never wait for Wi-Fi and the HTTP and UDP sockets are open before it is
+// up. The access point (BSSID, channel) and IP lease of the last good
+// connection are kept in NVS: a connect first tries them directly, which
+// skips the scan and DHCP, and falls back to a full scan if that does not
+// come up in WIFI_FAST_CONNECT_TIMEOUT_MS. A failed or lost connection is
+// retried after a backoff that doubles up to WIFI_BACKOFF_MAX_MS. Reusing
+// the lease as a static address assumes the router keeps it for the
+// device (a DHCP reservation makes that certain).
+const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+const unsigned long WIFI_SCAN_CONNECT_TIMEOUT_MS = 15000;
+const unsigned long WIFI_BACKOFF_MIN_MS = 1000;
+const unsigned long WIFI_BACKOFF_MAX_MS = 60000;
+const char* WIFI_LINK_SETTING_KEY = "wifi_link";
+
+enum WiFiPhase : uint8_t {
+    WIFI_FAST_CONNECT,   // Joining the cached access point with the cached lease
+    WIFI_SCAN_CONNECT,   // Scan and DHCP
+    WIFI_UP,
+    WIFI_BACKOFF         // Waiting to try again
+};
+
+WiFiPhase wifiPhase = WIFI_SCAN_CONNECT;   // Web server task only, like the rest of this section
+unsigned long wifiPhaseStartMs = 0;
+unsigned long wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+int64_t wifiAttemptStartUs = 0;     // First try of the current connect, fast or scan
+BoardWiFiLink wifiLink;             // Cached link, valid if wifiLinkCached
+bool wifiLinkCached = false;
+bool wifiEverConnected = false;
+uint32_t wifiConnectMs = 0;         // Duration of the last successful connect
+uint32_t wifiReconnects = 0;        // Links lost since boot
 
 
 // --- Function Prototypes ---
+void registerRoutes();
+void startControlTask();
+void controlTask(void* parameter);
+void applyCommand(const DeviceCommand& command);
+void applyStateChange(const ParsedCommand& command);
+TickType_t controlWaitTicks(int64_t sampleDueUs);
+void writeDeviceOutputs();
+void pollBinarySensors();
+bool publishDeviceSnapshot(float temperatureC, int filteredAdc, unsigned long sampledAtMs, const uint32_t* commandsApplied);
+void onDoorEdge();
+void serviceDoorEvents(bool checkPin);
+void recordDoorEvent(const DoorEvent& event);
+void logDoorEvents(const DeviceSnapshot& snapshot);
+void startJournal();
+void queueJournalEvent(uint8_t type, uint8_t detail, int16_t value);
+void serviceJournal();
+void webServerTask(void* parameter);
+void reportStatus();
+void updateTaskLoad(TaskLoad& load, uint32_t intervalUs);
+int16_t ntcCentiCelsiusFromSum(long adcSum, int count);
+DeviceSnapshot readDeviceSnapshot();
 float readNTC();
-String sendCurrentStatus(float temp, bool doorSensorReading);
-void handleRoot();
-void handleLampOn();
-void handleLampOff();
-void handleLampToggle();
-void handlePlugOn();
-void handlePlugOff();
-void handleSetThreshold();
-void handleAlarmOn();
-void handleAlarmOff();
-void handleStatus();
+unsigned long ntcSampleAgeMs();
+bool submitCommands(const CommandBatch& batch, uint8_t source);
+size_t appendStatusVersion(char* buffer, size_t capacity, size_t length, uint32_t version);
+bool parseStatusVersion(const char* text, uint32_t& version, bool& thisBoot);
+size_t formatStatusETag(char* etag, size_t capacity, uint32_t version, bool asFrame);
+void sendStatusHeaders(const DeviceSnapshot& snapshot, bool asFrame);
+void sendStatusReply(const DeviceSnapshot& snapshot, bool asFrame);
+void sendStatusPoll(bool asFrame);
+bool acceptsStatusFrame();
+StatusFrame statusFrameOf(const DeviceSnapshot& snapshot);
+void sendBusyReply();
+size_t appendText(char* buffer, size_t capacity, size_t length, const char* text);
+size_t appendFixedPoint(char* buffer, size_t capacity, size_t length, long scaled, uint8_t decimals);
+size_t appendUnsigned(char* buffer, size_t capacity, size_t length, uint32_t value);
+long toScaled(float value, long scale);
+size_t appendStatusField(char* buffer, size_t bufferSize, size_t length, const DeviceSnapshot& snapshot, uint8_t field);
+size_t sendCurrentStatus(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot);
+size_t sendStatusChanges(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot, uint32_t since);
+#ifdef BENCHMARK_STATUS_SERIALIZER
+void benchmarkStatusSerializer();
+#endif
+void handleWebAsset();
+void handleCommand(const char* path, const CommandBatch& batch);
 void handleNotFound();
+void handleEvents();
 void addCORSHeaders();
+int countEventSubscribers();
+size_t formatEventDelta(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot);
+bool writeEvent(WiFiClient& client, const char* data, size_t length);
+void serviceEventSubscribers(const DeviceSnapshot& snapshot);
+void handleWebSocket();
+int countWebSocketClients();
+bool writeWebSocketFrame(WiFiClient& client, uint8_t opcode, const uint8_t* data, size_t length);
+void closeWebSocket(WebSocketClient& socket, uint16_t code);
+void serviceWebSocketClients();
+void handleWebSocketMessage(WebSocketClient& socket, char* message);
+uint32_t uptimeSeconds();
+void recordHistory(const DeviceSnapshot& snapshot);
+void recordHistorySecond(uint32_t second, int16_t centi);
+bool historyBounds(uint32_t resolution, uint32_t& oldest, uint32_t& newest);
+HistoryPoint historyPointAt(uint32_t resolution, uint32_t bucket);
+bool parseHistoryTime(const char* name, uint32_t now, uint32_t fallback, uint32_t& value);
+size_t appendHistoryLine(char* buffer, size_t capacity, size_t length, uint32_t second, const HistoryPoint& point);
+void handleHistory();
+size_t appendJournalLine(char* buffer, size_t capacity, size_t length, const JournalRecord& record);
+void handleLog();
+void loadRules();
+void serviceRules(float temperatureC);
+size_t appendRuleLine(char* buffer, size_t capacity, size_t length, const DeviceRules& rules, uint16_t first, uint16_t last);
+void sendRuleList(const DeviceRules& rules);
+void handleRules();
+void udpTask(void* parameter);
+size_t handleUdpRequest(uint8_t* datagram, size_t length, const BoardUdpPeer& peer, uint8_t* reply, size_t capacity);
+size_t appendMicrosAsSeconds(char* buffer, size_t capacity, size_t length, uint64_t us);
+size_t appendMetricLine(char* buffer, size_t capacity, size_t length, const MetricGroup& group, const char* suffix, uint8_t metric, const char* le, const char* value);
+void handleMetrics();
+void startWiFi();
+void beginWiFiConnect(bool cached);
+void serviceWiFi();
+void onWiFiConnected();
 
 
 void setup() {
-    Serial.begin(115200);  // ESP32 native baud rate
+    boardSerialBegin(115200, SERIAL_TX_BUFFER_SIZE);  // ESP32 native baud rate
     delay(1000);           // Give serial time to initialize
     
-    Serial.println("\n\n============================================");
-    Serial.println("Smart Home Prototype - ESP32 Version");
-    Serial.println("============================================\n");
-
-    // Initialize Actuator Pins and set them OFF (HIGH for Active LOW relays)
-    pinMode(LAMP_RELAY_PIN, OUTPUT);
-    pinMode(PLUG_RELAY_PIN, OUTPUT);
-    pinMode(BUZZER_PIN, OUTPUT);
-    digitalWrite(LAMP_RELAY_PIN, HIGH);   // Relay OFF (Active LOW)
-    digitalWrite(PLUG_RELAY_PIN, HIGH);   // Relay OFF (Active LOW)
-    digitalWrite(BUZZER_PIN, LOW);        // Buzzer OFF
-
-    // Initialize Sensor Pins
-    pinMode(DOOR_SENSOR_PIN, INPUT_PULLUP);
-    previousDoorState = digitalRead(DOOR_SENSOR_PIN);
-
-    // Configure ADC for NTC reading
-    analogReadResolution(12);  // 12-bit resolution (0-4095)
-    analogSetAttenuation(ADC_11db);  // Full 3.3V range
-
-    Serial.println("Connecting to Wi-Fi...");
-    
-    // Connect to Wi-Fi
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+    LOG_INFO("\n\n============================================");
+    LOG_INFO("Smart Home Prototype - ESP32 Version");
+    LOG_INFO("============================================\n");
+
+    // Outputs start OFF (HIGH for Active LOW relays), binary sensors get the pull-up
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (deviceIsOutput(spec)) {
+            pinMode(spec.pin, OUTPUT);
+            digitalWrite(spec.pin, deviceLevel(spec, false));
+        } else if (spec.kind == KIND_BINARY_SENSOR) {
+            pinMode(spec.pin, INPUT_PULLUP);
+        }
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\n\n=== WI-FI CONNECTED SUCCESSFULLY! ===");
-        Serial.print(">>> YOUR IP ADDRESS: ");
-        Serial.println(WiFi.localIP());
-        Serial.println("=====================================\n");
-    } else {
-        Serial.println("\n\n!!! FAILED TO CONNECT TO WI-FI !!!");
-        Serial.println("Check your SSID and password.");
-        Serial.println("Restarting in 5 seconds...");
-        delay(5000);
-        ESP.restart();
-    }
-
-    // Setup HTTP Server Routes
-    server.on("/", handleRoot);
-    server.on("/LAMP_ON", handleLampOn);
-    server.on("/LAMP_OFF", handleLampOff);
-    server.on("/LAMP_TOGGLE", handleLampToggle);
-    server.on("/PLUG_ON", handlePlugOn);
-    server.on("/PLUG_OFF", handlePlugOff);
-    server.on("/ALARM_ON", handleAlarmOn);
-    server.on("/ALARM_OFF", handleAlarmOff);
-    server.on("/STATUS", handleStatus);
-    server.onNotFound(handleNotFound);
-
-    // Start the server
+
+    // Configure ADC for NTC reading: 12-bit (0-4095), full 3.3V range
+    boardConfigureAdc();
+
+    // Before the control task, so the boot record comes first
+    startJournal();
+
+    // Sensing and the alarm run from here on, even while Wi-Fi connects
+    startControlTask();
+
+    // Connect to Wi-Fi; the web server task follows it up from here
+    startWiFi();
+
+    // Setup HTTP Server Routes, then start the server
+    registerRoutes();
     server.begin();
-    Serial.println("HTTP Server Started!");
-    Serial.print("Access the device at: http://");
-    Serial.println(WiFi.localIP());
+    LOG_INFO("HTTP Server Started!");
+
+    // Datagram commands and discovery; core 0, above the web server task so
+    // a datagram never waits for an HTTP pass
+    udpSocket = boardUdpOpen(UDP_COMMAND_PORT);
+    if (udpSocket >= 0) {
+        xTaskCreatePinnedToCore(udpTask, "udp", 4096, NULL, 2, &udpTaskHandle, 0);
+        LOG_INFO("UDP commands on port ", UDP_COMMAND_PORT);
+    } else {
+        LOG_WARN("UDP command channel unavailable");
+    }
+#ifdef BENCHMARK_STATUS_SERIALIZER
+    benchmarkStatusSerializer();
+#endif
+
+    // Both tasks block between events, so the chip can sleep in between
+    if (boardEnableLightSleep()) {
+        LOG_INFO("Automatic light sleep enabled, Wi-Fi in modem sleep");
+    } else {
+        LOG_INFO("Light sleep not available in this core build, Wi-Fi in modem sleep");
+    }
+
+    // From here on the web server task drains the log between passes
+    serialLog.blocking = false;
+
+    // Core 0, below the Wi-Fi/lwIP task priorities
+    xTaskCreatePinnedToCore(webServerTask, "webServer", 8192, NULL, 1, &webServerTaskHandle, 0);
 }
 
 void loop() {
-    // 1. Handle incoming HTTP requests
-    server.handleClient();
+    // All work happens in controlTask (core 1) and webServerTask (core 0)
+    vTaskDelete(NULL);
+}
 
-    // 2. Read Sensors
-    float currentTemp = readNTC();
-    bool currentDoorState = digitalRead(DOOR_SENSOR_PIN);
-    
-    // 3. Temperature Alarm Logic (using settable threshold)
-    bool shouldAlarm = currentTemp > alarmTempThreshold;
-    if (shouldAlarm || buzzerAppOverride) {
-        digitalWrite(BUZZER_PIN, HIGH); // Physical Alarm ON
-    } else {
-        digitalWrite(BUZZER_PIN, LOW);  // Physical Alarm OFF
+void registerRoutes() {
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        server.on(WEB_ASSETS[i].path, handleWebAsset);
     }
+    server.on("/EVENTS", handleEvents);
+    server.on("/WS", handleWebSocket);
+    server.on("/HISTORY", handleHistory);
+    server.on("/LOG", handleLog);
+    server.on("/RULES", handleRules);
+    if (METRICS_ENABLED) {
+        server.on("/METRICS", handleMetrics);
+    }
+    server.onNotFound(handleNotFound);  // Commands: looked up in command_table.h
+
+    // Request headers are dropped unless named here; Accept selects the
+    // status format, If-None-Match makes a poll or a page load conditional,
+    // the others are the /WS handshake
+    static const char* requestHeaders[] = { "Accept", "If-None-Match", "Upgrade", "Sec-WebSocket-Key", "Sec-WebSocket-Version" };
+    server.collectHeaders(requestHeaders, 5);
+}
+
+
+// --- Web Server Task (core 0) ---
+
+void webServerTask(void* parameter) {
+    (void)parameter;
+    for (;;) {
+        int64_t wakeUs = boardUptimeUs();
+        webServerLoad.wakeups++;
+
+        // 1. Handle incoming HTTP requests
+        {
+            MetricsScope scope(METRIC_HANDLE_CLIENT);
+            server.handleClient();
+        }
+
+        // 2. Follow the Wi-Fi link: finish a connect, or start a retry
+        serviceWiFi();
+
+        // 3. Commands from /WS clients
+        serviceWebSocketClients();
+
+        DeviceSnapshot snapshot = readDeviceSnapshot();
+
+        // 4. Door Status Change Alert: every edge the control task recorded
+        logDoorEvents(snapshot);
+
+        // 5. Push changed fields (door edges, relay commands, temperature) to /EVENTS and /WS clients
+        serviceEventSubscribers(snapshot);
+
+        // 6. Once a second, add the temperature to the /HISTORY rings
+        recordHistory(snapshot);
+
+        // 7. Move queued events into the flash journal
+        {
+            MetricsScope scope(METRIC_JOURNAL);
+            serviceJournal();
+        }
 
-    // 4. Door Status Change Alert (inverted: HIGH = OPEN, LOW = CLOSED for reed switch)
-    if (currentDoorState != previousDoorState) {
-        Serial.print(">>> DOOR STATUS CHANGE: ");
-        Serial.println((currentDoorState == HIGH) ? "OPENED" : "CLOSED");
-        previousDoorState = currentDoorState;
+        // 8. Periodic Status Reporting
+        if (millis() - lastStatusUpdateTime >= STATUS_REPORT_INTERVAL_MS) {
+            MetricsScope scope(METRIC_SERIAL_REPORT);
+            reportStatus();
+            lastStatusUpdateTime = millis();
+        }
+
+        // 9. Hand queued log lines to the UART, as much as it takes without waiting
+        serialLog.drain();
+
+        webServerLoad.busyUs += (uint32_t)(boardUptimeUs() - wakeUs);
+
+        // 10. Sleep until the control task publishes a change or the next poll is due
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WEB_POLL_INTERVAL_MS));
     }
+}
+
+void reportStatus() {
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+
+    LOG_INFO("STATUS UPDATE: ", logFloat(snapshot.temperatureC, 2),
+             " C. Door: ", deviceStateText(DEVICE_SPECS[DEVICE_DOOR], snapshot.devicesOn.get(DEVICE_DOOR)),
+             " | Threshold: ", logFloat(snapshot.threshold, 1), " C");
+
+    LOG_DEBUG("[DEBUG] Raw ADC: ", snapshot.adcReading, " / 4095, sample age: ", ntcSampleAgeMs(), " ms");
 
-    // 5. Periodic Status Reporting
-    if (millis() - lastStatusUpdateTime >= STATUS_REPORT_INTERVAL_MS) {
-        Serial.print("STATUS UPDATE: ");
-        Serial.print(currentTemp, 2);
-        Serial.print(" C. Door: ");
-        Serial.print((currentDoorState == HIGH) ? "OPENED" : "CLOSED");
-        Serial.print(" | Threshold: ");
-        Serial.print(alarmTempThreshold, 1);
-        Serial.println(" C");
+    // Worst cases since boot; run under HTTP load to see the effect of clients
+    LOG_INFO("[TIMING] Control task worst lateness: ", worstControlLatenessUs,
+             " us, worst alarm reaction: ", worstAlarmReactionUs,
+             " us, door events dropped: ", doorEvents.droppedCount(),
+             ", log lines dropped: ", serialLog.dropped);
 
-        lastStatusUpdateTime = millis();
+    // Awake time since the last report; the rest is idle, light sleep when enabled
+    int64_t nowUs = boardUptimeUs();
+    uint32_t intervalUs = (uint32_t)(nowUs - lastLoadReportUs);
+    lastLoadReportUs = nowUs;
+    updateTaskLoad(controlLoad, intervalUs);
+    updateTaskLoad(webServerLoad, intervalUs);
+    LOG_INFO("[POWER] Duty cycle: control ", logFloat(controlLoad.duty * 100, 2),
+             "% (", logFloat(controlLoad.wakeupsPerS, 1), " wakes/s), web server ",
+             logFloat(webServerLoad.duty * 100, 2), "% (", logFloat(webServerLoad.wakeupsPerS, 1), " wakes/s)");
+
+    LOG_INFO("[WIFI] ", wifiPhase == WIFI_UP ? "Up" : "Down", ", last connect: ", wifiConnectMs,
+             " ms, links lost: ", wifiReconnects, ", first request after boot: ", (uint32_t)(firstRequestUs / 1000), " ms");
+
+    if (journalReady) {
+        LOG_INFO("[JOURNAL] Next seq: ", journal.nextSequence(), ", boot: ", journal.bootCount(),
+                 ", dropped: ", journalQueue.droppedCount(), ", lost: ", journal.lostRecords());
     }
+}
 
-    delay(10);  // Small delay for stability
+void updateTaskLoad(TaskLoad& load, uint32_t intervalUs) {
+    uint32_t busyUs = load.busyUs;
+    uint32_t wakeups = load.wakeups;
+    if (intervalUs > 0) {
+        load.duty = (float)(busyUs - load.reportedBusyUs) / intervalUs;
+        load.wakeupsPerS = (float)(wakeups - load.reportedWakeups) * 1000000.0f / intervalUs;
+    }
+    load.reportedBusyUs = busyUs;
+    load.reportedWakeups = wakeups;
 }
 
+// Prints door changes published since the last call, oldest first
+void logDoorEvents(const DeviceSnapshot& snapshot) {
+    uint32_t pending = snapshot.doorEventCount - loggedDoorEvents;
+    if (pending > DOOR_EVENT_LOG_SIZE) {
+        LOG_WARN(">>> DOOR: ", pending - DOOR_EVENT_LOG_SIZE, " older changes not logged");
+        loggedDoorEvents = snapshot.doorEventCount - DOOR_EVENT_LOG_SIZE;
+    }
 
-// --- NTC Thermistor Function ---
-float readNTC() {
-    // 1. Read the raw ADC value (multiple samples for stability)
-    long adc_sum = 0;
-    const int NUM_SAMPLES = 20;
-    
-    for (int i = 0; i < NUM_SAMPLES; i++) {
-        adc_sum += analogRead(NTC_PIN);
-        delay(2);
-    }
-    int adc_reading = adc_sum / NUM_SAMPLES;
-
-    // Debug: Print raw ADC value occasionally
-    static unsigned long lastDebugTime = 0;
-    if (millis() - lastDebugTime > 5000) {
-        Serial.print("[DEBUG] Raw ADC: ");
-        Serial.print(adc_reading);
-        Serial.print(" / 4095");
-        lastDebugTime = millis();
-    }
-
-    // 2. Convert ADC reading to Resistance (R_thermistor)
-    // User's Circuit: 3.3V --- [100k Fixed Resistor] --- GPIO34 --- [NTC] --- GND
-    // NTC is on BOTTOM (between ADC pin and GND)
-    // Formula: R_ntc = R_ref × ADC / (ADC_max - ADC)
-    float resistance;
-    if (adc_reading <= 10) {
-        resistance = 100;  // Very low resistance (extremely hot) - avoid div by zero
-    } else if (adc_reading >= ADC_RESOLUTION - 10) {
-        resistance = NOMINAL_RESISTANCE * 100;  // Very high resistance (open circuit)
-    } else {
-        // NTC on BOTTOM of voltage divider - CORRECT formula for user's wiring
-        resistance = REFERENCE_RESISTANCE * ((float)adc_reading / (ADC_RESOLUTION - adc_reading));
+    while (loggedDoorEvents != snapshot.doorEventCount) {
+        const DoorEvent& event = snapshot.doorEventLog[loggedDoorEvents % DOOR_EVENT_LOG_SIZE];
+        const DeviceSpec& door = DEVICE_SPECS[DEVICE_DOOR];
+        LOG_INFO(">>> DOOR STATUS CHANGE: ", deviceStateText(door, deviceOnAtLevel(door, event.level)),
+                 " at ", event.atUs, " us");
+        loggedDoorEvents++;
     }
+}
+
 
-    // Debug: Print resistance
-    if (millis() - lastDebugTime < 100) {
-        Serial.print(", R = ");
-        Serial.print(resistance / 1000, 1);
-        Serial.println(" kOhm");
+// --- Event Journal Functions ---
+
+void startJournal() {
+    if (!journalStorage.begin("journal") && !journalStorage.begin("spiffs")) {
+        LOG_ERROR("!!! No journal partition, events will not be kept !!!");
+        return;
     }
 
-    // 3. Apply Steinhart-Hart Equation (Simplified Beta Model)
-    // 1/T = 1/T0 + (1/B) * ln(R/R0)
-    float steinhart;
-    steinhart = resistance / NOMINAL_RESISTANCE;     // (R/Ro)
-    steinhart = log(steinhart);                      // ln(R/Ro)
-    steinhart /= BETA_COEFFICIENT;                   // 1/B * ln(R/Ro)
-    steinhart += 1.0 / (NOMINAL_TEMPERATURE + 273.15); // + (1/To)
-    steinhart = 1.0 / steinhart;                     // Invert to get Kelvin
+    journalReady = journal.begin(millis());
+    LOG_INFO(journalReady ? "Event journal on partition '" : "!!! Event journal failed on partition '",
+             journalStorage.label(), "', ", journal.sectorCount(), " sectors, boot ", journal.bootCount());
+}
+
+// Control task only (single producer of journalQueue)
+void queueJournalEvent(uint8_t type, uint8_t detail, int16_t value) {
+    JournalEvent event = { (uint32_t)millis(), type, detail, value };
+    journalQueue.push(event);
+}
 
-    // 4. Convert to Celsius
-    float temp_C = steinhart - 273.15;
+// Web server task only: owns the journal and the flash writes
+void serviceJournal() {
+    JournalEvent event;
+    while (journalQueue.pop(event)) {
+        if (journalReady) {
+            journal.append(event.type, event.detail, event.value, event.atMs);
+        }
+    }
 
-    return temp_C;
+    if (journalReady && journal.pendingRecords() > 0
+        && millis() - lastJournalFlushTime >= JOURNAL_FLUSH_INTERVAL_MS) {
+        journal.flush();
+        lastJournalFlushTime = millis();
+    }
 }
 
 
-// --- HTTP Request Handler Functions ---
+// --- Control Task (core 1) ---
 
-void addCORSHeaders() {
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-    server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
+void startControlTask() {
+    // Prime the ring with one reading so the first snapshot is valid
+    int first = analogRead(NTC_PIN);
+    for (int i = 0; i < NTC_RING_SIZE; i++) {
+        ntcRing[i] = first;
+    }
+    ntcRingSum = (long)first * NTC_RING_SIZE;
+    doorLevel = digitalRead(DOOR_SENSOR_PIN);
+    devicesOn.set(DEVICE_DOOR, deviceOnAtLevel(DEVICE_SPECS[DEVICE_DOOR], doorLevel));
+    uint32_t noCommands[COMMAND_SOURCE_COUNT] = {};
+    statusBootNonce = boardRandom();
+    deviceSnapshot.stateVersion = (uint32_t)journal.bootCount() << 16;
+    publishDeviceSnapshot(NtcTable::centiC[first] / 100.0f, first, millis(), noCommands);
+
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(DeviceCommand));
+    loadRules();
+
+    // Above the web server task so HTTP work can never hold off the alarm.
+    // Created before the interrupt is attached, which notifies it.
+    xTaskCreatePinnedToCore(controlTask, "control", 4096, NULL, 3, &controlTaskHandle, 1);
+    attachInterrupt(digitalPinToInterrupt(DOOR_SENSOR_PIN), onDoorEdge, CHANGE);
 }
 
-void handleRoot() {
-    addCORSHeaders();
-    String html = "<html><head><title>ESP32 Smart Home</title></head>";
-    html += "<body><h1>ESP32 Smart Home Server</h1>";
-    html += "<p>IP Address: " + WiFi.localIP().toString() + "</p>";
-    html += "<p>Use /STATUS to get current status</p>";
-    html += "<p>Commands: /LAMP_ON, /LAMP_OFF, /LAMP_TOGGLE, /PLUG_ON, /PLUG_OFF, /ALARM_ON, /ALARM_OFF</p>";
-    html += "<p>Set threshold: /SET_THRESHOLD:XX.X</p>";
-    html += "</body></html>";
-    server.send(200, "text/html", html);
-}
-
-void handleLampOn() {
-    lampRelayState = true;
-    digitalWrite(LAMP_RELAY_PIN, LOW);  // Active LOW relay ON
-    Serial.println("> Command received: LAMP_ON");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+void controlTask(void* parameter) {
+    (void)parameter;
+    const int64_t periodUs = NTC_SAMPLE_PERIOD_MS * 1000;
+    int64_t scheduledUs = boardUptimeUs();   // Next sample deadline
+    float temp_C = readNTC();
+    unsigned long sampledAtMs = millis();
+    uint32_t commandsApplied[COMMAND_SOURCE_COUNT] = {};
+
+    for (;;) {
+        // Sleep until the next sample, or until a door edge or a command notifies us
+        ulTaskNotifyTake(pdTRUE, controlWaitTicks(scheduledUs));
+        int64_t wakeUs = boardUptimeUs();
+        controlLoad.wakeups++;
+
+        // 1. When a sample is due, push one raw sample into the ring, keeping a running sum
+        bool sampleDue = wakeUs >= scheduledUs;
+        if (sampleDue) {
+            uint32_t latenessUs = (uint32_t)(wakeUs - scheduledUs);
+            if (latenessUs > worstControlLatenessUs) {
+                worstControlLatenessUs = latenessUs;
+            }
+
+            MetricsScope scope(METRIC_NTC_SAMPLE);
+            int raw = analogRead(NTC_PIN);
+            ntcRingSum += raw - ntcRing[ntcRingHead];
+            ntcRing[ntcRingHead] = raw;
+            ntcRingHead = (ntcRingHead + 1) % NTC_RING_SIZE;
+            temp_C = ntcCentiCelsiusFromSum(ntcRingSum, NTC_RING_SIZE) / 100.0f;
+            sampledAtMs = millis();
+            pollBinarySensors();
+        }
+
+        // 2. Apply commands queued by the web server task
+        DeviceCommand command;
+        uint8_t appliedSources = 0;
+        while (xQueueReceive(commandQueue, &command, 0) == pdTRUE) {
+            metrics.record(METRIC_WAKE_COMMAND, (uint32_t)micros() - command.queuedUs);
+            applyCommand(command);
+            commandsApplied[command.source] = command.ticket;
+            appliedSources |= 1 << command.source;
+        }
+
+        // 3. Apply door edges queued by the interrupt; on a sample, also check the pin
+        serviceDoorEvents(sampleDue);
+
+        // 4. Local automation rules, on the state after steps 1-3
+        {
+            MetricsScope scope(METRIC_RULES);
+            serviceRules(temp_C);
+        }
+
+        // 5. Temperature Alarm Logic (using settable threshold), for every alarm output
+        {
+            MetricsScope scope(METRIC_ALARM);
+            for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+                const DeviceSpec& spec = DEVICE_SPECS[i];
+                if (spec.kind != KIND_ALARM) {
+                    continue;
+                }
+
+                bool shouldAlarm = temp_C > alarmTempThreshold || devicesCommanded.get(i);
+                if (shouldAlarm != devicesOn.get(i)) {
+                    digitalWrite(spec.pin, deviceLevel(spec, shouldAlarm));
+                    devicesOn.set(i, shouldAlarm);
+                    queueJournalEvent(JOURNAL_ALARM, devicesCommanded.get(i), shouldAlarm);
+
+                    int64_t reactedUs = boardUptimeUs();
+                    int64_t triggeredUs = sampleDue ? scheduledUs : wakeUs;
+                    uint32_t reactionUs = (uint32_t)(reactedUs - triggeredUs);
+                    if (reactionUs > worstAlarmReactionUs) {
+                        worstAlarmReactionUs = reactionUs;
+                    }
+                }
+            }
+        }
+
+        // 6. Publish the new state, waking the web server task if it changed
+        //    and every task whose commands were applied
+        bool changed = publishDeviceSnapshot(temp_C, ntcRingSum / NTC_RING_SIZE, sampledAtMs, commandsApplied);
+        if (changed) {
+            appliedSources |= 1 << COMMAND_SOURCE_HTTP;
+        }
+        for (uint8_t source = 0; source < COMMAND_SOURCE_COUNT; source++) {
+            TaskHandle_t task = *COMMAND_SOURCE_TASKS[source];
+            if ((appliedSources & (1 << source)) && task != NULL) {
+                xTaskNotifyGive(task);
+            }
+        }
+
+        if (sampleDue) {
+            scheduledUs += periodUs;
+            if (scheduledUs <= wakeUs) {
+                scheduledUs = wakeUs + periodUs;   // Fell a whole period behind: skip, don't burst
+            }
+        }
+        controlLoad.busyUs += (uint32_t)(boardUptimeUs() - wakeUs);
+    }
 }
 
-void handleLampOff() {
-    lampRelayState = false;
-    digitalWrite(LAMP_RELAY_PIN, HIGH);  // Active LOW relay OFF
-    Serial.println("> Command received: LAMP_OFF");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+// Ticks until the next sample is due or, after a door edge, until the line
+// has been quiet for the debounce time and its settled level can be read
+TickType_t controlWaitTicks(int64_t sampleDueUs) {
+    int64_t waitUs = sampleDueUs - boardUptimeUs();
+    uint32_t lastEdgeUs = doorLastEdgeUs;
+    if (lastEdgeUs != doorSettledEdgeUs) {
+        int64_t settleUs = (int64_t)DOOR_DEBOUNCE_US - (int64_t)(uint32_t)(micros() - lastEdgeUs);
+        waitUs = min(waitUs, settleUs);
+    }
+    if (waitUs <= 0) {
+        return 0;
+    }
+
+    TickType_t ticks = pdMS_TO_TICKS((waitUs + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
 }
 
-void handleLampToggle() {
-    lampRelayState = !lampRelayState;
-    digitalWrite(LAMP_RELAY_PIN, lampRelayState ? LOW : HIGH);
-    Serial.print("> Command received: LAMP_TOGGLE -> ");
-    Serial.println(lampRelayState ? "ON" : "OFF");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+void applyCommand(const DeviceCommand& command) {
+    for (uint8_t i = 0; i < command.batch.count; i++) {
+        const ParsedCommand& change = command.batch.commands[i];
+        applyStateChange(change);
+
+        if (change.type == CMD_SET_THRESHOLD) {
+            queueJournalEvent(JOURNAL_THRESHOLD, 0, change.value);
+        } else if (change.type != CMD_STATUS && change.type != CMD_STATUS_FRAME) {
+            queueJournalEvent(JOURNAL_COMMAND, change.type, change.device);
+        }
+    }
+
+    writeDeviceOutputs();
 }
 
-void handlePlugOn() {
-    plugState = true;
-    digitalWrite(PLUG_RELAY_PIN, LOW);  // Active LOW relay ON
-    Serial.println("> Command received: PLUG_ON");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+void applyStateChange(const ParsedCommand& command) {
+    switch (command.type) {
+        case CMD_DEVICE_ON:
+            devicesCommanded.set(command.device, true);
+            break;
+        case CMD_DEVICE_OFF:
+            devicesCommanded.set(command.device, false);
+            break;
+        case CMD_DEVICE_TOGGLE:
+            devicesCommanded.set(command.device, !devicesCommanded.get(command.device));
+            break;
+        case CMD_SET_THRESHOLD:
+            alarmTempThreshold = centiCelsiusToFloat(command.value);
+            break;
+        case CMD_STATUS:
+        case CMD_STATUS_FRAME:
+        case CMD_BATCH:
+            break;
+    }
 }
 
-void handlePlugOff() {
-    plugState = false;
-    digitalWrite(PLUG_RELAY_PIN, HIGH);  // Active LOW relay OFF
-    Serial.println("> Command received: PLUG_OFF");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+// Relays follow their commanded state; alarm outputs are switched in step 5
+void writeDeviceOutputs() {
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (spec.kind == KIND_RELAY) {
+            digitalWrite(spec.pin, deviceLevel(spec, devicesCommanded.get(i)));
+            devicesOn.set(i, devicesCommanded.get(i));
+        }
+    }
 }
 
-void handleAlarmOn() {
-    buzzerAppOverride = true;
-    digitalWrite(BUZZER_PIN, HIGH);
-    Serial.println("> Command received: ALARM_ON");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+// Binary sensors other than the door (which has its interrupt) are read with
+// every NTC sample
+void pollBinarySensors() {
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        if (spec.kind == KIND_BINARY_SENSOR && i != DEVICE_DOOR) {
+            devicesOn.set(i, deviceOnAtLevel(spec, digitalRead(spec.pin)));
+        }
+    }
 }
 
-void handleAlarmOff() {
-    buzzerAppOverride = false;
-    digitalWrite(BUZZER_PIN, LOW);
-    Serial.println("> Command received: ALARM_OFF");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+// Seqlock writer: only ever called from the control task (and once from setup)
+// Returns true if a status field changed (stateVersion was bumped)
+bool publishDeviceSnapshot(float temperatureC, int filteredAdc, unsigned long sampledAtMs, const uint32_t* commandsApplied) {
+    uint32_t sequence = snapshotSequence.load(std::memory_order_relaxed);
+    snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    deviceSnapshot.temperatureC = temperatureC;
+    deviceSnapshot.adcReading = filteredAdc;
+    deviceSnapshot.sampledAtMs = sampledAtMs;
+    deviceSnapshot.doorEventCount = doorEventCount;
+    memcpy(deviceSnapshot.doorEventLog, doorEventLog, sizeof(doorEventLog));
+    deviceSnapshot.devicesOn = devicesOn;
+    deviceSnapshot.devicesCommanded = devicesCommanded;
+    deviceSnapshot.threshold = alarmTempThreshold;
+    memcpy(deviceSnapshot.commandsApplied, commandsApplied, sizeof(deviceSnapshot.commandsApplied));
+
+    int16_t temperatureCenti = toStatusCenti(toScaled(temperatureC, 100));
+    if (!statusPublished || abs(temperatureCenti - deviceSnapshot.statusTempCenti) >= STATUS_TEMP_STEP_CENTI) {
+        deviceSnapshot.statusTempCenti = temperatureCenti;
+    }
+
+    StatusFrame status = statusFrameOf(deviceSnapshot);
+    bool changed = !statusPublished || !sameStatus(status, publishedStatus);
+    if (changed) {
+        uint32_t version = ++deviceSnapshot.stateVersion;
+        uint8_t bit = 0;
+        for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+            bool fieldChanged = deviceIsBinary(DEVICE_SPECS[i])
+                ? bit < STATUS_FRAME_FLAG_BITS && ((status.flags ^ publishedStatus.flags) >> bit++ & 1)
+                : status.temperatureCenti != publishedStatus.temperatureCenti;
+            if (fieldChanged || !statusPublished) {
+                deviceSnapshot.fieldVersions[i] = version;
+            }
+        }
+        if (status.thresholdCenti != publishedStatus.thresholdCenti || !statusPublished) {
+            deviceSnapshot.fieldVersions[DEVICE_COUNT] = version;
+        }
+        publishedStatus = status;
+        statusPublished = true;
+    }
+
+    snapshotSequence.store(sequence + 2, std::memory_order_release);
+    return changed;
 }
 
-void handleStatus() {
-    Serial.println("> Status poll received");
-    
-    addCORSHeaders();
-    server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
+
+// --- Door Sensor Functions ---
+
+void IRAM_ATTR onDoorEdge() {
+    uint32_t nowUs = micros();
+    doorLastEdgeUs = nowUs;
+    if (nowUs - doorAcceptedEdgeUs < DOOR_DEBOUNCE_US) {
+        return;  // Contact bounce
+    }
+
+    doorAcceptedEdgeUs = nowUs;
+    DoorEvent event = { nowUs, (bool)digitalRead(DOOR_SENSOR_PIN) };
+    doorEvents.push(event);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(controlTaskHandle, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
 }
 
-void handleNotFound() {
-    String uri = server.uri();
-    
-    // Check for SET_THRESHOLD command
-    if (uri.startsWith("/SET_THRESHOLD:")) {
-        String thresholdStr = uri.substring(15);
-        float newThreshold = thresholdStr.toFloat();
-        if (newThreshold > 0 && newThreshold < 100) {
-            alarmTempThreshold = newThreshold;
-            Serial.print("> Threshold set to: ");
-            Serial.println(alarmTempThreshold);
-        }
-        addCORSHeaders();
-        server.send(200, "text/plain", sendCurrentStatus(readNTC(), digitalRead(DOOR_SENSOR_PIN)));
-        return;
+// Control task only: applies queued edges, then checks the settled level
+// once per quiet period. In light sleep the GPIO interrupt cannot fire, so
+// with checkPin (once per sample) a pin that differs from the debounced
+// level is treated as a fresh edge and read again once it has settled.
+void serviceDoorEvents(bool checkPin) {
+    DoorEvent event;
+    while (doorEvents.pop(event)) {
+        metrics.record(METRIC_WAKE_DOOR, (uint32_t)micros() - event.atUs);
+        recordDoorEvent(event);
+    }
+
+    uint32_t lastEdgeUs = doorLastEdgeUs;
+    if (lastEdgeUs != doorSettledEdgeUs && micros() - lastEdgeUs >= DOOR_DEBOUNCE_US) {
+        doorSettledEdgeUs = lastEdgeUs;
+        DoorEvent settled = { lastEdgeUs, (bool)digitalRead(DOOR_SENSOR_PIN) };
+        recordDoorEvent(settled);
+    } else if (checkPin && lastEdgeUs == doorSettledEdgeUs && digitalRead(DOOR_SENSOR_PIN) != doorLevel) {
+        doorLastEdgeUs = micros();
     }
-    
-    addCORSHeaders();
-    server.send(404, "text/plain", "Not Found");
 }
 
+void recordDoorEvent(const DoorEvent& event) {
+    if (event.level == doorLevel) {
+        return;  // Bounce that ended where it started
+    }
 
-// --- Status Response Function ---
-String sendCurrentStatus(float temp, bool doorSensorReading) {
-    // Door sensor: HIGH = OPEN (magnet away), LOW = CLOSED (magnet near)
-    String doorStatusStr = (doorSensorReading == HIGH) ? "OPEN" : "CLOSED";
-    String lampStatusStr = lampRelayState ? "ON" : "OFF";
-    String plugStatusStr = plugState ? "ON" : "OFF";
-    String alarmStatusStr = (temp > alarmTempThreshold || buzzerAppOverride) ? "ALARM" : "SAFE";
+    bool opened = deviceOnAtLevel(DEVICE_SPECS[DEVICE_DOOR], event.level);
+    doorLevel = event.level;
+    devicesOn.set(DEVICE_DOOR, opened);
+    doorEventLog[doorEventCount % DOOR_EVENT_LOG_SIZE] = event;
+    doorEventCount++;
+    queueJournalEvent(JOURNAL_DOOR, 0, opened);
+}
 
-    // Format: "TEMP:XX.XX,DOOR:STATUS,LAMP:STATUS,PLUG:STATUS,ALARM:STATUS,THRESHOLD:XX.X"
-    String statusMessage = "";
-    statusMessage += "TEMP:";
-    statusMessage += String(temp, 2);
-    statusMessage += ",DOOR:";
-    statusMessage += doorStatusStr;
-    statusMessage += ",LAMP:";
-    statusMessage += lampStatusStr;
-    statusMessage += ",PLUG:";
-    statusMessage += plugStatusStr;
-    statusMessage += ",ALARM:";
-    statusMessage += alarmStatusStr;
-    statusMessage += ",THRESHOLD:";
-    statusMessage += String(alarmTempThreshold, 1);
 
-    return statusMessage;
+// --- NTC Thermistor Functions ---
+
+// Table lookup with linear interpolation: adcSum / count is the ADC code and
+// adcSum % count the fractional part of the averaged reading.
+int16_t ntcCentiCelsiusFromSum(long adcSum, int count) {
+    long index = adcSum / count;
+    long fraction = adcSum % count;
+    int16_t low = NtcTable::centiC[index];
+    if (fraction == 0 || index >= ADC_RESOLUTION - 1) {
+        return low;
+    }
+    int16_t high = NtcTable::centiC[index + 1];
+    return low + (int16_t)((long)(high - low) * fraction / count);
+}
+
+// Seqlock reader: lock-free and safe to call from any task
+DeviceSnapshot readDeviceSnapshot() {
+    DeviceSnapshot snapshot;
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = snapshotSequence.load(std::memory_order_acquire);
+        snapshot = deviceSnapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = snapshotSequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return snapshot;
+}
+
+// O(1): returns the latest filtered temperature published by the control task
+float readNTC() {
+    return readDeviceSnapshot().temperatureC;
+}
+
+unsigned long ntcSampleAgeMs() {
+    return millis() - readDeviceSnapshot().sampledAtMs;
+}
+
+
+// --- HTTP Request Handler Functions ---
+
+void addCORSHeaders() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+    server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
+    server.sendHeader("Access-Control-Expose-Headers", "ETag, X-Temp-Age-Ms, X-Temp-Stale, X-Uptime-S, X-History-Res, X-Journal-Next");
+}
+
+// Queues a batch for the control task and waits (bounded) until the
+// published snapshot shows it applied. Returns false if the queue is full
+// or the control task did not get to it in time. Only source's task may
+// call it.
+bool submitCommands(const CommandBatch& batch, uint8_t source) {
+    DeviceCommand command = { batch, nextCommandTicket[source]++, (uint32_t)micros(), source };
+    if (xQueueSend(commandQueue, &command, 0) != pdTRUE) {
+        return false;
+    }
+    xTaskNotifyGive(controlTaskHandle);
+
+    // The control task notifies this task once it has published the result
+    unsigned long start = millis();
+    while ((int32_t)(readDeviceSnapshot().commandsApplied[source] - command.ticket) < 0) {
+        if (millis() - start > COMMAND_APPLY_TIMEOUT_MS) {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, 1);
+    }
+    return true;
+}
+
+// "<boot nonce>-<version>", as ?since= takes it
+size_t appendStatusVersion(char* buffer, size_t capacity, size_t length, uint32_t version) {
+    length = appendUnsigned(buffer, capacity, length, statusBootNonce);
+    length = appendText(buffer, capacity, length, "-");
+    return appendUnsigned(buffer, capacity, length, version);
+}
+
+// Parses "<nonce>-<version>"; thisBoot is false if the nonce is another
+// boot's, or missing (a bare version from before the nonce was added).
+// Returns false if text is neither.
+bool parseStatusVersion(const char* text, uint32_t& version, bool& thisBoot) {
+    if (!isdigit((unsigned char)text[0])) {
+        return false;
+    }
+    char* end;
+    uint32_t nonce = strtoul(text, &end, 10);
+    if (*end == '\0') {
+        version = nonce;
+        thisBoot = false;
+        return true;
+    }
+    if (*end != '-' || !isdigit((unsigned char)end[1])) {
+        return false;
+    }
+    version = strtoul(end + 1, &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    thisBoot = (nonce == statusBootNonce);
+    return true;
+}
+
+// The status version for the text status, with ".bin" for the frame, quoted
+size_t formatStatusETag(char* etag, size_t capacity, uint32_t version, bool asFrame) {
+    size_t length = appendText(etag, capacity, 0, "\"");
+    length = appendStatusVersion(etag, capacity, length, version);
+    return appendText(etag, capacity, length, asFrame ? ".bin\"" : "\"");
+}
+
+// ETag is the status version ("<nonce>-<version>[.bin]"), X-Temp-Age-Ms
+// tells the client how old the temperature reading is
+void sendStatusHeaders(const DeviceSnapshot& snapshot, bool asFrame) {
+    unsigned long ageMs = millis() - snapshot.sampledAtMs;
+    char etag[STATUS_ETAG_SIZE];
+    formatStatusETag(etag, sizeof(etag), snapshot.stateVersion, asFrame);
+
+    addCORSHeaders();
+    server.sendHeader("Vary", "Accept");
+    server.sendHeader("Cache-Control", "no-cache");   // Revalidate with If-None-Match
+    server.sendHeader("ETag", etag);
+    server.sendHeader("X-Temp-Age-Ms", String(ageMs));
+    if (ageMs > NTC_STALE_AFTER_MS) {
+        server.sendHeader("X-Temp-Stale", "1");
+    }
+}
+
+// Sends the status in snapshot, as text or as the binary frame from
+// status_frame.h
+void sendStatusReply(const DeviceSnapshot& snapshot, bool asFrame) {
+    sendStatusHeaders(snapshot, asFrame);
+    if (asFrame) {
+        uint8_t frame[STATUS_FRAME_SIZE];
+        size_t length = encodeStatusFrame(frame, sizeof(frame), statusFrameOf(snapshot));
+        server.send_P(200, STATUS_FRAME_CONTENT_TYPE, (const char*)frame, length);
+        return;
+    }
+
+    char status[STATUS_BUFFER_SIZE];
+    size_t length = sendCurrentStatus(status, sizeof(status), snapshot);
+    server.send_P(200, "text/plain", status, length);
+}
+
+// GET /STATUS (and /STATUS.bin) without a command: 304 and no body when
+// If-None-Match names the current version, only the fields that changed
+// after ?since=<nonce>-<version> of this boot, or else the full status
+void sendStatusPoll(bool asFrame) {
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+    char etag[STATUS_ETAG_SIZE];
+    formatStatusETag(etag, sizeof(etag), snapshot.stateVersion, asFrame);
+    const String& ifNoneMatch = server.header("If-None-Match");
+    if (strstr(ifNoneMatch.c_str(), etag) != NULL || ifNoneMatch == "*") {
+        sendStatusHeaders(snapshot, asFrame);
+        server.send(304);
+        return;
+    }
+
+    if (!asFrame && server.hasArg("since")) {
+        uint32_t since;
+        bool thisBoot;
+        if (!parseStatusVersion(server.arg("since").c_str(), since, thisBoot)) {
+            addCORSHeaders();
+            server.send(400, "text/plain", "Invalid since");
+            return;
+        }
+
+        // A version from another boot, or ahead of ours, says nothing about
+        // what changed: send everything
+        int32_t ahead = (int32_t)(snapshot.stateVersion - since);
+        if (thisBoot && ahead == 0) {
+            sendStatusHeaders(snapshot, false);
+            server.send(304);
+            return;
+        }
+        if (thisBoot && ahead > 0) {
+            char changes[STATUS_BUFFER_SIZE];
+            size_t changesLength = sendStatusChanges(changes, sizeof(changes), snapshot, since);
+            sendStatusHeaders(snapshot, false);
+            server.send_P(200, "text/plain", changes, changesLength);
+            return;
+        }
+    }
+
+    sendStatusReply(snapshot, asFrame);
+}
+
+// Content negotiation: clients that accept the binary frame get it
+bool acceptsStatusFrame() {
+    return strstr(server.header("Accept").c_str(), STATUS_FRAME_CONTENT_TYPE) != NULL;
+}
+
+void sendBusyReply() {
+    addCORSHeaders();
+    server.send(503, "text/plain", "Busy");
+}
+
+// The control page and its script and style sheet, stored gzipped in flash
+// by tools/embed_web_assets.py and written out as they are, without a copy
+// in RAM. Every browser accepts gzip, so Accept-Encoding is not consulted.
+void handleWebAsset() {
+    MetricsScope scope(METRIC_ROUTE_ASSET);
+    const WebAsset* asset = NULL;
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        if (server.uri() == WEB_ASSETS[i].path) {
+            asset = &WEB_ASSETS[i];
+        }
+    }
+    if (asset == NULL) {
+        handleNotFound();
+        return;
+    }
+
+    // The page is revalidated on every load; its files have versioned URLs
+    addCORSHeaders();
+    server.sendHeader("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    server.sendHeader("ETag", asset->etag);
+    if (strstr(server.header("If-None-Match").c_str(), asset->etag) != NULL) {
+        server.send(304);
+        return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");
+    server.sendHeader("Vary", "Accept-Encoding");
+    server.send_P(200, asset->contentType, (const char*)asset->gzip, asset->gzipLength);
+}
+
+// Submits parsed commands to the control task and replies with one status
+void handleCommand(const char* path, const CommandBatch& batch) {
+    if (batch.count == 1 && batch.commands[0].type == CMD_STATUS) {
+        LOG_DEBUG("> Status poll received");
+        sendStatusPoll(acceptsStatusFrame());
+        return;
+    }
+    if (batch.count == 1 && batch.commands[0].type == CMD_STATUS_FRAME) {
+        sendStatusPoll(true);
+        return;
+    }
+
+    if (!submitCommands(batch, COMMAND_SOURCE_HTTP)) {
+        sendBusyReply();
+        return;
+    }
+
+    if (batch.count == 1 && batch.commands[0].type == CMD_DEVICE_TOGGLE) {
+        const DeviceSpec& spec = DEVICE_SPECS[batch.commands[0].device];
+        LOG_INFO("> Command received: ", path, " -> ",
+                 deviceStateText(spec, readDeviceSnapshot().devicesCommanded.get(batch.commands[0].device)));
+    } else {
+        LOG_INFO("> Command received: ", path);
+    }
+
+    sendStatusReply(readDeviceSnapshot(), acceptsStatusFrame());
+}
+
+// Every path except / and /EVENTS lands here: "/NAME", "/NAME:<arg>" or
+// "/BATCH:..." is resolved through the shared perfect-hash command table
+void handleNotFound() {
+    MetricsScope scope(METRIC_ROUTE_NOT_FOUND);
+    const String& uri = server.uri();
+    const char* path = uri.c_str() + 1;
+
+    CommandBatch batch;
+    switch (parseCommandBatch(path, DEVICES, batch)) {
+        case COMMAND_OK: {
+            bool statusPoll = batch.count == 1
+                && (batch.commands[0].type == CMD_STATUS || batch.commands[0].type == CMD_STATUS_FRAME);
+            scope.metric = statusPoll ? METRIC_ROUTE_STATUS : METRIC_ROUTE_COMMAND;
+            handleCommand(path, batch);
+            return;
+        }
+        case COMMAND_BAD_ARG:
+            scope.metric = METRIC_ROUTE_BAD_REQUEST;
+            addCORSHeaders();
+            server.send(400, "text/plain", "Invalid argument");
+            return;
+        case COMMAND_UNKNOWN:
+            break;
+    }
+
+    addCORSHeaders();
+    server.send(404, "text/plain", "Not Found");
+}
+
+
+// --- Server-Sent Events Functions ---
+
+void handleEvents() {
+    MetricsScope scope(METRIC_ROUTE_EVENTS);
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+
+    int slot = -1;
+    for (int i = 0; i < MAX_EVENT_SUBSCRIBERS; i++) {
+        if (!eventSubscribers[i].connected()) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        addCORSHeaders();
+        server.send(503, "text/plain", "Too many event subscribers");
+        return;
+    }
+
+    // Flush pending changes to existing subscribers so everyone shares one baseline
+    serviceEventSubscribers(snapshot);
+
+    WiFiClient client = server.client();
+    client.setNoDelay(true);
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/event-stream\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\n"
+                 "Access-Control-Allow-Origin: *\r\n\r\n");
+
+    char status[STATUS_BUFFER_SIZE];
+    size_t length = sendCurrentStatus(status, sizeof(status), snapshot);
+    if (writeEvent(client, status, length)) {
+        // Holding a copy keeps the socket open after the WebServer lets go of it
+        eventSubscribers[slot] = client;
+        LOG_INFO("> Event subscriber connected (", countEventSubscribers(), "/", MAX_EVENT_SUBSCRIBERS, ")");
+    }
+}
+
+int countEventSubscribers() {
+    int count = 0;
+    for (int i = 0; i < MAX_EVENT_SUBSCRIBERS; i++) {
+        if (eventSubscribers[i].connected()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Writes the fields that changed since the last call and updates the baseline.
+// Returns 0 when nothing changed.
+size_t formatEventDelta(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot) {
+    float temp = snapshot.temperatureC;
+    size_t length = 0;
+    buffer[0] = '\0';
+
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++) {
+        const DeviceSpec& spec = DEVICE_SPECS[i];
+        bool on = snapshot.devicesOn.get(i);
+        bool changed = deviceIsBinary(spec) ? on != eventDevicesOn.get(i)
+                                            : fabs(temp - eventTemp) >= EVENT_TEMP_DEADBAND;
+        if (!changed) {
+            continue;
+        }
+
+        length = appendText(buffer, bufferSize, length, length ? "," : "");
+        length = appendText(buffer, bufferSize, length, spec.name);
+        length = appendText(buffer, bufferSize, length, ":");
+        if (deviceIsBinary(spec)) {
+            length = appendText(buffer, bufferSize, length, deviceStateText(spec, on));
+            eventDevicesOn.set(i, on);
+        } else {
+            length = appendFixedPoint(buffer, bufferSize, length, toScaled(temp, 100), 2);
+            eventTemp = temp;
+        }
+    }
+    if (snapshot.threshold != eventThreshold) {
+        length = appendText(buffer, bufferSize, length, length ? ",THRESHOLD:" : "THRESHOLD:");
+        length = appendFixedPoint(buffer, bufferSize, length, toScaled(snapshot.threshold, 10), 1);
+        eventThreshold = snapshot.threshold;
+    }
+
+    return length;
+}
+
+// Sends one SSE message ("data: ...\n\n"). Returns false if the client is gone.
+bool writeEvent(WiFiClient& client, const char* data, size_t length) {
+    if (!client.connected()) {
+        return false;
+    }
+    size_t written = client.write((const uint8_t*)"data: ", 6);
+    written += client.write((const uint8_t*)data, length);
+    written += client.write((const uint8_t*)"\n\n", 2);
+    return written == length + 8;
+}
+
+void serviceEventSubscribers(const DeviceSnapshot& snapshot) {
+    char delta[STATUS_BUFFER_SIZE];
+    size_t length = formatEventDelta(delta, sizeof(delta), snapshot);
+    bool heartbeatDue = millis() - lastEventHeartbeatTime >= EVENT_HEARTBEAT_INTERVAL_MS;
+
+    if (length == 0 && !heartbeatDue) {
+        return;
+    }
+    if (heartbeatDue) {
+        lastEventHeartbeatTime = millis();
+    }
+
+    for (int i = 0; i < MAX_EVENT_SUBSCRIBERS; i++) {
+        WiFiClient& client = eventSubscribers[i];
+        if (!client.connected()) {
+            continue;
+        }
+
+        bool ok = true;
+        if (length > 0) {
+            ok = writeEvent(client, delta, length);
+        }
+        if (ok && heartbeatDue) {
+            ok = client.write((const uint8_t*)": ping\n\n", 8) == 8;
+        }
+        if (!ok) {
+            client.stop();
+            LOG_INFO("> Event subscriber disconnected");
+        }
+    }
+
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        WiFiClient& client = webSocketClients[i].client;
+        if (!client.connected()) {
+            continue;
+        }
+
+        bool ok = true;
+        if (length > 0) {
+            ok = writeWebSocketFrame(client, WEBSOCKET_TEXT, (const uint8_t*)delta, length);
+        }
+        if (ok && heartbeatDue) {
+            ok = writeWebSocketFrame(client, WEBSOCKET_PING, NULL, 0);
+        }
+        if (!ok) {
+            client.stop();
+            LOG_INFO("> WebSocket client disconnected");
+        }
+    }
+}
+
+
+// --- WebSocket Functions ---
+
+void handleWebSocket() {
+    MetricsScope scope(METRIC_ROUTE_WEBSOCKET);
+    char accept[WEBSOCKET_ACCEPT_SIZE + 1];
+    if (!server.header("Upgrade").equalsIgnoreCase("websocket") || server.header("Sec-WebSocket-Version") != "13"
+        || !webSocketAcceptKey(server.header("Sec-WebSocket-Key").c_str(), accept)) {
+        addCORSHeaders();
+        server.sendHeader("Sec-WebSocket-Version", "13");
+        server.send(426, "text/plain", "Expected a WebSocket upgrade");
+        return;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (!webSocketClients[i].client.connected()) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        addCORSHeaders();
+        server.send(503, "text/plain", "Too many WebSocket clients");
+        return;
+    }
+
+    // Flush pending changes to existing clients so everyone shares one baseline
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+    serviceEventSubscribers(snapshot);
+
+    WiFiClient client = server.client();
+    client.setNoDelay(true);
+    client.print("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: ");
+    client.print(accept);
+    client.print("\r\n\r\n");
+
+    char status[STATUS_BUFFER_SIZE];
+    size_t length = sendCurrentStatus(status, sizeof(status), snapshot);
+    if (writeWebSocketFrame(client, WEBSOCKET_TEXT, (const uint8_t*)status, length)) {
+        // Holding a copy keeps the socket open after the WebServer lets go of it
+        webSocketClients[slot].client = client;
+        webSocketClients[slot].length = 0;
+        LOG_INFO("> WebSocket client connected (", countWebSocketClients(), "/", MAX_WEBSOCKET_CLIENTS, ")");
+    }
+}
+
+int countWebSocketClients() {
+    int count = 0;
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (webSocketClients[i].client.connected()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Sends one unfragmented frame. Returns false if the client is gone.
+bool writeWebSocketFrame(WiFiClient& client, uint8_t opcode, const uint8_t* data, size_t length) {
+    if (!client.connected()) {
+        return false;
+    }
+    uint8_t header[WEBSOCKET_HEADER_MAX];
+    size_t headerLength = encodeWebSocketHeader(header, opcode, length);
+    size_t written = client.write(header, headerLength);
+    if (length > 0) {
+        written += client.write(data, length);
+    }
+    return written == headerLength + length;
+}
+
+void closeWebSocket(WebSocketClient& socket, uint16_t code) {
+    uint8_t payload[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+    writeWebSocketFrame(socket.client, WEBSOCKET_CLOSE, payload, sizeof(payload));
+    socket.client.stop();
+    LOG_INFO("> WebSocket client disconnected");
+}
+
+// Reads what each client has sent, without waiting for the rest of a frame
+void serviceWebSocketClients() {
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        WebSocketClient& socket = webSocketClients[i];
+        if (!socket.client.connected() || socket.client.available() <= 0) {
+            continue;
+        }
+
+        size_t capacity = sizeof(socket.buffer) - 1;
+        int received = socket.client.read(socket.buffer + socket.length, capacity - socket.length);
+        if (received <= 0) {
+            continue;
+        }
+        socket.length += received;
+
+        // Several frames may have arrived at once
+        while (socket.client.connected()) {
+            WebSocketFrame frame;
+            size_t consumed;
+            WebSocketDecode result = decodeWebSocketFrame(socket.buffer, socket.length, capacity, frame, consumed);
+            if (result == WEBSOCKET_FRAME_INCOMPLETE) {
+                break;
+            }
+            if (result != WEBSOCKET_FRAME_OK) {
+                closeWebSocket(socket, result == WEBSOCKET_FRAME_TOO_BIG ? WEBSOCKET_CLOSE_TOO_BIG
+                                                                        : WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+                break;
+            }
+
+            switch (frame.opcode) {
+                case WEBSOCKET_TEXT: {
+                    if (!frame.final) {
+                        closeWebSocket(socket, WEBSOCKET_CLOSE_UNSUPPORTED);
+                        break;
+                    }
+                    // The byte after the payload starts the next frame, or is the spare one
+                    uint8_t next = socket.buffer[consumed];
+                    socket.buffer[consumed] = '\0';
+                    handleWebSocketMessage(socket, (char*)frame.payload);
+                    socket.buffer[consumed] = next;
+                    break;
+                }
+                case WEBSOCKET_PING:
+                    writeWebSocketFrame(socket.client, WEBSOCKET_PONG, frame.payload, frame.payloadLength);
+                    break;
+                case WEBSOCKET_PONG:
+                    break;
+                case WEBSOCKET_CLOSE:
+                    closeWebSocket(socket, WEBSOCKET_CLOSE_NORMAL);
+                    break;
+                default:
+                    closeWebSocket(socket, WEBSOCKET_CLOSE_UNSUPPORTED);
+                    break;
+            }
+
+            memmove(socket.buffer, socket.buffer + consumed, socket.length - consumed);
+            socket.length -= consumed;
+        }
+    }
+}
+
+// Applies one command frame and answers the sender. The resulting change
+// reaches every client, the sender first among them, before the reply.
+void handleWebSocketMessage(WebSocketClient& socket, char* message) {
+    MetricsScope scope(METRIC_ROUTE_WEBSOCKET);
+    const char* reply;
+    CommandBatch batch;
+    switch (parseCommandBatch(message, DEVICES, batch)) {
+        case COMMAND_OK:
+            if (batch.count == 1 && (batch.commands[0].type == CMD_STATUS || batch.commands[0].type == CMD_STATUS_FRAME)) {
+                char status[STATUS_BUFFER_SIZE];
+                size_t length = sendCurrentStatus(status, sizeof(status), readDeviceSnapshot());
+                writeWebSocketFrame(socket.client, WEBSOCKET_TEXT, (const uint8_t*)status, length);
+                return;
+            }
+            if (!submitCommands(batch, COMMAND_SOURCE_HTTP)) {
+                reply = "BUSY";
+                break;
+            }
+            LOG_INFO("> WebSocket command: ", message);
+            serviceEventSubscribers(readDeviceSnapshot());
+            reply = "OK";
+            break;
+        case COMMAND_BAD_ARG:
+            reply = "BAD_ARG";
+            break;
+        default:
+            reply = "UNKNOWN";
+            break;
+    }
+    writeWebSocketFrame(socket.client, WEBSOCKET_TEXT, (const uint8_t*)reply, strlen(reply));
+}
+
+
+// --- Temperature History Functions ---
+
+// Does not wrap like millis(), which would after 49 days
+uint32_t uptimeSeconds() {
+    return (uint32_t)(boardUptimeUs() / 1000000);
+}
+
+// Records one sample per elapsed second. If the task was held up, the
+// missed seconds get the current value so every ring stays gap-free.
+void recordHistory(const DeviceSnapshot& snapshot) {
+    uint32_t now = uptimeSeconds();
+    if (historySeconds.count > 0 && now == historySeconds.newestBucket) {
+        return;
+    }
+
+    int16_t centi = toStatusCenti(toScaled(snapshot.temperatureC, 100));
+    uint32_t second = historySeconds.count > 0 ? historySeconds.newestBucket + 1 : now;
+    for (; second <= now; second++) {
+        recordHistorySecond(second, centi);
+    }
+}
+
+void recordHistorySecond(uint32_t second, int16_t centi) {
+    historySeconds.push(second, centi);
+
+    HistoryPoint finished;
+    if (minuteAccumulator.add(second / HISTORY_MINUTE_S, centi, finished)) {
+        historyMinutes.push(second / HISTORY_MINUTE_S - 1, finished);
+    }
+    if (hourAccumulator.add(second / HISTORY_HOUR_S, centi, finished)) {
+        historyHours.push(second / HISTORY_HOUR_S - 1, finished);
+    }
+}
+
+// Range of buckets held at a resolution, including the one still filling.
+// Returns false if there is nothing recorded yet.
+bool historyBounds(uint32_t resolution, uint32_t& oldest, uint32_t& newest) {
+    if (historySeconds.count == 0) {
+        return false;
+    }
+
+    switch (resolution) {
+        case 1:
+            oldest = historySeconds.oldestBucket();
+            newest = historySeconds.newestBucket;
+            break;
+        case HISTORY_MINUTE_S:
+            newest = minuteAccumulator.bucket;
+            oldest = historyMinutes.count > 0 ? historyMinutes.oldestBucket() : newest;
+            break;
+        default:
+            newest = hourAccumulator.bucket;
+            oldest = historyHours.count > 0 ? historyHours.oldestBucket() : newest;
+            break;
+    }
+    return true;
+}
+
+// bucket must be within historyBounds(resolution)
+HistoryPoint historyPointAt(uint32_t resolution, uint32_t bucket) {
+    switch (resolution) {
+        case 1: {
+            int16_t centi = historySeconds.at(bucket);
+            HistoryPoint point = { centi, centi, centi };
+            return point;
+        }
+        case HISTORY_MINUTE_S:
+            return bucket == minuteAccumulator.bucket ? minuteAccumulator.point() : historyMinutes.at(bucket);
+        default:
+            return bucket == hourAccumulator.bucket ? hourAccumulator.point() : historyHours.at(bucket);
+    }
+}
+
+// Reads ?name=<seconds>; a negative value counts back from now. Returns
+// false if the argument is not a whole number.
+bool parseHistoryTime(const char* name, uint32_t now, uint32_t fallback, uint32_t& value) {
+    if (!server.hasArg(name)) {
+        value = fallback;
+        return true;
+    }
+
+    const String& text = server.arg(name);
+    char* end;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0') {
+        return false;
+    }
+
+    if (parsed < 0) {
+        value = (uint32_t)-parsed > now ? 0 : now - (uint32_t)-parsed;
+    } else {
+        value = (uint32_t)parsed;
+    }
+    return true;
+}
+
+// Appends "second,min,avg,max\n" with temperatures in degrees C
+size_t appendHistoryLine(char* buffer, size_t capacity, size_t length, uint32_t second, const HistoryPoint& point) {
+    length = appendUnsigned(buffer, capacity, length, second);
+    length = appendText(buffer, capacity, length, ",");
+    length = appendFixedPoint(buffer, capacity, length, point.minCenti, 2);
+    length = appendText(buffer, capacity, length, ",");
+    length = appendFixedPoint(buffer, capacity, length, point.avgCenti, 2);
+    length = appendText(buffer, capacity, length, ",");
+    length = appendFixedPoint(buffer, capacity, length, point.maxCenti, 2);
+    return appendText(buffer, capacity, length, "\n");
+}
+
+// GET /HISTORY?from=&to=&res=
+// from/to default to the whole history; res defaults to the finest
+// resolution that keeps the requested span (1 s up to 10 min, 1 min up to a
+// day, then 1 h). The CSV is streamed with chunked transfer encoding from a
+// small stack buffer, so a day of minutes never sits in RAM as one String.
+void handleHistory() {
+    MetricsScope scope(METRIC_ROUTE_HISTORY);
+    uint32_t now = uptimeSeconds();
+    uint32_t from;
+    uint32_t to;
+    if (!parseHistoryTime("from", now, 0, from) || !parseHistoryTime("to", now, now, to) || from > to) {
+        addCORSHeaders();
+        server.send(400, "text/plain", "Invalid from/to");
+        return;
+    }
+
+    uint32_t resolution = to - from <= HISTORY_RAW_POINTS ? 1
+                        : to - from <= HISTORY_MINUTE_POINTS * HISTORY_MINUTE_S ? HISTORY_MINUTE_S
+                        : HISTORY_HOUR_S;
+    if (server.hasArg("res")) {
+        resolution = strtoul(server.arg("res").c_str(), NULL, 10);
+        if (resolution != 1 && resolution != HISTORY_MINUTE_S && resolution != HISTORY_HOUR_S) {
+            addCORSHeaders();
+            server.send(400, "text/plain", "res must be 1, 60 or 3600");
+            return;
+        }
+    }
+
+    addCORSHeaders();
+    server.sendHeader("X-Uptime-S", String(now));
+    server.sendHeader("X-History-Res", String(resolution));
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+
+    char chunk[HISTORY_CHUNK_SIZE];
+    size_t length = appendText(chunk, sizeof(chunk), 0, "time_s,min_c,avg_c,max_c\n");
+
+    // A bucket is included if any part of it falls inside [from, to]
+    uint32_t oldest;
+    uint32_t newest;
+    if (historyBounds(resolution, oldest, newest)) {
+        uint32_t first = max(oldest, from / resolution);
+        uint32_t last = min(newest, to / resolution);
+        for (uint32_t bucket = first; bucket <= last; bucket++) {
+            if (length + HISTORY_LINE_SIZE > sizeof(chunk)) {
+                server.sendContent(chunk, length);
+                length = 0;
+            }
+            length = appendHistoryLine(chunk, sizeof(chunk), length, bucket * resolution, historyPointAt(resolution, bucket));
+        }
+    }
+
+    server.sendContent(chunk, length);
+    server.sendContent("");  // Last chunk
+}
+
+
+// Appends "seq,boot,time_ms,EVENT,value\n". EVENT is BOOT, DOOR, ALARM,
+// THRESHOLD or the command name; value is the boot number, OPEN/CLOSED,
+// ON/OFF, degrees C, "RULE:<line>" for commands fired by /RULES, or empty.
+size_t appendJournalLine(char* buffer, size_t capacity, size_t length, const JournalRecord& record) {
+    length = appendUnsigned(buffer, capacity, length, record.sequence);
+    length = appendText(buffer, capacity, length, ",");
+    length = appendUnsigned(buffer, capacity, length, record.boot);
+    length = appendText(buffer, capacity, length, ",");
+    length = appendUnsigned(buffer, capacity, length, record.atMs);
+
+    switch (record.type) {
+        case JOURNAL_BOOT:
+            length = appendText(buffer, capacity, length, ",BOOT,");
+            length = appendUnsigned(buffer, capacity, length, (uint16_t)record.value);
+            break;
+        case JOURNAL_DOOR:
+            length = appendText(buffer, capacity, length, record.value ? ",DOOR,OPEN" : ",DOOR,CLOSED");
+            break;
+        case JOURNAL_ALARM:
+            length = appendText(buffer, capacity, length, record.value ? ",ALARM,ON" : ",ALARM,OFF");
+            break;
+        case JOURNAL_THRESHOLD:
+            length = appendText(buffer, capacity, length, ",THRESHOLD,");
+            length = appendFixedPoint(buffer, capacity, length, record.value, 2);
+            break;
+        case JOURNAL_RULE: {
+            uint8_t action = record.detail / MAX_DEVICES;
+            char name[BATCH_ENTRY_BUFFER_SIZE];
+            bool named = action < DEVICE_ACTION_COUNT
+                && commandName((CommandType)(CMD_DEVICE_ON + action), record.detail % MAX_DEVICES, DEVICES, name, sizeof(name));
+            length = appendText(buffer, capacity, length, ",");
+            length = appendText(buffer, capacity, length, named ? name : "UNKNOWN");
+            length = appendText(buffer, capacity, length, ",RULE:");
+            length = appendUnsigned(buffer, capacity, length, (uint16_t)record.value);
+            break;
+        }
+        default: {
+            // Device commands carry the device index in value
+            char name[BATCH_ENTRY_BUFFER_SIZE];
+            bool named = (uint16_t)record.value < MAX_DEVICES
+                && commandName((CommandType)record.detail, (uint8_t)record.value, DEVICES, name, sizeof(name));
+            length = appendText(buffer, capacity, length, ",");
+            length = appendText(buffer, capacity, length, named ? name : "UNKNOWN");
+            length = appendText(buffer, capacity, length, ",");
+            break;
+        }
+    }
+    return appendText(buffer, capacity, length, "\n");
+}
+
+// GET /LOG?since=<seq>
+// Streams journal records with sequence >= since (all of them by default)
+// as chunked CSV. X-Journal-Next is the since to use for the next poll.
+void handleLog() {
+    MetricsScope scope(METRIC_ROUTE_LOG);
+    uint32_t since = 0;
+    if (server.hasArg("since")) {
+        const String& text = server.arg("since");
+        char* end;
+        since = strtoul(text.c_str(), &end, 10);
+        if (end == text.c_str() || *end != '\0') {
+            addCORSHeaders();
+            server.send(400, "text/plain", "Invalid since");
+            return;
+        }
+    }
+    if (!journalReady) {
+        addCORSHeaders();
+        server.send(503, "text/plain", "Journal unavailable");
+        return;
+    }
+
+    // Pick up events the control task queued since the last pass
+    serviceJournal();
+
+    addCORSHeaders();
+    server.sendHeader("X-Journal-Next", String(journal.nextSequence()));
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+
+    char chunk[JOURNAL_CHUNK_SIZE];
+    size_t length = appendText(chunk, sizeof(chunk), 0, "seq,boot,time_ms,event,value\n");
+
+    JournalCursor cursor;
+    JournalRecord record;
+    journal.seek(cursor, since);
+    while (journal.next(cursor, record)) {
+        if (length + JOURNAL_LINE_SIZE > sizeof(chunk)) {
+            server.sendContent(chunk, length);
+            length = 0;
+        }
+        length = appendJournalLine(chunk, sizeof(chunk), length, record);
+    }
+
+    server.sendContent(chunk, length);
+    server.sendContent("");  // Last chunk
+}
+
+
+// --- Local Automation Rules Functions ---
+
+// Restores the rules saved by the last POST /RULES. A set stored for a
+// different device table, or one that does not read back whole, is dropped.
+void loadRules() {
+    uint32_t signature = ruleDeviceSignature(DEVICES);
+    DeviceRules& rules = ruleSets[0];
+    size_t length = boardLoadSetting(RULES_SETTING_KEY, &rules, sizeof(rules));
+    if (length == sizeof(rules) && rules.signature == signature && rules.isConsistent(DEVICE_COUNT)) {
+        rules.reset();
+        LOG_INFO("Loaded ", rules.ruleCount, " rule actions");
+        return;
+    }
+
+    if (length > 0) {
+        LOG_WARN("Stored rules do not match this firmware, ignored");
+    }
+    rules.clear(signature);
+}
+
+// Control task: swaps in rules posted to /RULES, then applies the actions of
+// the rules whose conditions have just become true. Outputs they switch can
+// fire further rules, for up to RULE_CHAIN_PASSES passes.
+void serviceRules(float temperatureC) {
+    if (rulesPending.load(std::memory_order_acquire)) {
+        uint8_t next = activeRules.load(std::memory_order_relaxed) ^ 1;
+        ruleSets[next].reset();
+        activeRules.store(next, std::memory_order_relaxed);
+        rulesPending.store(false, std::memory_order_release);
+    }
+    DeviceRules& rules = ruleSets[activeRules.load(std::memory_order_relaxed)];
+    if (rules.ruleCount == 0) {
+        return;
+    }
+
+    int16_t temperatureCenti = toStatusCenti(toScaled(temperatureC, 100));
+    int minuteOfDay = boardMinuteOfDay();
+    for (uint8_t pass = 0; pass < RULE_CHAIN_PASSES; pass++) {
+        uint64_t changed = 0;
+        for (uint8_t i = 0; i < RULE_OPERAND_COUNT; i++) {
+            int16_t fact = RULE_FACT_UNKNOWN;
+            if (i < DEVICE_COUNT) {
+                fact = DEVICE_SPECS[i].kind == KIND_ANALOG_SENSOR ? temperatureCenti : devicesOn.get(i);
+            } else if (i == RULE_OPERAND_TIME && minuteOfDay >= 0) {
+                fact = (int16_t)minuteOfDay;
+            }
+            if (fact != ruleFacts[i]) {
+                ruleFacts[i] = fact;
+                changed |= (uint64_t)1 << i;
+            }
+        }
+        if (changed == 0 && rules.primed) {
+            return;
+        }
+
+        // RULE_FIRINGS_PER_PASS at a time, until every rule that just became
+        // true has fired
+        RuleFiring fired[RULE_FIRINGS_PER_PASS];
+        uint16_t count;
+        uint16_t total = 0;
+        do {
+            count = rules.evaluate(ruleFacts, changed, fired, RULE_FIRINGS_PER_PASS);
+            for (uint16_t i = 0; i < count; i++) {
+                ParsedCommand command = { (CommandType)(CMD_DEVICE_ON + fired[i].action), fired[i].device, 0 };
+                applyStateChange(command);
+                queueJournalEvent(JOURNAL_RULE, fired[i].action * MAX_DEVICES + fired[i].device, fired[i].line);
+            }
+            total += count;
+        } while (count == RULE_FIRINGS_PER_PASS);
+        if (total == 0) {
+            return;
+        }
+        writeDeviceOutputs();
+    }
+}
+
+// Appends entries first..last-1, the actions of one rule, as rule text
+size_t appendRuleLine(char* buffer, size_t capacity, size_t length, const DeviceRules& rules, uint16_t first, uint16_t last) {
+    const Rule& rule = rules.rules[first];
+    length = appendText(buffer, capacity, length, "WHEN ");
+    for (uint8_t i = 0; i < rule.conditionCount; i++) {
+        const RuleCondition& condition = rules.conditions[rule.firstCondition + i];
+        if (i > 0) {
+            length = appendText(buffer, capacity, length, " AND ");
+        }
+        if (condition.operand == RULE_OPERAND_TIME) {
+            length = appendText(buffer, capacity, length, "TIME ");
+        } else {
+            length = appendText(buffer, capacity, length, DEVICE_SPECS[condition.operand].name);
+            length = appendText(buffer, capacity, length, " ");
+        }
+        length = appendText(buffer, capacity, length, RULE_OPERATOR_TEXT[condition.op]);
+        length = appendText(buffer, capacity, length, " ");
+
+        if (condition.operand == RULE_OPERAND_TIME) {
+            uint8_t hours = condition.value / 60;
+            uint8_t minutes = condition.value % 60;
+            length = appendText(buffer, capacity, length, hours < 10 ? "0" : "");
+            length = appendUnsigned(buffer, capacity, length, hours);
+            length = appendText(buffer, capacity, length, minutes < 10 ? ":0" : ":");
+            length = appendUnsigned(buffer, capacity, length, minutes);
+        } else if (deviceIsBinary(DEVICE_SPECS[condition.operand])) {
+            length = appendText(buffer, capacity, length, deviceStateText(DEVICE_SPECS[condition.operand], condition.value));
+        } else {
+            length = appendFixedPoint(buffer, capacity, length, condition.value, 2);
+        }
+    }
+
+    length = appendText(buffer, capacity, length, " THEN ");
+    for (uint16_t r = first; r < last; r++) {
+        if (r > first) {
+            length = appendText(buffer, capacity, length, ", ");
+        }
+        length = appendText(buffer, capacity, length, DEVICE_SPECS[rules.rules[r].device].name);
+        length = appendText(buffer, capacity, length, DEVICE_ACTION_SUFFIXES[rules.rules[r].action]);
+    }
+    return appendText(buffer, capacity, length, "\n");
+}
+
+// Streams rules as text that POST /RULES accepts, one rule per line
+void sendRuleList(const DeviceRules& rules) {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain", "");
+
+    char chunk[RULES_CHUNK_SIZE];
+    size_t length = 0;
+    uint16_t first = 0;
+    while (first < rules.ruleCount) {
+        // Actions of one rule share its conditions
+        uint16_t last = first + 1;
+        while (last < rules.ruleCount && rules.rules[last].firstCondition == rules.rules[first].firstCondition
+               && rules.rules[last].line == rules.rules[first].line) {
+            last++;
+        }
+
+        if (length + RULES_LINE_SIZE > sizeof(chunk)) {
+            server.sendContent(chunk, length);
+            length = 0;
+        }
+        length = appendRuleLine(chunk, sizeof(chunk), length, rules, first, last);
+        first = last;
+    }
+
+    server.sendContent(chunk, length);
+    server.sendContent("");  // Last chunk
+}
+
+// GET /RULES lists the active rules. POST /RULES replaces them with the
+// rules in the body (an empty body removes them), stores them for the next
+// boot and lists them as compiled; the first line that does not compile is
+// reported as 400 "Line N: <error>" and leaves the active rules in place.
+void handleRules() {
+    MetricsScope scope(METRIC_ROUTE_RULES);
+    if (server.method() != HTTP_POST) {
+        addCORSHeaders();
+        sendRuleList(ruleSets[activeRules.load(std::memory_order_relaxed)]);
+        return;
+    }
+    if (rulesPending.load(std::memory_order_acquire)) {
+        sendBusyReply();   // The control task has not taken the last upload yet
+        return;
+    }
+
+    addCORSHeaders();
+    const String& source = server.arg("plain");
+    if (source.length() > RULES_SOURCE_LIMIT) {
+        scope.metric = METRIC_ROUTE_BAD_REQUEST;
+        server.send(413, "text/plain", "Rules too long");
+        return;
+    }
+
+    // The spare set: the control task only reads the active one
+    DeviceRules& rules = ruleSets[activeRules.load(std::memory_order_relaxed) ^ 1];
+    RuleError error;
+    if (!compileRules(source.c_str(), DEVICES, rules, error)) {
+        scope.metric = METRIC_ROUTE_BAD_REQUEST;
+        char message[80];
+        size_t length = appendText(message, sizeof(message), 0, "Line ");
+        length = appendUnsigned(message, sizeof(message), length, error.line);
+        length = appendText(message, sizeof(message), length, ": ");
+        appendText(message, sizeof(message), length, error.message);
+        server.send(400, "text/plain", message);
+        return;
+    }
+    if (!boardSaveSetting(RULES_SETTING_KEY, &rules, sizeof(rules))) {
+        server.send(500, "text/plain", "Could not store rules");
+        return;
+    }
+
+    rulesPending.store(true, std::memory_order_release);
+    xTaskNotifyGive(controlTaskHandle);
+    LOG_INFO("> Rules updated: ", rules.ruleCount, " rule actions");
+    sendRuleList(rules);
+}
+
+
+// --- UDP Command Channel Functions ---
+
+// Answers one datagram at a time; the socket queues the rest
+void udpTask(void* parameter) {
+    (void)parameter;
+    uint8_t datagram[UDP_REQUEST_SIZE + 2];   // One byte more to spot an oversized request, and a NUL
+    uint8_t reply[UDP_REPLY_SIZE];
+
+    for (;;) {
+        BoardUdpPeer peer;
+        int length = boardUdpReceive(udpSocket, datagram, UDP_REQUEST_SIZE + 1, peer);
+        if (length < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));   // E.g. the interface went down
+            continue;
+        }
+
+        MetricsScope scope(METRIC_ROUTE_UDP);
+        size_t replyLength = handleUdpRequest(datagram, length, peer, reply, sizeof(reply));
+        if (replyLength > 0) {
+            boardUdpSend(udpSocket, reply, replyLength, peer);
+        }
+    }
+}
+
+// Returns the reply length, or 0 to stay silent (not our protocol, e.g. a
+// stray broadcast). Commands are parsed from the datagram in place.
+size_t handleUdpRequest(uint8_t* datagram, size_t length, const BoardUdpPeer& peer, uint8_t* reply, size_t capacity) {
+    UdpRequest request;
+    if (!decodeUdpRequest(datagram, length, request)) {
+        return 0;
+    }
+
+    if (request.type == UDP_DISCOVER) {
+        size_t replyLength = encodeUdpReply(reply, capacity, UDP_DISCOVER, request.sequence, UDP_OK,
+                                            statusFrameOf(readDeviceSnapshot()));
+        memcpy(reply + replyLength, UDP_DEVICE_NAME, sizeof(UDP_DEVICE_NAME) - 1);
+        return replyLength + sizeof(UDP_DEVICE_NAME) - 1;
+    }
+    if (request.type != UDP_COMMAND || length > UDP_REQUEST_SIZE) {
+        return encodeUdpReply(reply, capacity, request.type, request.sequence, UDP_MALFORMED,
+                              statusFrameOf(readDeviceSnapshot()));
+    }
+
+    UdpClient* client;
+    uint8_t result;
+    switch (udpClients.check(peer.address, peer.port, request.sequence, millis(), client)) {
+        case UDP_SEQUENCE_REPEATED:
+            result = client->lastResult;   // Answered before: same result, not applied again
+            break;
+        case UDP_SEQUENCE_STALE:
+            result = UDP_STALE;
+            break;
+        default: {
+            datagram[length] = '\0';
+            CommandBatch batch;
+            switch (parseCommandBatch(request.command, DEVICES, batch)) {
+                case COMMAND_OK: {
+                    bool statusPoll = batch.count == 1
+                        && (batch.commands[0].type == CMD_STATUS || batch.commands[0].type == CMD_STATUS_FRAME);
+                    result = statusPoll || submitCommands(batch, COMMAND_SOURCE_UDP) ? UDP_OK : UDP_BUSY;
+                    break;
+                }
+                case COMMAND_BAD_ARG:
+                    result = UDP_BAD_ARG;
+                    break;
+                default:
+                    result = UDP_UNKNOWN;
+                    break;
+            }
+            udpClients.record(*client, request.sequence, result);
+            break;
+        }
+    }
+
+    return encodeUdpReply(reply, capacity, UDP_COMMAND, request.sequence, result, statusFrameOf(readDeviceSnapshot()));
+}
+
+
+// --- Wi-Fi Supervisor Functions ---
+
+void startWiFi() {
+    wifiLinkCached = boardLoadSetting(WIFI_LINK_SETTING_KEY, &wifiLink, sizeof(wifiLink)) == sizeof(wifiLink);
+    LOG_INFO("Connecting to Wi-Fi", wifiLinkCached ? " (cached access point)..." : "...");
+    wifiAttemptStartUs = boardUptimeUs();
+    beginWiFiConnect(wifiLinkCached);
+}
+
+void beginWiFiConnect(bool cached) {
+    boardWiFiBegin(WIFI_SSID, WIFI_PASSWORD, cached ? &wifiLink : NULL);
+    wifiPhase = cached ? WIFI_FAST_CONNECT : WIFI_SCAN_CONNECT;
+    wifiPhaseStartMs = millis();
+}
+
+// Non-blocking: checks the link once and moves to the next phase if due
+void serviceWiFi() {
+    bool connected = boardWiFiConnected();
+    unsigned long elapsedMs = millis() - wifiPhaseStartMs;
+
+    switch (wifiPhase) {
+        case WIFI_UP:
+            if (!connected) {
+                wifiReconnects++;
+                wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+                LOG_WARN("[WIFI] Link lost, reconnecting");
+                wifiAttemptStartUs = boardUptimeUs();
+                beginWiFiConnect(wifiLinkCached);
+            }
+            return;
+        case WIFI_FAST_CONNECT:
+        case WIFI_SCAN_CONNECT:
+            if (connected) {
+                onWiFiConnected();
+                return;
+            }
+            if (wifiPhase == WIFI_FAST_CONNECT && elapsedMs >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+                LOG_WARN("[WIFI] Cached access point not reached, scanning");
+                beginWiFiConnect(false);
+            } else if (wifiPhase == WIFI_SCAN_CONNECT && elapsedMs >= WIFI_SCAN_CONNECT_TIMEOUT_MS) {
+                LOG_ERROR("[WIFI] Connect failed, check SSID and password; retrying in ", wifiBackoffMs, " ms");
+                boardWiFiDisconnect();
+                wifiPhase = WIFI_BACKOFF;
+                wifiPhaseStartMs = millis();
+            }
+            return;
+        case WIFI_BACKOFF:
+            if (elapsedMs >= wifiBackoffMs) {
+                wifiBackoffMs = min(wifiBackoffMs * 2, WIFI_BACKOFF_MAX_MS);
+                wifiAttemptStartUs = boardUptimeUs();
+                beginWiFiConnect(wifiLinkCached);
+            }
+            return;
+    }
+}
+
+// Records the connect time and keeps the link for the next fast connect
+void onWiFiConnected() {
+    bool fast = wifiPhase == WIFI_FAST_CONNECT;
+    wifiPhase = WIFI_UP;
+    wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+    wifiConnectMs = (uint32_t)((boardUptimeUs() - wifiAttemptStartUs) / 1000);
+
+    if (!wifiEverConnected) {
+        wifiEverConnected = true;
+        LOG_INFO("\n=== WI-FI CONNECTED SUCCESSFULLY! ===");
+        LOG_INFO(">>> YOUR IP ADDRESS: ", boardLocalIP());
+        LOG_INFO("=====================================");
+        LOG_INFO("Access the device at: http://", boardLocalIP());
+
+        // Wall clock for TIME conditions in /RULES, set over NTP in the background
+        boardStartClock(TIMEZONE);
+    }
+    LOG_INFO("[WIFI] Connected in ", wifiConnectMs, " ms (", fast ? "cached access point" : "scan", ")");
+
+    // Zeroed first: the padding is compared and stored too
+    BoardWiFiLink link;
+    memset(&link, 0, sizeof(link));
+    if (boardWiFiLinkInfo(link) && (!wifiLinkCached || memcmp(&link, &wifiLink, sizeof(link)) != 0)) {
+        wifiLink = link;
+        wifiLinkCached = true;
+        boardSaveSetting(WIFI_LINK_SETTING_KEY, &wifiLink, sizeof(wifiLink));
+    }
+}
+
+
+// --- Metrics Functions ---
+
+// Appends us as seconds with six decimals, e.g. 1500 -> "0.001500"
+size_t appendMicrosAsSeconds(char* buffer, size_t capacity, size_t length, uint64_t us) {
+    length = appendUnsigned(buffer, capacity, length, (uint32_t)(us / 1000000));
+    length = appendText(buffer, capacity, length, ".");
+    uint32_t fraction = (uint32_t)(us % 1000000);
+    for (uint32_t digit = 100000; digit > 0; digit /= 10) {
+        length = appendUnsigned(buffer, capacity, length, fraction / digit % 10);
+    }
+    return length;
+}
+
+// Appends one sample: <name><suffix>{<label>="...",le="..."} value, with
+// the group's name and label; le may be NULL
+size_t appendMetricLine(char* buffer, size_t capacity, size_t length, const MetricGroup& group, const char* suffix, uint8_t metric, const char* le, const char* value) {
+    length = appendText(buffer, capacity, length, group.name);
+    length = appendText(buffer, capacity, length, suffix);
+    length = appendText(buffer, capacity, length, "{");
+    length = appendText(buffer, capacity, length, group.label);
+    length = appendText(buffer, capacity, length, "=\"");
+    length = appendText(buffer, capacity, length, METRIC_LABELS[metric]);
+    if (le) {
+        length = appendText(buffer, capacity, length, "\",le=\"");
+        length = appendText(buffer, capacity, length, le);
+    }
+    length = appendText(buffer, capacity, length, "\"} ");
+    length = appendText(buffer, capacity, length, value);
+    return appendText(buffer, capacity, length, "\n");
+}
+
+// GET /METRICS
+// Prometheus text format: one duration histogram per phase, wake-up source
+// and route (buckets 1 us to 32.8 ms, doubling), plus heap, uptime and task
+// duty cycle gauges. Streamed in chunks like /HISTORY.
+void handleMetrics() {
+    MetricsScope scope(METRIC_ROUTE_METRICS);
+    addCORSHeaders();
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+
+    char chunk[METRICS_CHUNK_SIZE];
+    size_t length = 0;
+
+    length = appendText(chunk, sizeof(chunk), length, "# TYPE smart_home_heap_free_bytes gauge\nsmart_home_heap_free_bytes ");
+    length = appendUnsigned(chunk, sizeof(chunk), length, boardFreeHeap());
+    length = appendText(chunk, sizeof(chunk), length, "\n# TYPE smart_home_heap_largest_free_block_bytes gauge\nsmart_home_heap_largest_free_block_bytes ");
+    length = appendUnsigned(chunk, sizeof(chunk), length, boardLargestFreeBlock());
+    length = appendText(chunk, sizeof(chunk), length, "\n# TYPE smart_home_uptime_seconds gauge\nsmart_home_uptime_seconds ");
+    length = appendUnsigned(chunk, sizeof(chunk), length, uptimeSeconds());
+    length = appendText(chunk, sizeof(chunk), length, "\n# TYPE smart_home_first_request_seconds gauge\nsmart_home_first_request_seconds ");
+    length = appendMicrosAsSeconds(chunk, sizeof(chunk), length, firstRequestUs);
+    server.sendContent(chunk, length);
+    length = appendText(chunk, sizeof(chunk), 0, "\n# TYPE smart_home_wifi_connect_seconds gauge\nsmart_home_wifi_connect_seconds ");
+    length = appendMicrosAsSeconds(chunk, sizeof(chunk), length, (uint64_t)wifiConnectMs * 1000);
+    length = appendText(chunk, sizeof(chunk), length, "\n# TYPE smart_home_wifi_links_lost_total counter\nsmart_home_wifi_links_lost_total ");
+    length = appendUnsigned(chunk, sizeof(chunk), length, wifiReconnects);
+
+    // Over the last STATUS_REPORT_INTERVAL_MS, as printed by reportStatus()
+    length = appendText(chunk, sizeof(chunk), length, "\n# TYPE smart_home_task_duty_ratio gauge\nsmart_home_task_duty_ratio{task=\"control\"} ");
+    length = appendFixedPoint(chunk, sizeof(chunk), length, toScaled(controlLoad.duty, 10000), 4);
+    length = appendText(chunk, sizeof(chunk), length, "\nsmart_home_task_duty_ratio{task=\"web_server\"} ");
+    length = appendFixedPoint(chunk, sizeof(chunk), length, toScaled(webServerLoad.duty, 10000), 4);
+    server.sendContent(chunk, length);
+    length = appendText(chunk, sizeof(chunk), 0, "\n# TYPE smart_home_task_wakeups_per_second gauge\nsmart_home_task_wakeups_per_second{task=\"control\"} ");
+    length = appendFixedPoint(chunk, sizeof(chunk), length, toScaled(controlLoad.wakeupsPerS, 10), 1);
+    length = appendText(chunk, sizeof(chunk), length, "\nsmart_home_task_wakeups_per_second{task=\"web_server\"} ");
+    length = appendFixedPoint(chunk, sizeof(chunk), length, toScaled(webServerLoad.wakeupsPerS, 10), 1);
+    length = appendText(chunk, sizeof(chunk), length, "\n");
+
+    for (uint8_t group = 0; group < METRIC_GROUP_COUNT; group++) {
+        const MetricGroup& metricGroup = METRIC_GROUPS[group];
+        uint8_t end = group + 1 < METRIC_GROUP_COUNT ? METRIC_GROUPS[group + 1].first : (uint8_t)METRIC_COUNT;
+
+        server.sendContent(chunk, length);
+        length = appendText(chunk, sizeof(chunk), 0, "# TYPE ");
+        length = appendText(chunk, sizeof(chunk), length, metricGroup.name);
+        length = appendText(chunk, sizeof(chunk), length, " histogram\n");
+
+        for (uint8_t metric = metricGroup.first; metric < end; metric++) {
+            // Copied first, so the buckets, count and sum agree with each other
+            LatencyHistogram histogram = metrics.snapshot(metric);
+            char le[12];
+            char value[24];
+            uint32_t cumulative = 0;
+
+            for (uint8_t bucket = 0; bucket < METRIC_BUCKETS; bucket++) {
+                if (length + METRICS_LINE_SIZE > sizeof(chunk)) {
+                    server.sendContent(chunk, length);
+                    length = 0;
+                }
+                cumulative += histogram.buckets[bucket];
+                if (bucket + 1 < METRIC_BUCKETS) {
+                    appendMicrosAsSeconds(le, sizeof(le), 0, metricBucketBoundUs(bucket));
+                } else {
+                    appendText(le, sizeof(le), 0, "+Inf");
+                }
+                appendUnsigned(value, sizeof(value), 0, cumulative);
+                length = appendMetricLine(chunk, sizeof(chunk), length, metricGroup, "_bucket", metric, le, value);
+            }
+
+            if (length + 2 * METRICS_LINE_SIZE > sizeof(chunk)) {
+                server.sendContent(chunk, length);
+                length = 0;
+            }
+            appendMicrosAsSeconds(value, sizeof(value), 0, histogram.sumUs);
+            length = appendMetricLine(chunk, sizeof(chunk), length, metricGroup, "_sum", metric, NULL, value);
+            appendUnsigned(value, sizeof(value), 0, cumulative);
+            length = appendMetricLine(chunk, sizeof(chunk), length, metricGroup, "_count", metric, NULL, value);
+        }
+    }
+
+    server.sendContent(chunk, length);
+    server.sendContent("");  // Last chunk
+}
+
+
+// --- Status Serialization ---
+// The status reply is written into a caller-provided buffer with hand-rolled
+// fixed-point formatting, so building it never touches the heap.
+
+// Appends text, truncating at capacity - 1. Always NUL-terminates.
+size_t appendText(char* buffer, size_t capacity, size_t length, const char* text) {
+    while (*text && length + 1 < capacity) {
+        buffer[length++] = *text++;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+// Appends scaled / 10^decimals, e.g. (2734, 2) -> "27.34", (-5, 2) -> "-0.05"
+size_t appendFixedPoint(char* buffer, size_t capacity, size_t length, long scaled, uint8_t decimals) {
+    char digits[12];
+    uint8_t count = 0;
+    unsigned long magnitude = (scaled < 0) ? 0UL - (unsigned long)scaled : (unsigned long)scaled;
+
+    do {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= decimals);
+
+    if (scaled < 0 && length + 1 < capacity) {
+        buffer[length++] = '-';
+    }
+    while (count > 0 && length + 1 < capacity) {
+        if (count == decimals) {
+            buffer[length++] = '.';
+            if (length + 1 >= capacity) break;
+        }
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+// Appends value in decimal; for counters that can pass LONG_MAX
+size_t appendUnsigned(char* buffer, size_t capacity, size_t length, uint32_t value) {
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0 && length + 1 < capacity) {
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+// Rounds half away from zero, matching String(value, decimals)
+long toScaled(float value, long scale) {
+    return (long)(value * scale + (value < 0 ? -0.5f : 0.5f));
+}
+
+// Function to format the status data for the Android App.
+// Writes into buffer (NUL-terminated) and returns the length written.
+// Format: "TEMP:XX.XX,DOOR:STATUS,LAMP:STATUS,PLUG:STATUS,ALARM:STATUS,THRESHOLD:XX.X",
+// one NAME:value field per DEVICE_SPECS row
+size_t sendCurrentStatus(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot) {
+    size_t length = 0;
+    for (uint8_t field = 0; field < STATUS_FIELD_COUNT; field++) {
+        length = appendText(buffer, bufferSize, length, field ? "," : "");
+        length = appendStatusField(buffer, bufferSize, length, snapshot, field);
+    }
+    return length;
+}
+
+// Same format, only the fields that changed after version since
+size_t sendStatusChanges(char* buffer, size_t bufferSize, const DeviceSnapshot& snapshot, uint32_t since) {
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (uint8_t field = 0; field < STATUS_FIELD_COUNT; field++) {
+        if ((int32_t)(snapshot.fieldVersions[field] - since) > 0) {
+            length = appendText(buffer, bufferSize, length, length ? "," : "");
+            length = appendStatusField(buffer, bufferSize, length, snapshot, field);
+        }
+    }
+    return length;
+}
+
+// Appends one NAME:value field: a DEVICE_SPECS row, or DEVICE_COUNT for THRESHOLD
+size_t appendStatusField(char* buffer, size_t bufferSize, size_t length, const DeviceSnapshot& snapshot, uint8_t field) {
+    if (field == DEVICE_COUNT) {
+        length = appendText(buffer, bufferSize, length, "THRESHOLD:");
+        return appendFixedPoint(buffer, bufferSize, length, toScaled(snapshot.threshold, 10), 1);
+    }
+
+    const DeviceSpec& spec = DEVICE_SPECS[field];
+    length = appendText(buffer, bufferSize, length, spec.name);
+    length = appendText(buffer, bufferSize, length, ":");
+    if (deviceIsBinary(spec)) {
+        return appendText(buffer, bufferSize, length, deviceStateText(spec, snapshot.devicesOn.get(field)));
+    }
+    return appendFixedPoint(buffer, bufferSize, length, snapshot.statusTempCenti, 2);
+}
+
+// Binary form of the same status (see status_frame.h); flag bits follow the
+// binary devices in table order
+StatusFrame statusFrameOf(const DeviceSnapshot& snapshot) {
+    StatusFrame frame;
+    frame.temperatureCenti = snapshot.statusTempCenti;
+    frame.thresholdCenti = toStatusCenti(toScaled(snapshot.threshold, 100));
+    frame.flags = 0;
+    uint8_t bit = 0;
+    for (uint8_t i = 0; i < DEVICE_COUNT && bit < STATUS_FRAME_FLAG_BITS; i++) {
+        if (deviceIsBinary(DEVICE_SPECS[i])) {
+            frame.flags |= (uint8_t)(snapshot.devicesOn.get(i) << bit);
+            bit++;
+        }
+    }
+    frame.sequence = snapshot.stateVersion;
+    return frame;
+}
+
+#ifdef BENCHMARK_STATUS_SERIALIZER
+// Previous String-based implementation, kept only for the boot-time comparison
+String legacySendCurrentStatus(const DeviceSnapshot& snapshot) {
+    String doorStatusStr = snapshot.devicesOn.get(DEVICE_DOOR) ? "OPEN" : "CLOSED";
+    String lampStatusStr = snapshot.devicesOn.get(DEVICE_LAMP) ? "ON" : "OFF";
+    String plugStatusStr = snapshot.devicesOn.get(DEVICE_PLUG) ? "ON" : "OFF";
+    String alarmStatusStr = snapshot.devicesOn.get(DEVICE_ALARM) ? "ALARM" : "SAFE";
+
+    String statusMessage = "";
+    statusMessage += "TEMP:";
+    statusMessage += String(snapshot.temperatureC, 2);
+    statusMessage += ",DOOR:";
+    statusMessage += doorStatusStr;
+    statusMessage += ",LAMP:";
+    statusMessage += lampStatusStr;
+    statusMessage += ",PLUG:";
+    statusMessage += plugStatusStr;
+    statusMessage += ",ALARM:";
+    statusMessage += alarmStatusStr;
+    statusMessage += ",THRESHOLD:";
+    statusMessage += String(snapshot.threshold, 1);
+
+    return statusMessage;
+}
+
+// Times both serializers over the same inputs and prints microseconds per call
+void benchmarkStatusSerializer() {
+    const int ITERATIONS = 1000;
+    char buffer[STATUS_BUFFER_SIZE];
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+    volatile size_t sink = 0;
+
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        snapshot.temperatureC = 20.0 + i * 0.01;
+        sink += legacySendCurrentStatus(snapshot).length();
+    }
+    unsigned long legacyUs = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        snapshot.statusTempCenti = 2000 + i;
+        sink += sendCurrentStatus(buffer, sizeof(buffer), snapshot);
+    }
+    unsigned long bufferUs = micros() - start;
+
+    LOG_INFO("[BENCH] String status: ", logFloat((float)legacyUs / ITERATIONS, 2),
+             " us/call, buffer status: ", logFloat((float)bufferUs / ITERATIONS, 2), " us/call");
 }
+#endif
@@ -0,0 +1,302 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Append-only Event Journal
+// ----------------------------------------------------
+// Used by esp32_main_code.cpp. When building with the Arduino IDE, keep this
+// file (and journal_storage.h) in the sketch folder.
+//
+// Door edges, alarm changes, relay commands and threshold changes are kept
+// as 16-byte records in flash, so they survive a reboot with no PC attached.
+//
+// Layout: the storage is used as a ring of sectors. Slot 0 of each sector
+// is a header with an epoch that goes up by one for every sector opened;
+// the other slots hold records in sequence order. When a sector is full the
+// next one (wrapping around) is erased and opened, so erases rotate over
+// the whole partition and the oldest sector is the one given up.
+//
+// Records are gathered in RAM and written JOURNAL_BATCH_RECORDS at a time
+// (or by flush()), so flash sees few, larger writes.
+//
+// Recovery: begin() reads only the sector headers to find the newest epoch,
+// then scans that one sector for its first blank slot. A record torn by
+// power loss fails its CRC and is skipped; writing carries on after it.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "journal_storage.h"
+
+const uint32_t JOURNAL_MAGIC = 0x314A4853;   // "SHJ1"
+const uint8_t JOURNAL_RECORD_SIZE = 16;
+const uint8_t JOURNAL_BATCH_RECORDS = 16;    // Records held in RAM before a write
+
+enum JournalEventType : uint8_t {
+    JOURNAL_BOOT = 1,      // value: boot number
+    JOURNAL_DOOR,          // value: 1 = OPEN, 0 = CLOSED
+    JOURNAL_ALARM,         // value: 1 = on, 0 = off; detail: 1 if the app override is set
+    JOURNAL_COMMAND,       // detail: CommandType (command_table.h); value: device index for CMD_DEVICE_*
+    JOURNAL_THRESHOLD,     // value: new threshold, centi-degrees C
+    JOURNAL_RULE           // detail: DeviceAction * 32 + device index; value: rule line
+};
+
+struct JournalRecord {
+    uint32_t sequence;     // Never reused; /LOG?since= counts in these
+    uint32_t atMs;         // millis() in the boot it was recorded in
+    uint16_t boot;
+    uint8_t type;          // JournalEventType
+    uint8_t detail;
+    int16_t value;
+    uint16_t check;        // CRC-16 of the bytes above
+};
+
+struct JournalSectorHeader {
+    uint32_t magic;
+    uint32_t epoch;
+    uint32_t firstSequence;  // Sequence of the first record written here
+    uint16_t boot;
+    uint16_t check;
+};
+
+static_assert(sizeof(JournalRecord) == JOURNAL_RECORD_SIZE, "JournalRecord must fill one slot");
+static_assert(sizeof(JournalSectorHeader) == JOURNAL_RECORD_SIZE, "JournalSectorHeader must fill one slot");
+
+// CRC-16/CCITT-FALSE
+inline uint16_t journalCrc16(const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        crc ^= (uint16_t)*bytes++ << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Position of a reader; set up by EventJournal::seek()
+struct JournalCursor {
+    uint32_t since;
+    uint32_t sector;
+    uint32_t sectorsLeft;   // Including sector
+    uint32_t slot;
+    uint8_t pendingIndex;   // Into records not yet written to flash
+};
+
+class EventJournal {
+public:
+    explicit EventJournal(JournalStorage& storage)
+        : storage(storage), sectors(0), slotsPerSector(0), currentSector(0), currentEpoch(0),
+          writeSlot(0), sequence(1), boot(0), pendingCount(0), lost(0), ready(false) {}
+
+    // Finds the end of the journal (formatting blank or foreign storage)
+    // and records a JOURNAL_BOOT. Returns false if the storage is unusable.
+    bool begin(uint32_t nowMs) {
+        ready = false;
+        sectors = storage.sectorCount();
+        slotsPerSector = storage.sectorSize() / JOURNAL_RECORD_SIZE;
+        if (sectors < 2 || slotsPerSector < 2) {
+            return false;
+        }
+
+        // 1. Newest sector: highest epoch among valid headers
+        bool found = false;
+        JournalSectorHeader header;
+        for (uint32_t s = 0; s < sectors; s++) {
+            if (readHeader(s, header) && (!found || (int32_t)(header.epoch - currentEpoch) > 0)) {
+                found = true;
+                currentSector = s;
+                currentEpoch = header.epoch;
+                sequence = header.firstSequence;
+                boot = header.boot;
+            }
+        }
+
+        // 2. First blank slot in it; the last valid record gives the sequence
+        if (found) {
+            writeSlot = 1;
+            JournalRecord record;
+            for (uint32_t slot = 1; slot < slotsPerSector; slot++) {
+                if (!readRecord(currentSector, slot, record)) {
+                    return false;
+                }
+                if (isBlank(record)) {
+                    break;
+                }
+                writeSlot = slot + 1;
+                if (isValid(record)) {
+                    sequence = record.sequence + 1;
+                    boot = record.boot;
+                }
+            }
+        } else if (!openSector(0, 1, sequence)) {
+            return false;
+        }
+
+        boot++;
+        ready = true;
+        append(JOURNAL_BOOT, 0, (int16_t)boot, nowMs);
+        return flush();
+    }
+
+    // Queues a record and returns its sequence. Writes a batch to flash
+    // when JOURNAL_BATCH_RECORDS are waiting.
+    uint32_t append(uint8_t type, uint8_t detail, int16_t value, uint32_t atMs) {
+        uint32_t assigned = sequence++;
+        JournalRecord& record = pending[pendingCount++];
+        record.sequence = assigned;
+        record.atMs = atMs;
+        record.boot = boot;
+        record.type = type;
+        record.detail = detail;
+        record.value = value;
+        record.check = journalCrc16(&record, offsetof(JournalRecord, check));
+
+        if (pendingCount == JOURNAL_BATCH_RECORDS) {
+            flush();
+        }
+        return assigned;
+    }
+
+    // Writes the queued records, opening new sectors as needed. On a storage
+    // error the queued records are dropped (see lostRecords()).
+    bool flush() {
+        uint8_t done = 0;
+        while (ready && done < pendingCount) {
+            if (writeSlot >= slotsPerSector
+                && !openSector((currentSector + 1) % sectors, currentEpoch + 1, pending[done].sequence)) {
+                break;
+            }
+
+            uint32_t run = pendingCount - done;
+            if (run > slotsPerSector - writeSlot) {
+                run = slotsPerSector - writeSlot;
+            }
+            if (!storage.write(slotOffset(currentSector, writeSlot), &pending[done], run * JOURNAL_RECORD_SIZE)) {
+                writeSlot = slotsPerSector;  // Don't write over a half-written slot
+                break;
+            }
+            writeSlot += run;
+            done += run;
+        }
+
+        bool ok = (done == pendingCount);
+        lost += pendingCount - done;
+        pendingCount = 0;
+        return ok;
+    }
+
+    // Positions cursor at the oldest record with sequence >= since
+    void seek(JournalCursor& cursor, uint32_t since) {
+        cursor.since = since;
+        cursor.sectorsLeft = 0;
+        cursor.slot = 1;
+        cursor.pendingIndex = 0;
+
+        // Walk from the oldest sector to the newest, keeping the last one
+        // that starts at or before since (or the oldest, if none does)
+        JournalSectorHeader header;
+        for (uint32_t i = 1; ready && i <= sectors; i++) {
+            uint32_t s = (currentSector + i) % sectors;
+            if (readHeader(s, header) && (cursor.sectorsLeft == 0 || (int32_t)(header.firstSequence - since) <= 0)) {
+                cursor.sector = s;
+                cursor.sectorsLeft = sectors - i + 1;
+            }
+        }
+    }
+
+    // Next record at or after the cursor's since, flash first, then the
+    // records still queued in RAM. Returns false at the end.
+    bool next(JournalCursor& cursor, JournalRecord& record) {
+        JournalSectorHeader header;
+        while (cursor.sectorsLeft > 0) {
+            bool sectorDone = cursor.slot >= slotsPerSector
+                           || (cursor.slot == 1 && !readHeader(cursor.sector, header))
+                           || !readRecord(cursor.sector, cursor.slot, record)
+                           || isBlank(record);
+            if (sectorDone) {
+                cursor.sector = (cursor.sector + 1) % sectors;
+                cursor.sectorsLeft--;
+                cursor.slot = 1;
+                continue;
+            }
+            cursor.slot++;
+            if (isValid(record) && (int32_t)(record.sequence - cursor.since) >= 0) {
+                return true;
+            }
+        }
+
+        while (cursor.pendingIndex < pendingCount) {
+            record = pending[cursor.pendingIndex++];
+            if ((int32_t)(record.sequence - cursor.since) >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t nextSequence() const { return sequence; }
+    uint16_t bootCount() const { return boot; }
+    uint8_t pendingRecords() const { return pendingCount; }
+    uint32_t lostRecords() const { return lost; }
+    uint32_t sectorCount() const { return sectors; }
+
+private:
+    uint32_t slotOffset(uint32_t sector, uint32_t slot) const {
+        return sector * storage.sectorSize() + slot * JOURNAL_RECORD_SIZE;
+    }
+
+    bool readRecord(uint32_t sector, uint32_t slot, JournalRecord& record) {
+        return storage.read(slotOffset(sector, slot), &record, sizeof(record));
+    }
+
+    bool readHeader(uint32_t sector, JournalSectorHeader& header) {
+        return storage.read(slotOffset(sector, 0), &header, sizeof(header))
+            && header.magic == JOURNAL_MAGIC
+            && header.check == journalCrc16(&header, offsetof(JournalSectorHeader, check));
+    }
+
+    // Erases a sector and writes its header; records go after it
+    bool openSector(uint32_t sector, uint32_t epoch, uint32_t firstSequence) {
+        JournalSectorHeader header;
+        header.magic = JOURNAL_MAGIC;
+        header.epoch = epoch;
+        header.firstSequence = firstSequence;
+        header.boot = boot;
+        header.check = journalCrc16(&header, offsetof(JournalSectorHeader, check));
+
+        if (!storage.eraseSector(sector) || !storage.write(slotOffset(sector, 0), &header, sizeof(header))) {
+            return false;
+        }
+        currentSector = sector;
+        currentEpoch = epoch;
+        writeSlot = 1;
+        return true;
+    }
+
+    static bool isBlank(const JournalRecord& record) {
+        const uint8_t* bytes = (const uint8_t*)&record;
+        for (uint8_t i = 0; i < sizeof(record); i++) {
+            if (bytes[i] != 0xFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool isValid(const JournalRecord& record) {
+        return record.check == journalCrc16(&record, offsetof(JournalRecord, check));
+    }
+
+    JournalStorage& storage;
+    uint32_t sectors;
+    uint32_t slotsPerSector;    // Including the header slot
+    uint32_t currentSector;
+    uint32_t currentEpoch;
+    uint32_t writeSlot;
+    uint32_t sequence;          // Next sequence to hand out
+    uint16_t boot;
+    JournalRecord pending[JOURNAL_BATCH_RECORDS];
+    uint8_t pendingCount;
+    uint32_t lost;
+    bool ready;
+};
@@ -0,0 +1,159 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Linux Backend: Arduino Core Subset
+// ----------------------------------------------------
+// Stands in for <Arduino.h> in host builds (see board_hal.h for the subset
+// the firmware may use). GPIO and the ADC are simulated in host_board.cpp;
+// FreeRTOS tasks map to threads and one tick is one millisecond.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+// --- Pins ---
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define digitalPinToInterrupt(pin) (pin)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+
+// --- Time ---
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+// --- Flash Constants ---
+#define IRAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define PSTR(text) (text)
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper*>(text))
+
+// --- String ---
+// The parts of Arduino's String the firmware uses, over std::string
+class String {
+public:
+    String(const char* text = "") : text(text ? text : "") {}
+    String(const std::string& text) : text(text) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    explicit String(unsigned int value) : text(std::to_string(value)) {}
+    explicit String(long value) : text(std::to_string(value)) {}
+    explicit String(unsigned long value) : text(std::to_string(value)) {}
+    explicit String(float value, unsigned char decimals = 2) : text(formatDecimal(value, decimals)) {}
+    explicit String(double value, unsigned char decimals = 2) : text(formatDecimal(value, decimals)) {}
+
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.length(); }
+
+    String& operator+=(const String& other) { text += other.text; return *this; }
+    String& operator+=(const char* other) { text += other; return *this; }
+    String& operator+=(char c) { text += c; return *this; }
+
+    bool operator==(const String& other) const { return text == other.text; }
+    bool operator==(const char* other) const { return text == other; }
+    bool operator!=(const char* other) const { return text != other; }
+    bool equalsIgnoreCase(const String& other) const { return strcasecmp(text.c_str(), other.text.c_str()) == 0; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+    friend String operator+(const String& a, const char* b) { return String(a.text + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.text); }
+
+    static std::string formatDecimal(double value, unsigned char decimals) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        return buffer;
+    }
+
+private:
+    std::string text;
+};
+
+// --- Serial ---
+// Writes to stdout; each call is one write, so lines from two tasks don't mix
+class HostSerial {
+public:
+    HostSerial() : output(stdout) {}
+
+    void begin(unsigned long baud) { (void)baud; }
+
+    // Host only: redirect the output, or drop it with NULL
+    void setOutput(FILE* stream) { output = stream; }
+
+    void print(const char* text);
+    void print(const String& text) { print(text.c_str()); }
+    void print(char c) { char text[2] = { c, '\0' }; print(text); }
+    void print(int value) { print(String(value)); }
+    void print(unsigned int value) { print(String(value)); }
+    void print(long value) { print(String(value)); }
+    void print(unsigned long value) { print(String(value)); }
+    void print(double value, int decimals = 2) { print(String(value, (unsigned char)decimals)); }
+    size_t write(const uint8_t* data, size_t length);
+    int availableForWrite() { return 256; }   // Like a UART transmit buffer that is never full
+
+    void println() { print("\n"); }
+    template<class T> void println(const T& value) { print(value); println(); }
+    void println(double value, int decimals) { print(value, decimals); println(); }
+
+private:
+    FILE* output;
+};
+
+extern HostSerial Serial;
+
+// --- FreeRTOS Subset ---
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void* TaskHandle_t;
+typedef struct HostQueue* QueueHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define portYIELD_FROM_ISR()
+
+// Starts a thread; priority and core are ignored
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackBytes,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+// vTaskDelete(NULL) parks the calling thread for good
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+// Notifications as a counting semaphore per task. A thread that was not
+// started by xTaskCreatePinnedToCore gets one the first time it waits.
+void xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
@@ -0,0 +1,113 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Linux Backend: WebServer and WiFiClient
+// ----------------------------------------------------
+// Stands in for the ESP32 core's <WebServer.h> in host builds. Requests come
+// from a real TCP socket; every response is sent with "Connection: close",
+// as the ESP32 server does.
+//
+// The port is $HOST_HTTP_PORT if set, otherwise the firmware's port, moved
+// up by 8000 when it needs root (80 -> 8080).
+
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+// A TCP connection. Copies share the socket, which closes when the last
+// copy lets go or stop() is called, so a handler can keep a client after
+// the server is done with the request (the /EVENTS and /WS clients do).
+class WiFiClient {
+public:
+    WiFiClient() {}
+
+    // Socket-less client that accepts and drops all output (for benchmarks)
+    static WiFiClient discard();
+    static WiFiClient adopt(int socketFd);
+
+    bool connected();
+    int available();
+    int read(uint8_t* buffer, size_t size);   // Never blocks; -1 if nothing is waiting
+    size_t write(const uint8_t* data, size_t length);
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    void setNoDelay(bool noDelay);
+    void stop();
+
+    // Bytes written so far (all copies together)
+    size_t written() const;
+
+private:
+    struct Connection {
+        explicit Connection(int fd) : fd(fd), bytesWritten(0), stopped(false) {}
+        ~Connection();
+        int fd;             // -1: discard output
+        size_t bytesWritten;
+        bool stopped;
+    };
+
+    std::shared_ptr<Connection> connection;
+};
+
+class WebServer {
+public:
+    typedef void (*THandlerFunction)();
+
+    explicit WebServer(int port);
+    ~WebServer();
+
+    void on(const char* uri, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler);
+    void collectHeaders(const char* headerKeys[], size_t count);
+    void begin();
+
+    // Serves at most one waiting connection, without blocking if none is
+    void handleClient();
+
+    // Runs one raw request ("GET /x HTTP/1.1\r\n...\r\n\r\n") through the
+    // same parsing and dispatch as a socket request, replying to client
+    void handleRequest(const char* request, WiFiClient client);
+
+    // --- Request ---
+    HTTPMethod method() const { return requestMethod; }
+    const String& uri() const { return requestUri; }
+    bool hasArg(const char* name) const;
+    String arg(const char* name) const;
+    String header(const char* name) const;
+    WiFiClient client() { return currentClient; }
+
+    // --- Response ---
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void setContentLength(size_t length) { contentLength = length; }
+    void send(int code, const char* contentType = NULL, const String& content = String(""));
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t length);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+
+private:
+    typedef std::pair<std::string, std::string> Field;
+
+    bool parseRequest(const std::string& request);
+    void sendResponseHead(int code, const char* contentType, size_t length);
+
+    int port;
+    int listenFd;
+    std::vector<std::pair<std::string, THandlerFunction> > routes;
+    THandlerFunction notFoundHandler;
+    std::vector<std::string> collectedHeaders;
+
+    WiFiClient currentClient;
+    HTTPMethod requestMethod;
+    String requestUri;
+    bool http11;
+    std::vector<Field> requestArgs;
+    std::vector<Field> requestHeaders;
+    std::vector<Field> responseHeaders;
+    size_t contentLength;
+    bool chunked;
+};
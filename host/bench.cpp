@@ -0,0 +1,399 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Host Microbenchmarks
+// ----------------------------------------------------
+// Times readNTC(), sendCurrentStatus(), every HTTP handler and the UDP and
+// WebSocket command handlers of the ESP32 firmware on the Linux backend. Handlers are driven through
+// WebServer::handleRequest(), so request parsing is included, and replies go
+// to a client that drops them. Command handlers include the round trip
+// through the control task; the control task notifies only the web server
+// task when it is done, so here the handler waits out one tick.
+//
+// Rule evaluation is timed on its own for rule sets larger than the
+// firmware's MAX_RULES, as the control task would run it after a door edge,
+// a temperature sample, or a change no rule reads; its bytes column counts
+// the actions fired.
+//
+// Figures are for the host CPU: use them to compare changes, not as ESP32
+// timings.
+//
+// "smart_home_bench load [seconds]" instead boots the whole firmware with
+// setup() and measures the control task's worst wake-up lateness and worst
+// alarm reaction (worstControlLatenessUs and worstAlarmReactionUs, as the
+// firmware's [TIMING] line reports them), first idle and then while client
+// threads keep the HTTP server busy over loopback. The simulated NTC sweeps
+// across the alarm threshold every 2 s, so the buzzer switches about as
+// often in both phases. The host ignores task priorities and cores, so
+// these are worst cases under Linux scheduling, not the ESP32's.
+
+#include "../esp32_main_code.cpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct BenchResult {
+    double meanUs;
+    double p50Us;
+    double p99Us;
+    double maxUs;
+    size_t bytesPerCall;
+};
+
+template<class Body> BenchResult runBenchmark(int iterations, Body body) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    size_t bytes = 0;
+
+    for (int i = 0; i < iterations / 10; i++) {   // Warm-up
+        body(i);
+    }
+    for (int i = 0; i < iterations; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bytes += body(i);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        samples.push_back(elapsed.count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        total += samples[i];
+    }
+
+    BenchResult result;
+    result.meanUs = total / samples.size();
+    result.p50Us = samples[samples.size() / 2];
+    result.p99Us = samples[samples.size() * 99 / 100];
+    result.maxUs = samples.back();
+    result.bytesPerCall = bytes / iterations;
+    return result;
+}
+
+void printResult(const char* name, const BenchResult& result) {
+    printf("%-28s %10.3f %10.3f %10.3f %10.3f %8zu\n",
+           name, result.meanUs, result.p50Us, result.p99Us, result.maxUs, result.bytesPerCall);
+}
+
+// Sends one GET, with one extra header if given, and returns the bytes
+// written in reply
+size_t request(const char* target, const char* headerName = NULL, const char* headerValue = NULL) {
+    char raw[256];
+    snprintf(raw, sizeof(raw), "GET %s HTTP/1.1\r\nHost: bench\r\n%s%s%s%s\r\n", target,
+             headerName ? headerName : "", headerName ? ": " : "", headerName ? headerValue : "", headerName ? "\r\n" : "");
+    WiFiClient client = WiFiClient::discard();
+    server.handleRequest(raw, client);
+    return client.written();
+}
+
+void benchHandler(const char* name, int iterations, const char* target,
+                  const char* headerName = NULL, const char* headerValue = NULL) {
+    printResult(name, runBenchmark(iterations, [target, headerName, headerValue](int) {
+        return request(target, headerName, headerValue);
+    }));
+}
+
+// Hands one datagram to handleUdpRequest() and returns the reply length.
+// A sequence of 0 repeats the previous one.
+size_t udpRequest(uint8_t type, uint32_t sequence, const char* command) {
+    static uint32_t lastSequence = 0;
+    sequence = sequence ? sequence : lastSequence;
+    lastSequence = sequence;
+
+    uint8_t datagram[UDP_REQUEST_SIZE + 2] = { UDP_PROTOCOL_VERSION, type,
+        (uint8_t)sequence, (uint8_t)(sequence >> 8), (uint8_t)(sequence >> 16), (uint8_t)(sequence >> 24) };
+    size_t length = UDP_HEADER_SIZE + strlen(command);
+    memcpy(datagram + UDP_HEADER_SIZE, command, strlen(command));
+    uint8_t reply[UDP_REPLY_SIZE];
+    BoardUdpPeer peer = { 0x0100007F, 0x3412 };
+    return handleUdpRequest(datagram, length, peer, reply, sizeof(reply));
+}
+
+// Hands one text frame to handleWebSocketMessage() from a client that drops
+// its replies and returns the bytes written
+size_t webSocketMessage(const char* command) {
+    static WebSocketClient socket = { WiFiClient::discard(), {}, 0 };
+    size_t before = socket.client.written();
+    char message[WEBSOCKET_MESSAGE_SIZE + 1];
+    strncpy(message, command, sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+    handleWebSocketMessage(socket, message);
+    return socket.client.written() - before;
+}
+
+// --- Rule Evaluation ---
+typedef RuleSet<2048, 4096> BenchRules;   // 1.5 entries per rule below
+BenchRules benchRules;
+
+// count rules, half on the door and the temperature, half on the door and the time
+std::string benchRuleSource(int count) {
+    std::string source;
+    char line[96];
+    for (int i = 0; i < count; i++) {
+        if (i % 2 == 0) {
+            snprintf(line, sizeof(line), "WHEN DOOR == OPEN AND TEMP > %d.%d THEN LAMP_TOGGLE\n", 15 + i % 20, i % 10);
+        } else {
+            snprintf(line, sizeof(line), "WHEN DOOR == CLOSED AND TIME >= %02d:%02d THEN PLUG_ON, ALARM_OFF\n", i % 24, i % 60);
+        }
+        source += line;
+    }
+    return source;
+}
+
+void benchRuleEvaluation(int count) {
+    RuleError error;
+    if (!compileRules(benchRuleSource(count).c_str(), DEVICES, benchRules, error)) {
+        printf("%d rules: line %u: %s\n", count, error.line, error.message);
+        return;
+    }
+
+    int16_t facts[RULE_OPERAND_COUNT];
+    for (uint8_t i = 0; i < RULE_OPERAND_COUNT; i++) {
+        facts[i] = 0;
+    }
+    facts[DEVICE_TEMP] = 2500;
+    facts[RULE_OPERAND_TIME] = 12 * 60;
+    RuleFiring fired[RULE_FIRINGS_PER_PASS];
+    benchRules.reset();
+    benchRules.evaluate(facts, 0, fired, RULE_FIRINGS_PER_PASS);
+
+    char name[40];
+    snprintf(name, sizeof(name), "%d rules: door edge", count);
+    printResult(name, runBenchmark(100000, [&facts, &fired](int i) {
+        facts[DEVICE_DOOR] = i & 1;
+        return (size_t)benchRules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS);
+    }));
+    snprintf(name, sizeof(name), "%d rules: temp sample", count);
+    printResult(name, runBenchmark(100000, [&facts, &fired](int i) {
+        facts[DEVICE_TEMP] = 1500 + i % 2000;
+        return (size_t)benchRules.evaluate(facts, (uint64_t)1 << DEVICE_TEMP, fired, RULE_FIRINGS_PER_PASS);
+    }));
+    snprintf(name, sizeof(name), "%d rules: unread change", count);
+    printResult(name, runBenchmark(100000, [&facts, &fired](int) {
+        return (size_t)benchRules.evaluate(facts, (uint64_t)1 << DEVICE_PLUG, fired, RULE_FIRINGS_PER_PASS);
+    }));
+}
+
+// --- Control Timing Under HTTP Load ---
+const int LOAD_CLIENTS = 8;
+const char* const LOAD_TARGETS[] = {
+    "/STATUS", "/", "/HISTORY?from=0&to=86399&res=60", "/LOG", "/METRICS", "/STATUS.bin", "/LAMP_TOGGLE",
+};
+
+// One GET over loopback, read to the end; returns false if the server could not be reached
+bool loopbackGet(uint16_t port, const char* target) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    char buffer[1024];
+    int length = snprintf(buffer, sizeof(buffer), "GET %s HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n", target);
+    bool ok = send(fd, buffer, length, 0) == length;
+    while (ok && recv(fd, buffer, sizeof(buffer), 0) > 0) {
+    }
+    close(fd);
+    return ok;
+}
+
+struct LoadPhase {
+    uint32_t requests;
+    uint32_t alarmEdges;
+    uint32_t worstLatenessUs;
+    uint32_t worstReactionUs;
+};
+
+// Clears the control task's worst cases, runs for seconds with clients
+// clients hammering the server, and returns what the control task saw
+LoadPhase runLoadPhase(uint16_t port, int seconds, int clients) {
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> requests(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.push_back(std::thread([&running, &requests, port, i]() {
+            const size_t targetCount = sizeof(LOAD_TARGETS) / sizeof(LOAD_TARGETS[0]);
+            for (size_t n = i; running.load(); n++) {
+                if (loopbackGet(port, LOAD_TARGETS[n % targetCount])) {
+                    requests++;
+                }
+            }
+        }));
+    }
+
+    worstControlLatenessUs = 0;
+    worstAlarmReactionUs = 0;
+
+    // Count buzzer edges by watching the pin; they are hundreds of ms apart
+    const uint8_t alarmPin = DEVICE_SPECS[DEVICE_ALARM].pin;
+    uint32_t edges = 0;
+    int level = digitalRead(alarmPin);
+    uint32_t requestsBefore = requests.load();
+    unsigned long startMs = millis();
+    while (millis() - startMs < (unsigned long)seconds * 1000) {
+        delay(1);
+        int now = digitalRead(alarmPin);
+        if (now != level) {
+            edges++;
+            level = now;
+        }
+    }
+
+    LoadPhase phase = { requests.load() - requestsBefore, edges, worstControlLatenessUs, worstAlarmReactionUs };
+    running = false;
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    return phase;
+}
+
+void printLoadPhase(const char* name, int seconds, const LoadPhase& phase) {
+    printf("%-28s %10.0f %10u %14u %14u\n", name, (double)phase.requests / seconds,
+           phase.alarmEdges, phase.worstLatenessUs, phase.worstReactionUs);
+}
+
+int benchControlUnderLoad(int seconds) {
+    char dataDir[] = "/tmp/smart_home_bench_XXXXXX";
+    setenv("HOST_DATA_DIR", mkdtemp(dataDir), 1);
+    setenv("HOST_DOOR_PERIOD_S", "0", 1);
+    setenv("HOST_ADC_PERIOD_S", "4", 1);   // Across the 27 C threshold every 2 s, through the 1 s average
+    setenv("HOST_UDP_PORT", "0", 0);
+    setenv("HOST_HTTP_PORT", "18080", 0);
+    uint16_t port = (uint16_t)atoi(getenv("HOST_HTTP_PORT"));
+    Serial.setOutput(NULL);
+
+    setup();
+    if (!loopbackGet(port, "/STATUS")) {
+        fprintf(stderr, "No HTTP server on port %u\n", port);
+        return 1;
+    }
+
+    printf("Control task timing, %d s per phase, %d clients under load\n", seconds, LOAD_CLIENTS);
+    printf("%-28s %10s %10s %14s %14s\n", "phase", "requests/s", "edges", "lateness us", "reaction us");
+    printLoadPhase("idle", seconds, runLoadPhase(port, seconds, 0));
+    printLoadPhase("HTTP load", seconds, runLoadPhase(port, seconds, LOAD_CLIENTS));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "load") == 0) {
+        return benchControlUnderLoad(argc > 2 ? atoi(argv[2]) : 20);
+    }
+
+    // Quiet, repeatable setup: no door toggles, a fresh journal image, no firmware logging
+    setenv("HOST_DOOR_PERIOD_S", "0", 1);
+    char dataDir[] = "/tmp/smart_home_bench_XXXXXX";
+    setenv("HOST_DATA_DIR", mkdtemp(dataDir), 1);
+    Serial.setOutput(NULL);
+
+    startJournal();
+    startControlTask();
+    registerRoutes();
+
+    // Two days of history and a few thousand journal records to read back
+    for (uint32_t second = 0; second < 2 * 86400; second++) {
+        recordHistorySecond(second, 2000 + (int16_t)(second % 700));
+    }
+    for (int i = 0; i < 3000; i++) {
+        journal.append(JOURNAL_DOOR, 0, i & 1, i * 1000);
+    }
+    journal.flush();
+
+    printf("%-28s %10s %10s %10s %10s %8s\n", "benchmark", "mean us", "p50 us", "p99 us", "max us", "bytes");
+
+    printResult("readNTC", runBenchmark(1000000, [](int) { return (size_t)(readNTC() > 0); }));
+
+    // The fixed table and the device name index; bytes is the command type
+    printResult("parseCommand STATUS", runBenchmark(1000000, [](int) {
+        ParsedCommand command;
+        parseCommand("STATUS", DEVICES, command);
+        return (size_t)command.type;
+    }));
+    printResult("parseCommand ALARM_TOGGLE", runBenchmark(1000000, [](int) {
+        ParsedCommand command;
+        parseCommand("ALARM_TOGGLE", DEVICES, command);
+        return (size_t)command.type;
+    }));
+
+    DeviceSnapshot snapshot = readDeviceSnapshot();
+    printResult("sendCurrentStatus", runBenchmark(1000000, [&snapshot](int i) {
+        char buffer[STATUS_BUFFER_SIZE];
+        snapshot.statusTempCenti = 2000 + i % 1000;
+        return sendCurrentStatus(buffer, sizeof(buffer), snapshot);
+    }));
+
+    benchHandler("GET / (handleWebAsset)", 20000, "/");
+    benchHandler("GET /STATUS", 20000, "/STATUS");
+    benchHandler("GET /STATUS (Accept bin)", 20000, "/STATUS", "Accept", STATUS_FRAME_CONTENT_TYPE);
+    benchHandler("GET /STATUS.bin", 20000, "/STATUS.bin");
+    char etag[STATUS_ETAG_SIZE];
+    char sinceTarget[48];
+    formatStatusETag(etag, sizeof(etag), readDeviceSnapshot().stateVersion, false);
+    size_t sinceLength = appendText(sinceTarget, sizeof(sinceTarget), 0, "/STATUS?since=");
+    appendStatusVersion(sinceTarget, sizeof(sinceTarget), sinceLength, readDeviceSnapshot().stateVersion - 1);
+    benchHandler("GET /STATUS (304)", 20000, "/STATUS", "If-None-Match", etag);
+    benchHandler("GET /STATUS?since=", 20000, sinceTarget);
+    benchHandler("GET /NOPE (404)", 20000, "/NOPE");
+    benchHandler("GET /SET_THRESHOLD:abc (400)", 20000, "/SET_THRESHOLD:abc");
+    benchHandler("GET /LAMP_TOGGLE", 500, "/LAMP_TOGGLE");
+    benchHandler("GET /SET_THRESHOLD:30.0", 500, "/SET_THRESHOLD:30.0");
+    benchHandler("GET /BATCH (3 commands)", 500, "/BATCH:LAMP_ON,PLUG_OFF,SET_THRESHOLD:31.5");
+    benchHandler("GET /HISTORY 10 min @ 1 s", 2000, "/HISTORY?from=172200&to=172799&res=1");
+    benchHandler("GET /HISTORY 1 day @ 1 min", 500, "/HISTORY?from=86400&to=172799&res=60");
+    benchHandler("GET /HISTORY 2 days @ 1 h", 2000, "/HISTORY?from=0&to=172799&res=3600");
+    benchHandler("GET /LOG?since=2900", 2000, "/LOG?since=2900");
+    benchHandler("GET /LOG (all)", 200, "/LOG");
+    benchHandler("GET /METRICS", 2000, "/METRICS");
+
+    // A full rule set for GET /RULES, swapped in by the control task
+    std::string post = "POST /RULES HTTP/1.1\r\nHost: bench\r\n\r\n" + benchRuleSource(MAX_RULES * 2 / 3);
+    WiFiClient client = WiFiClient::discard();
+    server.handleRequest(post.c_str(), client);
+    while (rulesPending.load()) {
+        delay(1);
+    }
+    benchHandler("GET /RULES", 2000, "/RULES");
+
+    benchRuleEvaluation(10);
+    benchRuleEvaluation(100);
+    benchRuleEvaluation(500);
+    benchRuleEvaluation(1000);
+
+    uint32_t sequence = 1;
+    printResult("UDP discover", runBenchmark(20000, [](int) { return udpRequest(UDP_DISCOVER, 0, ""); }));
+    printResult("UDP STATUS", runBenchmark(20000, [&sequence](int) {
+        return udpRequest(UDP_COMMAND, sequence++, "STATUS");
+    }));
+    printResult("UDP LAMP_TOGGLE", runBenchmark(500, [&sequence](int) {
+        return udpRequest(UDP_COMMAND, sequence++, "LAMP_TOGGLE");
+    }));
+    printResult("UDP LAMP_TOGGLE (resent)", runBenchmark(20000, [](int) {
+        return udpRequest(UDP_COMMAND, 0, "LAMP_TOGGLE");
+    }));
+
+    printResult("WS STATUS", runBenchmark(20000, [](int) { return webSocketMessage("STATUS"); }));
+    printResult("WS LAMP_TOGGLE", runBenchmark(500, [](int) { return webSocketMessage("LAMP_TOGGLE"); }));
+
+    printResult("GET /EVENTS (connect)", runBenchmark(20000, [](int) {
+        size_t bytes = request("/EVENTS");
+        for (int i = 0; i < MAX_EVENT_SUBSCRIBERS; i++) {
+            eventSubscribers[i].stop();
+        }
+        return bytes;
+    }));
+
+    return 0;
+}
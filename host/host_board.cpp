@@ -0,0 +1,866 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Linux Backend
+// ----------------------------------------------------
+// Implements host/Arduino.h, host/WebServer.h and the board* functions of
+// board_hal.h for host builds.
+//
+// Simulated hardware, tuned with environment variables:
+//   ADC           every analogRead() follows a sine between HOST_ADC_MIN and
+//                 HOST_ADC_MAX (default 1750..2350, about 19..31 C on the
+//                 NTC) over HOST_ADC_PERIOD_S seconds (default 600), +-2
+//                 LSB of noise
+//   Door          pins with an interrupt attached toggle every
+//                 HOST_DOOR_PERIOD_S seconds (default 20, 0 = never), each
+//                 time with two bounce edges 1 ms apart
+//   Relays        output pin changes are printed as "[HOST] GPIO n -> HIGH"
+//   Journal       HOST_DATA_DIR/<label>.img, 64 sectors of 4 KB
+//   Settings      HOST_DATA_DIR/<key>.setting
+//   UDP           a local socket on HOST_UDP_PORT (default: the firmware's
+//                 port, plus 8000 below 1024)
+//   Clock         the system clock, in the firmware's time zone
+//   Wi-Fi         connects HOST_WIFI_FAST_MS after boardWiFiBegin() with a
+//                 cached link, HOST_WIFI_SCAN_MS without (default 0 both),
+//                 and drops HOST_WIFI_DROP_S seconds after each connect
+//                 (default 0 = never)
+
+#include "board_hal.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+const uint8_t HOST_PIN_COUNT = 64;
+const uint32_t HOST_JOURNAL_SECTORS = 64;
+const size_t HOST_REQUEST_LIMIT = 16384;   // Head and body
+
+HostSerial Serial;
+
+// --- Time ---
+
+static const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+int64_t boardUptimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart).count();
+}
+
+uint32_t boardCycleCount() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - hostStart).count();
+}
+
+uint32_t boardCyclesPerUs() {
+    return 1000;
+}
+
+void boardStartClock(const char* timezone) {
+    setenv("TZ", timezone, 1);
+    tzset();
+}
+
+int boardMinuteOfDay() {
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    return local.tm_hour * 60 + local.tm_min;
+}
+
+unsigned long millis() {
+    return (unsigned long)(boardUptimeUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)boardUptimeUs();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static long envOr(const char* name, long fallback) {
+    const char* value = getenv(name);
+    return (value && *value) ? strtol(value, NULL, 10) : fallback;
+}
+
+// --- Serial ---
+
+void HostSerial::print(const char* text) {
+    if (output) {
+        fputs(text, output);
+        fflush(output);
+    }
+}
+
+void boardSerialBegin(unsigned long baud, size_t txBufferSize) {
+    (void)txBufferSize;
+    Serial.begin(baud);
+}
+
+size_t HostSerial::write(const uint8_t* data, size_t length) {
+    if (output) {
+        fwrite(data, 1, length, output);
+        fflush(output);
+    }
+    return length;
+}
+
+// --- Simulated Pins ---
+
+static std::atomic<uint8_t> pinLevels[HOST_PIN_COUNT];
+static uint8_t pinModes[HOST_PIN_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= HOST_PIN_COUNT) return;
+    pinModes[pin] = mode;
+    if (mode == INPUT_PULLUP) {
+        pinLevels[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin >= HOST_PIN_COUNT) return;
+    uint8_t previous = pinLevels[pin].exchange(level ? HIGH : LOW);
+    if (previous != (level ? HIGH : LOW) && pinModes[pin] == OUTPUT) {
+        char line[48];
+        snprintf(line, sizeof(line), "[HOST] GPIO %u -> %s\n", pin, level ? "HIGH" : "LOW");
+        Serial.print(line);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < HOST_PIN_COUNT ? pinLevels[pin].load() : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    (void)pin;
+    static const long low = envOr("HOST_ADC_MIN", 1750);
+    static const long high = envOr("HOST_ADC_MAX", 2350);
+    static const long periodS = envOr("HOST_ADC_PERIOD_S", 600);
+
+    double phase = periodS > 0 ? 2 * M_PI * (boardUptimeUs() / 1e6) / periodS : 0;
+    long value = (low + high) / 2 + lround((high - low) / 2.0 * sin(phase)) + (rand() % 5) - 2;
+    return (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : value);
+}
+
+// One thread toggles every pin that has an interrupt, calling the handler
+// on each edge the way the GPIO interrupt would
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+    (void)mode;
+    long periodS = envOr("HOST_DOOR_PERIOD_S", 20);
+    if (pin >= HOST_PIN_COUNT || periodS <= 0) return;
+
+    std::thread([pin, handler, periodS]() {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(periodS));
+            for (int edge = 0; edge < 3; edge++) {   // Settles on the new level
+                pinLevels[pin] = !pinLevels[pin].load();
+                handler();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }).detach();
+}
+
+void boardConfigureAdc() {
+}
+
+// --- Network and System ---
+
+static std::atomic<int64_t> wifiUpAtUs(-1);   // -1: not connecting
+
+void boardWiFiBegin(const char* ssid, const char* password, const BoardWiFiLink* cached) {
+    (void)ssid;
+    (void)password;
+    long delayMs = cached ? envOr("HOST_WIFI_FAST_MS", 0) : envOr("HOST_WIFI_SCAN_MS", 0);
+    wifiUpAtUs = boardUptimeUs() + delayMs * 1000;
+}
+
+void boardWiFiDisconnect() {
+    wifiUpAtUs = -1;
+}
+
+bool boardWiFiConnected() {
+    int64_t upAtUs = wifiUpAtUs;
+    int64_t nowUs = boardUptimeUs();
+    if (upAtUs < 0 || nowUs < upAtUs) {
+        return false;
+    }
+    long dropS = envOr("HOST_WIFI_DROP_S", 0);
+    if (dropS > 0 && nowUs - upAtUs >= dropS * 1000000LL) {
+        Serial.println("[HOST] Wi-Fi link dropped");
+        wifiUpAtUs = -1;
+        return false;
+    }
+    return true;
+}
+
+bool boardWiFiLinkInfo(BoardWiFiLink& link) {
+    if (!boardWiFiConnected()) {
+        return false;
+    }
+    static const uint8_t BSSID[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    memcpy(link.bssid, BSSID, sizeof(link.bssid));
+    link.channel = 6;
+    link.ip = htonl(INADDR_LOOPBACK);
+    link.gateway = htonl(INADDR_LOOPBACK);
+    link.subnet = htonl(0xFF000000);
+    link.dns = htonl(INADDR_LOOPBACK);
+    return true;
+}
+
+String boardLocalIP() {
+    return String("127.0.0.1");
+}
+
+// glibc's view of the heap: free bytes held by malloc, not what the
+// process could still get from the OS
+uint32_t boardFreeHeap() {
+    return (uint32_t)mallinfo2().fordblks;
+}
+
+// glibc does not report its largest free chunk; the total is an upper bound
+uint32_t boardLargestFreeBlock() {
+    return (uint32_t)mallinfo2().fordblks;
+}
+
+uint32_t boardRandom() {
+    static std::random_device device;
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
+    return device();
+}
+
+bool boardEnableLightSleep() {
+    return false;
+}
+
+void boardRestart() {
+    Serial.println("[HOST] Restart requested, exiting");
+    exit(EXIT_FAILURE);
+}
+
+// --- Journal Storage ---
+
+HostJournalStorage::HostJournalStorage()
+    : FileJournalStorage(imagePath, 4096, HOST_JOURNAL_SECTORS) {
+    partitionLabel[0] = '\0';
+    imagePath[0] = '\0';
+}
+
+bool HostJournalStorage::begin(const char* label) {
+    const char* directory = getenv("HOST_DATA_DIR");
+    snprintf(partitionLabel, sizeof(partitionLabel), "%s", label);
+    snprintf(imagePath, sizeof(imagePath), "%s/%s.img", (directory && *directory) ? directory : ".", label);
+    return open();
+}
+
+const char* HostJournalStorage::label() const {
+    return partitionLabel;
+}
+
+// --- Settings ---
+
+static std::string settingPath(const char* key) {
+    const char* directory = getenv("HOST_DATA_DIR");
+    return std::string((directory && *directory) ? directory : ".") + "/" + key + ".setting";
+}
+
+bool boardSaveSetting(const char* key, const void* data, size_t length) {
+    std::string path = settingPath(key);
+    if (length == 0) {
+        return remove(path.c_str()) == 0 || errno == ENOENT;
+    }
+
+    // Written aside and renamed, so a crash leaves the old or the new blob
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool written = fwrite(data, 1, length, file) == length;
+    written = fclose(file) == 0 && written;
+    return written && rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+size_t boardLoadSetting(const char* key, void* data, size_t capacity) {
+    FILE* file = fopen(settingPath(key).c_str(), "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    size_t loaded = (length > 0 && (size_t)length <= capacity) ? fread(data, 1, length, file) : 0;
+    fclose(file);
+    return loaded == (size_t)length ? loaded : 0;
+}
+
+// --- UDP ---
+
+int boardUdpOpen(uint16_t port) {
+    int listenPort = (int)envOr("HOST_UDP_PORT", port < 1024 ? port + 8000 : port);
+    int socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    int on = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(listenPort);
+    if (socketFd < 0 || bind(socketFd, (sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "[HOST] Cannot bind UDP port %d: %s\n", listenPort, strerror(errno));
+        if (socketFd >= 0) {
+            close(socketFd);
+        }
+        return -1;
+    }
+
+    char line[64];
+    snprintf(line, sizeof(line), "[HOST] UDP on port %d\n", listenPort);
+    Serial.print(line);
+    return socketFd;
+}
+
+int boardUdpReceive(int socketFd, void* buffer, size_t capacity, BoardUdpPeer& from) {
+    sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    ssize_t length;
+    do {
+        length = recvfrom(socketFd, buffer, capacity, 0, (sockaddr*)&address, &addressLength);
+    } while (length < 0 && errno == EINTR);
+    from.address = address.sin_addr.s_addr;
+    from.port = address.sin_port;
+    return (int)length;
+}
+
+bool boardUdpSend(int socketFd, const void* data, size_t length, const BoardUdpPeer& to) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = to.address;
+    address.sin_port = to.port;
+    return sendto(socketFd, data, length, 0, (sockaddr*)&address, sizeof(address)) == (ssize_t)length;
+}
+
+// --- FreeRTOS Subset ---
+
+struct HostQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<uint8_t> items;
+    size_t itemSize;
+    size_t length;
+    size_t head;
+    size_t count;
+};
+
+struct HostTask {
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+
+static thread_local HostTask* currentTask = NULL;
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackBytes,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    (void)name;
+    (void)stackBytes;
+    (void)priority;
+    (void)core;
+    HostTask* hostTask = new HostTask();
+    hostTask->notifications = 0;
+    if (handle) *handle = hostTask;
+    std::thread([task, parameter, hostTask]() {
+        currentTask = hostTask;
+        task(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task != NULL) return;   // Only self-deletion is used
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks) {
+    *previousWake += ticks;
+    std::this_thread::sleep_until(hostStart + std::chrono::milliseconds(*previousWake));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    HostTask* hostTask = (HostTask*)task;
+    std::lock_guard<std::mutex> guard(hostTask->lock);
+    hostTask->notifications++;
+    hostTask->notified.notify_one();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+    if (currentTask == NULL) {
+        currentTask = new HostTask();
+        currentTask->notifications = 0;
+    }
+    std::unique_lock<std::mutex> guard(currentTask->lock);
+    currentTask->notified.wait_for(guard, std::chrono::milliseconds(wait == portMAX_DELAY ? 1000000000UL : wait),
+                                   []() { return currentTask->notifications > 0; });
+    uint32_t count = currentTask->notifications;
+    if (count > 0) {
+        currentTask->notifications = clearOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* queue = new HostQueue();
+    queue->items.resize((size_t)length * itemSize);
+    queue->itemSize = itemSize;
+    queue->length = length;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue->changed.wait_for(guard, std::chrono::milliseconds(wait == portMAX_DELAY ? 1000000000UL : wait),
+                                 [queue]() { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+    size_t slot = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->items[slot * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue->changed.wait_for(guard, std::chrono::milliseconds(wait == portMAX_DELAY ? 1000000000UL : wait),
+                                 [queue]() { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+// --- WiFiClient ---
+
+WiFiClient WiFiClient::discard() {
+    WiFiClient client;
+    client.connection = std::make_shared<Connection>(-1);
+    return client;
+}
+
+WiFiClient WiFiClient::adopt(int socketFd) {
+    WiFiClient client;
+    client.connection = std::make_shared<Connection>(socketFd);
+    return client;
+}
+
+WiFiClient::Connection::~Connection() {
+    if (fd >= 0 && !stopped) {
+        close(fd);
+    }
+}
+
+bool WiFiClient::connected() {
+    if (!connection || connection->stopped) {
+        return false;
+    }
+    if (connection->fd < 0) {
+        return true;
+    }
+
+    // Readable with 0 bytes means the peer closed
+    char byte;
+    ssize_t peeked = recv(connection->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return peeked > 0 || (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+int WiFiClient::available() {
+    if (!connection || connection->stopped || connection->fd < 0) {
+        return 0;
+    }
+    int waiting = 0;
+    return ioctl(connection->fd, FIONREAD, &waiting) == 0 ? waiting : 0;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (!connection || connection->stopped || connection->fd < 0) {
+        return -1;
+    }
+    ssize_t received = recv(connection->fd, buffer, size, MSG_DONTWAIT);
+    return received > 0 ? (int)received : -1;
+}
+
+size_t WiFiClient::write(const uint8_t* data, size_t length) {
+    if (!connection || connection->stopped) {
+        return 0;
+    }
+
+    size_t sent = 0;
+    if (connection->fd < 0) {
+        sent = length;
+    } else {
+        while (sent < length) {
+            ssize_t part = send(connection->fd, data + sent, length - sent, MSG_NOSIGNAL);
+            if (part <= 0) break;
+            sent += part;
+        }
+    }
+    connection->bytesWritten += sent;
+    return sent;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+    if (connection && connection->fd >= 0) {
+        int flag = noDelay ? 1 : 0;
+        setsockopt(connection->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+}
+
+void WiFiClient::stop() {
+    if (connection && !connection->stopped) {
+        if (connection->fd >= 0) {
+            close(connection->fd);
+        }
+        connection->stopped = true;
+    }
+}
+
+size_t WiFiClient::written() const {
+    return connection ? connection->bytesWritten : 0;
+}
+
+// --- WebServer ---
+
+static const size_t CONTENT_LENGTH_NOT_SET = (size_t)-2;
+
+static const char* reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 426: return "Upgrade Required";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "";
+    }
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static std::string urlDecode(const std::string& text) {
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') {
+            decoded += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && hexDigit(text[i + 1]) >= 0 && hexDigit(text[i + 2]) >= 0) {
+            decoded += (char)(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+WebServer::WebServer(int port)
+    : port(port), listenFd(-1), notFoundHandler(NULL), http11(true),
+      contentLength(CONTENT_LENGTH_NOT_SET), chunked(false) {}
+
+WebServer::~WebServer() {
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+}
+
+void WebServer::on(const char* uri, THandlerFunction handler) {
+    routes.push_back(std::make_pair(std::string(uri), handler));
+}
+
+void WebServer::onNotFound(THandlerFunction handler) {
+    notFoundHandler = handler;
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], size_t count) {
+    collectedHeaders.assign(headerKeys, headerKeys + count);
+}
+
+void WebServer::begin() {
+    int listenPort = (int)envOr("HOST_HTTP_PORT", port < 1024 ? port + 8000 : port);
+
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(listenPort);
+    if (listenFd < 0 || bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 8) != 0) {
+        fprintf(stderr, "[HOST] Cannot listen on port %d: %s\n", listenPort, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+    char line[64];
+    snprintf(line, sizeof(line), "[HOST] HTTP on port %d\n", listenPort);
+    Serial.print(line);
+}
+
+void WebServer::handleClient() {
+    int fd = listenFd < 0 ? -1 : accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    timeval timeout = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    WiFiClient client = WiFiClient::adopt(fd);
+
+    std::string request;
+    char buffer[512];
+    size_t headEnd;
+    while ((headEnd = request.find("\r\n\r\n")) == std::string::npos && request.size() < HOST_REQUEST_LIMIT) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        request.append(buffer, received);
+    }
+
+    // A body (POST) follows the head; Content-Length says how long it is
+    if (headEnd != std::string::npos) {
+        size_t bodyStart = headEnd + 4;
+        size_t contentLength = 0;
+        for (size_t at = request.find("\r\n"); at < headEnd; at = request.find("\r\n", at + 2)) {
+            if (strncasecmp(request.c_str() + at + 2, "Content-Length:", 15) == 0) {
+                contentLength = strtoul(request.c_str() + at + 17, NULL, 10);
+            }
+        }
+        while (request.size() < bodyStart + contentLength && request.size() < HOST_REQUEST_LIMIT) {
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) break;
+            request.append(buffer, received);
+        }
+    }
+    handleRequest(request.c_str(), client);
+}
+
+void WebServer::handleRequest(const char* request, WiFiClient client) {
+    currentClient = client;
+    responseHeaders.clear();
+    contentLength = CONTENT_LENGTH_NOT_SET;
+    chunked = false;
+
+    if (!parseRequest(request)) {
+        http11 = false;
+        send(400, "text/plain", "Bad Request");
+    } else {
+        THandlerFunction handler = notFoundHandler;
+        for (size_t i = 0; i < routes.size(); i++) {
+            if (routes[i].first == requestUri.c_str()) {
+                handler = routes[i].second;
+                break;
+            }
+        }
+        if (handler) {
+            handler();
+        } else {
+            send(404, "text/plain", "Not Found");
+        }
+    }
+
+    currentClient = WiFiClient();
+}
+
+bool WebServer::parseRequest(const std::string& request) {
+    requestArgs.clear();
+    requestHeaders.clear();
+
+    size_t lineEnd = request.find("\r\n");
+    std::string line = request.substr(0, lineEnd);
+    size_t methodEnd = line.find(' ');
+    size_t targetEnd = line.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || targetEnd == std::string::npos) {
+        return false;
+    }
+
+    std::string method = line.substr(0, methodEnd);
+    requestMethod = method == "POST" ? HTTP_POST : method == "PUT" ? HTTP_PUT : method == "DELETE" ? HTTP_DELETE
+                  : method == "OPTIONS" ? HTTP_OPTIONS : HTTP_GET;
+    std::string target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    http11 = line.compare(targetEnd + 1, std::string::npos, "HTTP/1.1") == 0;
+
+    size_t queryStart = target.find('?');
+    requestUri = String(target.substr(0, queryStart));
+    if (queryStart != std::string::npos) {
+        std::string query = target.substr(queryStart + 1);
+        size_t at = 0;
+        while (at <= query.size()) {
+            size_t end = query.find('&', at);
+            if (end == std::string::npos) end = query.size();
+            std::string pair = query.substr(at, end - at);
+            if (!pair.empty()) {
+                size_t equals = pair.find('=');
+                requestArgs.push_back(Field(urlDecode(pair.substr(0, equals)),
+                                            equals == std::string::npos ? "" : urlDecode(pair.substr(equals + 1))));
+            }
+            at = end + 1;
+        }
+    }
+
+    while (lineEnd != std::string::npos) {
+        size_t start = lineEnd + 2;
+        lineEnd = request.find("\r\n", start);
+        line = request.substr(start, lineEnd == std::string::npos ? std::string::npos : lineEnd - start);
+        if (line.empty()) break;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        requestHeaders.push_back(Field(line.substr(0, colon),
+                                       valueStart == std::string::npos ? "" : line.substr(valueStart)));
+    }
+
+    // Like the ESP32 server, a request body is the "plain" argument
+    if (lineEnd != std::string::npos && lineEnd + 2 < request.size()) {
+        requestArgs.push_back(Field("plain", request.substr(lineEnd + 2)));
+    }
+    return true;
+}
+
+bool WebServer::hasArg(const char* name) const {
+    for (size_t i = 0; i < requestArgs.size(); i++) {
+        if (requestArgs[i].first == name) return true;
+    }
+    return false;
+}
+
+String WebServer::arg(const char* name) const {
+    for (size_t i = 0; i < requestArgs.size(); i++) {
+        if (requestArgs[i].first == name) return String(requestArgs[i].second);
+    }
+    return String("");
+}
+
+// Like the ESP32 server, only headers named in collectHeaders() are kept
+String WebServer::header(const char* name) const {
+    bool collected = false;
+    for (size_t i = 0; i < collectedHeaders.size(); i++) {
+        collected = collected || strcasecmp(collectedHeaders[i].c_str(), name) == 0;
+    }
+    for (size_t i = 0; collected && i < requestHeaders.size(); i++) {
+        if (strcasecmp(requestHeaders[i].first.c_str(), name) == 0) return String(requestHeaders[i].second);
+    }
+    return String("");
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    Field field(name.c_str(), value.c_str());
+    if (first) {
+        responseHeaders.insert(responseHeaders.begin(), field);
+    } else {
+        responseHeaders.push_back(field);
+    }
+}
+
+void WebServer::sendResponseHead(int code, const char* contentType, size_t length) {
+    std::string head = "HTTP/1.1 " + std::to_string(code) + " " + reasonPhrase(code) + "\r\n";
+    if (contentType) {
+        head += std::string("Content-Type: ") + contentType + "\r\n";
+    }
+    for (size_t i = 0; i < responseHeaders.size(); i++) {
+        head += responseHeaders[i].first + ": " + responseHeaders[i].second + "\r\n";
+    }
+    if (chunked) {
+        head += "Transfer-Encoding: chunked\r\n";
+    } else if (length != CONTENT_LENGTH_UNKNOWN) {
+        head += "Content-Length: " + std::to_string(length) + "\r\n";
+    }
+    head += "Connection: close\r\n\r\n";
+
+    currentClient.write((const uint8_t*)head.data(), head.size());
+    responseHeaders.clear();
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    if (contentLength == CONTENT_LENGTH_UNKNOWN) {
+        chunked = http11;
+        sendResponseHead(code, contentType, CONTENT_LENGTH_UNKNOWN);
+        if (content.length() > 0) {
+            sendContent(content);
+        }
+    } else {
+        sendResponseHead(code, contentType, content.length());
+        currentClient.write((const uint8_t*)content.c_str(), content.length());
+    }
+    contentLength = CONTENT_LENGTH_NOT_SET;
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content, size_t length) {
+    sendResponseHead(code, contentType, length);
+    currentClient.write((const uint8_t*)content, length);
+    contentLength = CONTENT_LENGTH_NOT_SET;
+}
+
+// An empty chunk ends a chunked response
+void WebServer::sendContent(const char* content, size_t length) {
+    if (!chunked) {
+        currentClient.write((const uint8_t*)content, length);
+        return;
+    }
+
+    char size[16];
+    int sizeLength = snprintf(size, sizeof(size), "%zx\r\n", length);
+    currentClient.write((const uint8_t*)size, sizeLength);
+    currentClient.write((const uint8_t*)content, length);
+    currentClient.write((const uint8_t*)"\r\n", 2);
+    if (length == 0) {
+        chunked = false;
+    }
+}
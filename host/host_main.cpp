@@ -0,0 +1,15 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Linux Host Entry Point
+// ----------------------------------------------------
+// Runs the ESP32 firmware as a process, the way the Arduino core does:
+// setup() once, then loop() forever.
+
+void setup();
+void loop();
+
+int main() {
+    setup();
+    for (;;) {
+        loop();
+    }
+}
@@ -0,0 +1,38 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Host Test Checks
+// ----------------------------------------------------
+// Shared by the host/tests programs. CHECK() reports a failed condition and
+// carries on, so one run lists every failure; testResult() turns the count
+// into the exit status ctest looks at.
+
+#pragma once
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+// Like CHECK, with the two values printed when they differ
+#define CHECK_EQUAL(actual, expected) do { \
+        long long checkActual = (long long)(actual), checkExpected = (long long)(expected); \
+        if (checkActual != checkExpected) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, \
+                    #actual, #expected, checkActual, checkExpected); \
+            testFailures++; \
+        } \
+    } while (0)
+
+inline int testResult(const char* name) {
+    if (testFailures == 0) {
+        printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    printf("%s: %d check(s) failed\n", name, testFailures);
+    return 1;
+}
@@ -0,0 +1,165 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Command Name Tests
+// ----------------------------------------------------
+// Checks that commandName() gives every command the name the app sends it
+// by: table commands by their table name, device commands by the device
+// table's name and action, and the retired values in old journal records
+// by their old names. /LOG prints these names for JOURNAL_COMMAND and
+// JOURNAL_RULE records. Also checks the device name index behind
+// findDeviceCommand() on the sketch's table and on a full MAX_DEVICES one.
+
+#include "../../command_table.h"
+#include "test_devices.h"
+#include "test_check.h"
+
+#include <string>
+
+// "" when commandName() returns false
+std::string nameOf(CommandType type, uint8_t device, size_t size = BATCH_ENTRY_BUFFER_SIZE) {
+    char name[BATCH_ENTRY_BUFFER_SIZE];
+    memset(name, 'x', sizeof(name));
+    bool named = commandName(type, device, DEVICES, name, size);
+    CHECK(size == 0 || strlen(name) < size);
+    return named ? std::string(name) : std::string();
+}
+
+void checkName(CommandType type, uint8_t device, const char* expected, int line) {
+    std::string name = nameOf(type, device);
+    if (name != expected) {
+        fprintf(stderr, "line %d: command %u on device %u is \"%s\", expected \"%s\"\n",
+                line, type, device, name.c_str(), expected);
+        testFailures++;
+    }
+}
+
+#define CHECK_NAME(type, device, expected) checkName(type, device, expected, __LINE__)
+
+void testTableCommands() {
+    CHECK_NAME(CMD_SET_THRESHOLD, 0, "SET_THRESHOLD");
+    CHECK_NAME(CMD_STATUS, 0, "STATUS");
+    CHECK_NAME(CMD_STATUS_FRAME, 0, "STATUS.bin");
+    CHECK_NAME(CMD_BATCH, 0, "BATCH");
+}
+
+void testDeviceCommands() {
+    CHECK_NAME(CMD_DEVICE_ON, DEVICE_LAMP, "LAMP_ON");
+    CHECK_NAME(CMD_DEVICE_OFF, DEVICE_PLUG, "PLUG_OFF");
+    CHECK_NAME(CMD_DEVICE_TOGGLE, DEVICE_ALARM, "ALARM_TOGGLE");
+
+    // Every name round-trips through the parser to the same command
+    for (uint8_t device = 0; device < DEVICE_COUNT; device++) {
+        if (!deviceIsOutput(DEVICE_SPECS[device])) {
+            continue;
+        }
+        for (uint8_t type = CMD_DEVICE_ON; type <= CMD_DEVICE_TOGGLE; type++) {
+            std::string name = nameOf((CommandType)type, device);
+            uint8_t parsedDevice = 0xFF;
+            DeviceAction action = DEVICE_ACTION_COUNT;
+            CHECK(findDeviceCommand(name.c_str(), name.size(), DEVICES, parsedDevice, action));
+            CHECK_EQUAL(parsedDevice, device);
+            CHECK_EQUAL(CMD_DEVICE_ON + action, type);
+        }
+    }
+
+    // A device the table does not have
+    CHECK_NAME(CMD_DEVICE_ON, DEVICE_COUNT, "");
+    CHECK_NAME(CMD_DEVICE_TOGGLE, MAX_DEVICES - 1, "");
+}
+
+void testRetiredCommands() {
+    for (uint8_t type = 0; type < CMD_SET_THRESHOLD; type++) {
+        CHECK_NAME((CommandType)type, 0, RETIRED_COMMAND_NAMES[type]);
+    }
+}
+
+void testUnknownAndShortBuffers() {
+    CHECK_NAME((CommandType)(CMD_DEVICE_TOGGLE + 1), 0, "");
+    CHECK_NAME((CommandType)0xFF, DEVICE_LAMP, "");
+
+    // Cut to fit, always terminated
+    CHECK(nameOf(CMD_DEVICE_TOGGLE, DEVICE_ALARM, 6) == "ALARM");
+    CHECK(nameOf(CMD_DEVICE_TOGGLE, DEVICE_ALARM, 8) == "ALARM_T");
+    CHECK(nameOf(CMD_SET_THRESHOLD, 0, 4) == "SET");
+    CHECK(nameOf(CMD_DEVICE_ON, DEVICE_LAMP, 1) == "");
+    CHECK(nameOf(CMD_DEVICE_ON, DEVICE_LAMP, 0) == "");
+}
+
+// MAX_DEVICES rows, every third a sensor, names that share long prefixes
+constexpr DeviceSpec LARGE_SPECS[MAX_DEVICES] = {
+#define LARGE_ROW(n) { "NODE_" #n, (uint8_t)(n), (n) % 3 == 2 ? KIND_BINARY_SENSOR : KIND_RELAY, false, "ON", "OFF" }
+    LARGE_ROW(0),  LARGE_ROW(1),  LARGE_ROW(2),  LARGE_ROW(3),  LARGE_ROW(4),  LARGE_ROW(5),  LARGE_ROW(6),  LARGE_ROW(7),
+    LARGE_ROW(8),  LARGE_ROW(9),  LARGE_ROW(10), LARGE_ROW(11), LARGE_ROW(12), LARGE_ROW(13), LARGE_ROW(14), LARGE_ROW(15),
+    LARGE_ROW(16), LARGE_ROW(17), LARGE_ROW(18), LARGE_ROW(19), LARGE_ROW(20), LARGE_ROW(21), LARGE_ROW(22), LARGE_ROW(23),
+    LARGE_ROW(24), LARGE_ROW(25), LARGE_ROW(26), LARGE_ROW(27), LARGE_ROW(28), LARGE_ROW(29), LARGE_ROW(30), LARGE_ROW(31),
+#undef LARGE_ROW
+};
+typedef DeviceNameIndex<LARGE_SPECS, MAX_DEVICES> LargeIndex;
+const DeviceTable LARGE_DEVICES = { LARGE_SPECS, MAX_DEVICES, LargeIndex::slots, LargeIndex::BITS, LargeIndex::SEED };
+
+// Every output of the table resolves through its name index, nothing else does
+void checkDeviceIndex(const DeviceTable& devices) {
+    for (uint8_t device = 0; device < devices.count; device++) {
+        for (uint8_t a = 0; a < DEVICE_ACTION_COUNT; a++) {
+            std::string name = std::string(devices.specs[device].name) + DEVICE_ACTION_SUFFIXES[a];
+            uint8_t found = NO_DEVICE;
+            DeviceAction action = DEVICE_ACTION_COUNT;
+            bool resolved = findDeviceCommand(name.c_str(), name.size(), devices, found, action);
+            CHECK_EQUAL(resolved, deviceIsOutput(devices.specs[device]));
+            if (resolved) {
+                CHECK_EQUAL(found, device);
+                CHECK_EQUAL(action, a);
+            }
+
+            // A prefix or an extension of the name is another device
+            std::string shorter = name.substr(1);
+            std::string longer = "X" + name;
+            CHECK(!findDeviceCommand(shorter.c_str(), shorter.size(), devices, found, action)
+                  || found != device);
+            CHECK(!findDeviceCommand(longer.c_str(), longer.size(), devices, found, action));
+        }
+    }
+
+    uint8_t found;
+    DeviceAction action;
+    const char* const unknown[] = { "_ON", "ON", "LAMP", "LAMP_", "LAMP_DIM", "LAMPS_ON", "lamp_on", "NODE_32_ON" };
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        CHECK(!findDeviceCommand(unknown[i], strlen(unknown[i]), devices, found, action));
+    }
+
+    // Every slot is empty or holds an output that hashes there
+    for (uint16_t slot = 0; slot < (1u << devices.slotBits); slot++) {
+        uint8_t device = devices.slots[slot];
+        if (device != NO_DEVICE) {
+            CHECK(device < devices.count && deviceIsOutput(devices.specs[device]));
+            const char* name = devices.specs[device].name;
+            CHECK_EQUAL(deviceSlotOf(name, strlen(name), devices.seed, devices.slotBits), slot);
+        }
+    }
+}
+
+void testDeviceIndex() {
+    checkDeviceIndex(DEVICES);
+    checkDeviceIndex(LARGE_DEVICES);
+    CHECK_EQUAL(1u << DeviceIndex::BITS, 64);
+    CHECK_EQUAL(1u << LargeIndex::BITS, 256);
+
+    // Through the parser, argument checks included
+    ParsedCommand command = { CMD_STATUS, 0, 0 };
+    CHECK_EQUAL(parseCommand("NODE_30_TOGGLE", LARGE_DEVICES, command), COMMAND_OK);
+    CHECK_EQUAL(command.type, CMD_DEVICE_TOGGLE);
+    CHECK_EQUAL(command.device, 30);
+    CHECK_EQUAL(parseCommand("NODE_30_TOGGLE:1", LARGE_DEVICES, command), COMMAND_BAD_ARG);
+    CHECK_EQUAL(parseCommand("NODE_29_ON", LARGE_DEVICES, command), COMMAND_UNKNOWN);   // A sensor
+    CHECK_EQUAL(parseCommand("LAMP_OFF", DEVICES, command), COMMAND_OK);
+    CHECK_EQUAL(command.device, DEVICE_LAMP);
+    CHECK_EQUAL(parseCommand("DOOR_ON", DEVICES, command), COMMAND_UNKNOWN);
+}
+
+int main() {
+    testTableCommands();
+    testDeviceCommands();
+    testRetiredCommands();
+    testUnknownAndShortBuffers();
+    testDeviceIndex();
+    return testResult("test_command_table");
+}
@@ -0,0 +1,31 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Test Device Table
+// ----------------------------------------------------
+// The ESP32's device table (esp32_main_code.cpp), for tests of the shared
+// headers that take a DeviceTable. Keep the rows in step with the sketch;
+// the names, kinds and order are what the tests rely on.
+
+#pragma once
+
+#include "../../device_registry.h"
+
+enum DeviceId : uint8_t {
+    DEVICE_TEMP,
+    DEVICE_DOOR,
+    DEVICE_LAMP,
+    DEVICE_PLUG,
+    DEVICE_ALARM,
+    DEVICE_COUNT
+};
+
+constexpr DeviceSpec DEVICE_SPECS[DEVICE_COUNT] = {
+    // name    pin  kind                activeLow  on       off
+    { "TEMP",  34, KIND_ANALOG_SENSOR, false,     NULL,    NULL     },
+    { "DOOR",  14, KIND_BINARY_SENSOR, false,     "OPEN",  "CLOSED" },
+    { "LAMP",  26, KIND_RELAY,         true,      "ON",    "OFF"    },
+    { "PLUG",  27, KIND_RELAY,         true,      "ON",    "OFF"    },
+    { "ALARM", 25, KIND_ALARM,         false,     "ALARM", "SAFE"   },
+};
+
+typedef DeviceNameIndex<DEVICE_SPECS, DEVICE_COUNT> DeviceIndex;
+const DeviceTable DEVICES = { DEVICE_SPECS, DEVICE_COUNT, DeviceIndex::slots, DeviceIndex::BITS, DeviceIndex::SEED };
@@ -0,0 +1,200 @@
+// ----------------------------------------------------
+// Smart Home Prototype - HTTP Request Parser Tests
+// ----------------------------------------------------
+// Feeds http_request_parser.h the way the Uno's pumpEsp8266() does: the
+// payload of each "+IPD,<id>,<len>:" frame byte by byte, and close(id) for
+// "<id>,CLOSED". Checks which request lines come out, on which link, with
+// the Uno's own buffer size.
+
+#include "../../http_request_parser.h"
+#include "test_check.h"
+
+#include <string>
+#include <vector>
+
+const uint8_t MAX_ESP_CONNECTIONS = 5;
+const uint8_t REQUEST_LINE_BUFFER_SIZE = 96;
+
+typedef HttpRequestParser<MAX_ESP_CONNECTIONS, REQUEST_LINE_BUFFER_SIZE> Parser;
+
+struct Request {
+    int connectionId;
+    std::string action;
+};
+
+std::vector<Request> requests;
+
+void onRequest(int connectionId, const char* action) {
+    Request request = { connectionId, action };
+    requests.push_back(request);
+}
+
+// One +IPD frame
+void frame(Parser& parser, int connectionId, const std::string& payload) {
+    for (size_t i = 0; i < payload.size(); i++) {
+        parser.feed(connectionId, payload[i], onRequest);
+    }
+}
+
+void checkRequests(const std::vector<Request>& expected, int line) {
+    if (requests.size() != expected.size()) {
+        fprintf(stderr, "line %d: %zu request(s), expected %zu\n", line, requests.size(), expected.size());
+        testFailures++;
+    }
+    for (size_t i = 0; i < requests.size() && i < expected.size(); i++) {
+        if (requests[i].connectionId != expected[i].connectionId || requests[i].action != expected[i].action) {
+            fprintf(stderr, "line %d: request %zu is %d \"%s\", expected %d \"%s\"\n", line, i,
+                    requests[i].connectionId, requests[i].action.c_str(),
+                    expected[i].connectionId, expected[i].action.c_str());
+            testFailures++;
+        }
+    }
+    requests.clear();
+}
+
+#define CHECK_REQUESTS(...) checkRequests(std::vector<Request> { __VA_ARGS__ }, __LINE__)
+
+const std::string HEADERS = "Host: 192.168.4.1\r\nUser-Agent: app\r\nAccept: */*\r\n\r\n";
+
+void testSingleFrame() {
+    Parser parser;
+    frame(parser, 0, "GET /LAMP_ON HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 0, "LAMP_ON" });
+}
+
+void testLineSplitAcrossFrames() {
+    Parser parser;
+    frame(parser, 2, "GE");
+    frame(parser, 2, "T /PLUG_TOG");
+    CHECK_REQUESTS();
+    frame(parser, 2, "GLE HTTP/1.1\r");
+    frame(parser, 2, "\nHost: 192.168.4.1\r\n\r");
+    CHECK_REQUESTS({ 2, "PLUG_TOGGLE" });
+
+    // The blank line ending the headers split too, then the next request
+    frame(parser, 2, "\nGET /STATUS HTTP/1.1\r\n\r\n");
+    CHECK_REQUESTS({ 2, "STATUS" });
+}
+
+void testPipelinedRequests() {
+    Parser parser;
+    frame(parser, 1, "GET /LAMP_ON HTTP/1.1\r\n" + HEADERS + "GET /STATUS.bin HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 1, "LAMP_ON" }, { 1, "STATUS.bin" });
+}
+
+void testHttpVersions() {
+    Parser parser;
+    frame(parser, 0, "GET /ALARM_OFF HTTP/1.0\r\n\r\n");
+    CHECK_REQUESTS({ 0, "ALARM_OFF" });
+
+    // HTTP/0.9 style: no version and no headers
+    frame(parser, 0, "GET /SET_THRESHOLD:28.5\r\n");
+    CHECK_REQUESTS({ 0, "SET_THRESHOLD:28.5" });
+    frame(parser, 0, "\r\n");   // Ends the (empty) headers
+    frame(parser, 0, "GET /STATUS\n\n");
+    CHECK_REQUESTS({ 0, "STATUS" });
+
+    // Only GET runs a command; the rest still get the status
+    frame(parser, 0, "POST /LAMP_ON HTTP/1.1\r\n" + HEADERS);
+    frame(parser, 0, "GET LAMP_ON HTTP/1.1\r\n" + HEADERS);
+    frame(parser, 0, "GET\r\n\r\n");
+    CHECK_REQUESTS({ 0, "" }, { 0, "" }, { 0, "" });
+}
+
+void testBlankLinesBeforeRequest() {
+    Parser parser;
+    frame(parser, 3, "\r\n\r\nGET /PLUG_OFF HTTP/1.1\r\n\r\n");
+    CHECK_REQUESTS({ 3, "PLUG_OFF" });
+}
+
+void testInterleavedLink() {
+    Parser parser;
+
+    // Link 1's frame cuts link 0's line short: link 0 is answered with the
+    // plain status at once, and its rest is taken as headers
+    frame(parser, 0, "GET /LAMP_O");
+    frame(parser, 1, "GET /PLUG_ON HTTP/1.1\r\n");
+    CHECK_REQUESTS({ 0, "" }, { 1, "PLUG_ON" });
+    frame(parser, 0, "N HTTP/1.1\r\n" + HEADERS);
+    frame(parser, 1, HEADERS);
+    CHECK_REQUESTS();
+
+    // A path that was complete when the line was cut still counts
+    frame(parser, 0, "GET /LAMP_ON ");
+    frame(parser, 4, "GET /STATUS HTTP/1.1\r\n\r\n");
+    CHECK_REQUESTS({ 0, "LAMP_ON" }, { 4, "STATUS" });
+    frame(parser, 0, "HTTP/1.1\r\n" + HEADERS);
+
+    // Headers of one link never disturb another link's request line
+    frame(parser, 2, "GET /ALARM_ON HTTP/1.1\r\nHost: x\r\n");
+    CHECK_REQUESTS({ 2, "ALARM_ON" });
+    frame(parser, 3, "GET /STA");
+    frame(parser, 2, "Accept: */*\r\n\r\n");
+    CHECK_REQUESTS();
+    frame(parser, 3, "TUS\r\n\r\n");
+    CHECK_REQUESTS({ 3, "STATUS" });
+}
+
+void testOverlongLine() {
+    Parser parser;
+
+    // The path fits; the version does not
+    std::string path(REQUEST_LINE_BUFFER_SIZE - 10, 'A');
+    frame(parser, 0, "GET /" + path + " HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 0, path });
+
+    // The path itself is cut: not run, answered with the status
+    std::string batch = "BATCH:";
+    while (batch.size() < 2 * REQUEST_LINE_BUFFER_SIZE) {
+        batch += "LAMP_ON,";
+    }
+    frame(parser, 1, "GET /" + batch + " HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 1, "" });
+
+    // The next request parses normally
+    frame(parser, 1, "GET /PLUG_ON HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 1, "PLUG_ON" });
+}
+
+void testClosedMidRequest() {
+    Parser parser;
+
+    // Closed inside the request line: nothing runs, the next client on the
+    // same link id starts clean
+    frame(parser, 0, "GET /LAMP_ON HT");
+    parser.close(0);
+    CHECK_REQUESTS();
+    frame(parser, 0, "GET /PLUG_ON HTTP/1.1\r\n" + HEADERS);
+    CHECK_REQUESTS({ 0, "PLUG_ON" });
+
+    // Closed inside the headers: the next client's line is a request line
+    frame(parser, 1, "GET /STATUS HTTP/1.1\r\nHost: 192.1");
+    CHECK_REQUESTS({ 1, "STATUS" });
+    parser.close(1);
+    frame(parser, 1, "GET /ALARM_OFF HTTP/1.1\r\n\r\n");
+    CHECK_REQUESTS({ 1, "ALARM_OFF" });
+
+    // Closing another link leaves a line in progress alone
+    frame(parser, 2, "GET /LAMP_");
+    parser.close(3);
+    frame(parser, 2, "OFF HTTP/1.1\r\n\r\n");
+    CHECK_REQUESTS({ 2, "LAMP_OFF" });
+
+    // Out-of-range ids are ignored
+    parser.close(-1);
+    parser.close(MAX_ESP_CONNECTIONS);
+    frame(parser, MAX_ESP_CONNECTIONS, "GET /LAMP_ON\r\n\r\n");
+    CHECK_REQUESTS();
+}
+
+int main() {
+    testSingleFrame();
+    testLineSplitAcrossFrames();
+    testPipelinedRequests();
+    testHttpVersions();
+    testBlankLinesBeforeRequest();
+    testInterleavedLink();
+    testOverlongLine();
+    testClosedMidRequest();
+    return testResult("test_http_request_parser");
+}
@@ -0,0 +1,74 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Latency Metrics Tests
+// ----------------------------------------------------
+// Checks metrics.h's bucket bounds, and that snapshot() taken by another
+// thread while the single writer records is never torn: with every sample
+// the same duration, the sum must always be that duration times the count
+// of the buckets, and counts never go backwards.
+
+#include "../../metrics.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <thread>
+
+MetricsTable<true, 2> metrics;
+
+void testBuckets() {
+    LatencyHistogram histogram = {};
+    const uint32_t samples[] = { 0, 1, 2, 3, 4, 5, 1024, 1025, 32768, 32769, 0xFFFFFFFF };
+    const uint8_t expected[] = { 0, 0, 1, 2, 2, 3, 10, 11, 15, 16, 16 };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        LatencyHistogram one = {};
+        one.record(samples[i]);
+        CHECK_EQUAL(one.buckets[expected[i]], 1);
+        CHECK_EQUAL(one.count(), 1);
+        CHECK(samples[i] <= 1 || expected[i] == METRIC_BUCKETS - 1 || samples[i] <= metricBucketBoundUs(expected[i]));
+        histogram.record(samples[i]);
+    }
+    CHECK_EQUAL(histogram.count(), sizeof(samples) / sizeof(samples[0]));
+
+    MetricsTable<false, 2> disabled;
+    disabled.record(0, 5);
+    CHECK_EQUAL(disabled.snapshot(0).count(), 0);
+}
+
+void testSnapshotWhileRecording() {
+    const uint32_t SAMPLE_US = 3;
+    const uint32_t SNAPSHOTS = 300000;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> recorded(0);
+    std::thread writer([&stop, &recorded]() {
+        uint32_t count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            metrics.record(1, SAMPLE_US);
+            count++;
+        }
+        recorded = count;
+    });
+
+    uint32_t torn = 0;
+    uint32_t lastCount = 0;
+    for (uint32_t i = 0; i < SNAPSHOTS; i++) {
+        LatencyHistogram copy = metrics.snapshot(1);
+        uint32_t count = copy.count();
+        if (copy.sumUs != (uint64_t)count * SAMPLE_US || count < lastCount) {
+            torn++;
+        }
+        lastCount = count;
+    }
+    stop = true;
+    writer.join();
+
+    CHECK_EQUAL(torn, 0);
+    CHECK_EQUAL(metrics.snapshot(1).count(), recorded.load());
+    CHECK_EQUAL(metrics.snapshot(1).sumUs, (uint64_t)recorded.load() * SAMPLE_US);
+    CHECK_EQUAL(metrics.snapshot(0).count(), 0);
+    printf("[METRICS] %u snapshots during %u records\n", SNAPSHOTS, recorded.load());
+}
+
+int main() {
+    testBuckets();
+    testSnapshotWhileRecording();
+    return testResult("test_metrics");
+}
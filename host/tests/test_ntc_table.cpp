@@ -0,0 +1,108 @@
+// ----------------------------------------------------
+// Smart Home Prototype - NTC Lookup Table Tests
+// ----------------------------------------------------
+// Builds both firmwares' NtcTables from ntc_table.h, with the divider and
+// thermistor values of esp32_main_code.cpp (4096 codes) and
+// arduino_main_code.cpp (1024 codes), and compares every entry with the
+// Beta equation evaluated with libm's log(). The compile-time ln() series
+// and the rounding must stay within 0.05 C. Codes the firmware clamps to
+// the int16 limit (a shorted ESP32 divider, adc <= 10, and Uno code 1) are
+// checked for the sentinel instead.
+
+#include "../../ntc_table.h"
+#include "test_check.h"
+
+#include <math.h>
+
+// As in the sketches
+constexpr float NOMINAL_RESISTANCE = 100000;
+constexpr float NOMINAL_TEMPERATURE = 25;
+constexpr int BETA_COEFFICIENT = 3950;
+constexpr float REFERENCE_RESISTANCE = 100000;
+constexpr int ESP32_ADC_RESOLUTION = 4096;
+constexpr int UNO_ADC_RESOLUTION = 1024;
+
+const double TOLERANCE_CENTI = 5;   // 0.05 C
+
+struct Esp32Thermistor {
+    static constexpr int16_t centiCelsiusAt(int adc) {
+        return ntcBetaCentiCelsius(ntcResistanceToGround(adc, ESP32_ADC_RESOLUTION, REFERENCE_RESISTANCE, NOMINAL_RESISTANCE),
+                                   NOMINAL_RESISTANCE, NOMINAL_TEMPERATURE, BETA_COEFFICIENT);
+    }
+};
+
+struct UnoThermistor {
+    static constexpr int16_t centiCelsiusAt(int adc) {
+        return ntcBetaCentiCelsius(ntcResistanceToSupply(adc, UNO_ADC_RESOLUTION, REFERENCE_RESISTANCE, NOMINAL_RESISTANCE),
+                                   NOMINAL_RESISTANCE, NOMINAL_TEMPERATURE, -BETA_COEFFICIENT);
+    }
+};
+
+typedef NtcLookupTable<Esp32Thermistor, MakeIndexList<ESP32_ADC_RESOLUTION>::type> Esp32NtcTable;
+typedef NtcLookupTable<UnoThermistor, MakeIndexList<UNO_ADC_RESOLUTION>::type> UnoNtcTable;
+
+static_assert(sizeof(Esp32NtcTable::centiC) == ESP32_ADC_RESOLUTION * sizeof(int16_t), "One entry per ESP32 code");
+static_assert(sizeof(UnoNtcTable::centiC) == UNO_ADC_RESOLUTION * sizeof(int16_t), "One entry per Uno code");
+
+// The reference, written out independently of ntc_table.h
+
+double esp32Resistance(int adc) {
+    if (adc <= 10) {
+        return 100.0;
+    }
+    if (adc >= ESP32_ADC_RESOLUTION - 10) {
+        return NOMINAL_RESISTANCE * 100.0;   // Open circuit
+    }
+    return REFERENCE_RESISTANCE * adc / (ESP32_ADC_RESOLUTION - adc);
+}
+
+double unoResistance(int adc) {
+    return adc == 0 ? NOMINAL_RESISTANCE : REFERENCE_RESISTANCE * ((double)UNO_ADC_RESOLUTION / adc - 1.0);
+}
+
+double betaCentiCelsius(double resistance, double beta) {
+    double kelvin = 1.0 / (1.0 / (NOMINAL_TEMPERATURE + 273.15) + log(resistance / NOMINAL_RESISTANCE) / beta);
+    return (kelvin - 273.15) * 100.0;
+}
+
+// Checks table[adc] against reference(adc) for every code but the clamped
+// ones, and prints the largest difference
+template<class Reference, class Clamped>
+void checkTable(const char* name, const int16_t* table, int codes, Reference reference, Clamped clamped) {
+    double worst = 0;
+    int worstAdc = 0;
+    for (int adc = 0; adc < codes; adc++) {
+        if (clamped(adc)) {
+            CHECK_EQUAL(table[adc], 32767);
+            continue;
+        }
+        double expected = reference(adc);
+        CHECK(expected > -32768.0 && expected < 32767.0);
+        double error = fabs(table[adc] - expected);
+        if (error > TOLERANCE_CENTI) {
+            fprintf(stderr, "%s[%d] = %d, Beta gives %.3f\n", name, adc, table[adc], expected);
+            testFailures++;
+        }
+        if (error > worst) {
+            worst = error;
+            worstAdc = adc;
+        }
+    }
+    printf("[NTC] %s: %d codes, worst difference %.3f C at adc %d\n", name, codes, worst / 100.0, worstAdc);
+}
+
+int main() {
+    checkTable("ESP32 NtcTable", Esp32NtcTable::centiC, ESP32_ADC_RESOLUTION,
+               [](int adc) { return betaCentiCelsius(esp32Resistance(adc), BETA_COEFFICIENT); },
+               [](int adc) { return adc <= 10; });
+    checkTable("Uno NtcTable", UnoNtcTable::centiC, UNO_ADC_RESOLUTION,
+               [](int adc) { return betaCentiCelsius(unoResistance(adc), -BETA_COEFFICIENT); },
+               [](int adc) { return adc == 1; });
+
+    // Spot values: 25 C where the divider is balanced (Uno code 0 reads as R0)
+    CHECK_EQUAL(Esp32NtcTable::centiC[ESP32_ADC_RESOLUTION / 2], 2500);
+    CHECK_EQUAL(UnoNtcTable::centiC[UNO_ADC_RESOLUTION / 2], 2500);
+    CHECK_EQUAL(UnoNtcTable::centiC[0], 2500);
+
+    return testResult("test_ntc_table");
+}
@@ -0,0 +1,209 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Rules Engine Tests
+// ----------------------------------------------------
+// Compiles rule sets for the ESP32's device table and checks what
+// RuleSet::evaluate() fires, in particular when more rules become true in
+// one pass than the caller's firing buffer holds (the firmware passes
+// RULE_FIRINGS_PER_PASS for up to MAX_RULES entries).
+
+#include "../../rules_engine.h"
+#include "test_devices.h"
+#include "test_check.h"
+
+#include <string>
+#include <vector>
+
+const uint16_t MAX_RULES = 128;
+const uint16_t MAX_RULE_CONDITIONS = 256;
+const uint8_t RULE_FIRINGS_PER_PASS = 16;
+
+typedef RuleSet<MAX_RULES, MAX_RULE_CONDITIONS> DeviceRules;
+
+DeviceRules rules;
+int16_t facts[RULE_OPERAND_COUNT];
+
+void compile(const std::string& source) {
+    RuleError error;
+    bool ok = compileRules(source.c_str(), DEVICES, rules, error);
+    if (!ok) {
+        fprintf(stderr, "line %u: %s\n", error.line, error.message);
+    }
+    CHECK(ok);
+}
+
+// count rules on the door, one per line; every other one also needs TEMP > 30
+std::string doorRules(int count, bool someOnTemperature) {
+    std::string source;
+    for (int i = 0; i < count; i++) {
+        source += (someOnTemperature && i % 2) ? "WHEN DOOR == OPEN AND TEMP > 30 THEN LAMP_TOGGLE\n"
+                                               : "WHEN DOOR == OPEN THEN PLUG_TOGGLE\n";
+    }
+    return source;
+}
+
+void resetFacts() {
+    for (uint8_t i = 0; i < RULE_OPERAND_COUNT; i++) {
+        facts[i] = 0;
+    }
+    facts[DEVICE_TEMP] = 2500;
+    facts[RULE_OPERAND_TIME] = RULE_FACT_UNKNOWN;
+}
+
+// Evaluates like the control task: capacity at a time until a call comes
+// back short. Returns the lines fired, in order.
+std::vector<uint16_t> evaluateAll(uint64_t changed, uint16_t capacity, int* calls) {
+    std::vector<uint16_t> lines;
+    RuleFiring fired[MAX_RULES];
+    uint16_t count;
+    *calls = 0;
+    do {
+        count = rules.evaluate(facts, changed, fired, capacity);
+        CHECK(count <= capacity);
+        for (uint16_t i = 0; i < count; i++) {
+            lines.push_back(fired[i].line);
+        }
+        (*calls)++;
+    } while (count == capacity && *calls <= MAX_RULES);
+    return lines;
+}
+
+void checkLines(const std::vector<uint16_t>& lines, int first, int step, int count, int sourceLine) {
+    if ((int)lines.size() != count) {
+        fprintf(stderr, "line %d: %zu firing(s), expected %d\n", sourceLine, lines.size(), count);
+        testFailures++;
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (lines[i] != first + i * step) {
+            fprintf(stderr, "line %d: firing %d is rule line %u, expected %d\n", sourceLine, i, lines[i], first + i * step);
+            testFailures++;
+        }
+    }
+}
+
+void testOverflowFiresEveryRule() {
+    // A full table on one operand: MAX_RULES rules become true at once
+    compile(doorRules(MAX_RULES, false));
+    CHECK_EQUAL(rules.ruleCount, MAX_RULES);
+    resetFacts();
+    int calls = 0;
+    checkLines(evaluateAll(0, RULE_FIRINGS_PER_PASS, &calls), 0, 0, 0, __LINE__);   // Primes only
+
+    facts[DEVICE_DOOR] = 1;
+    std::vector<uint16_t> lines = evaluateAll((uint64_t)1 << DEVICE_DOOR, RULE_FIRINGS_PER_PASS, &calls);
+    checkLines(lines, 1, 1, MAX_RULES, __LINE__);
+    CHECK_EQUAL(calls, MAX_RULES / RULE_FIRINGS_PER_PASS + 1);
+
+    // Nothing is left pending, and nothing fires twice
+    RuleFiring fired[RULE_FIRINGS_PER_PASS];
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), 0);
+
+    // The next edge fires them all again
+    facts[DEVICE_DOOR] = 0;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_DOOR, RULE_FIRINGS_PER_PASS, &calls), 0, 0, 0, __LINE__);
+    facts[DEVICE_DOOR] = 1;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_DOOR, RULE_FIRINGS_PER_PASS, &calls), 1, 1, MAX_RULES, __LINE__);
+}
+
+void testOverflowKeepsPendingAcrossOtherChanges() {
+    compile(doorRules(40, false));
+    resetFacts();
+    RuleFiring fired[RULE_FIRINGS_PER_PASS];
+    rules.evaluate(facts, 0, fired, RULE_FIRINGS_PER_PASS);
+
+    facts[DEVICE_DOOR] = 1;
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), RULE_FIRINGS_PER_PASS);
+    CHECK_EQUAL(fired[0].line, 1);
+
+    // A change no rule reads does not fire or drop the pending rules
+    facts[DEVICE_PLUG] = 1;
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_PLUG, fired, RULE_FIRINGS_PER_PASS), 0);
+
+    // They are still pending on the door
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), RULE_FIRINGS_PER_PASS);
+    CHECK_EQUAL(fired[0].line, 17);
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), 8);
+    CHECK_EQUAL(fired[0].line, 33);
+    CHECK_EQUAL(fired[7].line, 40);
+
+    // A pending rule whose conditions stop holding before it fires is
+    // dropped, like any rule that was true only between evaluations
+    facts[DEVICE_DOOR] = 0;
+    rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS);
+    facts[DEVICE_DOOR] = 1;
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), RULE_FIRINGS_PER_PASS);
+    facts[DEVICE_DOOR] = 0;
+    CHECK_EQUAL(rules.evaluate(facts, (uint64_t)1 << DEVICE_DOOR, fired, RULE_FIRINGS_PER_PASS), 0);
+    facts[DEVICE_DOOR] = 1;
+    int calls = 0;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_DOOR, RULE_FIRINGS_PER_PASS, &calls), 1, 1, 40, __LINE__);
+}
+
+void testOnlyNewlyTrueRulesFire() {
+    // Odd lines also need TEMP > 30: a door edge at 25 C fires the even ones
+    compile(doorRules(64, true));
+    resetFacts();
+    int calls = 0;
+    evaluateAll(0, RULE_FIRINGS_PER_PASS, &calls);
+
+    facts[DEVICE_DOOR] = 1;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_DOOR, RULE_FIRINGS_PER_PASS, &calls), 1, 2, 32, __LINE__);
+
+    // Then warming up fires the odd ones, and only those
+    facts[DEVICE_TEMP] = 3100;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_TEMP, RULE_FIRINGS_PER_PASS, &calls), 2, 2, 32, __LINE__);
+}
+
+void testCapacityOfOne() {
+    compile(doorRules(5, false));
+    resetFacts();
+    int calls = 0;
+    evaluateAll(0, 1, &calls);
+    facts[DEVICE_DOOR] = 1;
+    checkLines(evaluateAll((uint64_t)1 << DEVICE_DOOR, 1, &calls), 1, 1, 5, __LINE__);
+    CHECK_EQUAL(calls, 6);
+}
+
+void testFiringContents() {
+    compile("WHEN TEMP > 30 THEN PLUG_OFF, ALARM_ON\n# comment\nWHEN DOOR == CLOSED THEN LAMP_ON");
+    resetFacts();
+    facts[DEVICE_DOOR] = 1;
+    RuleFiring fired[RULE_FIRINGS_PER_PASS];
+    CHECK_EQUAL(rules.evaluate(facts, 0, fired, RULE_FIRINGS_PER_PASS), 0);   // Primes
+
+    facts[DEVICE_TEMP] = 3001;
+    facts[DEVICE_DOOR] = 0;
+    uint64_t changed = ((uint64_t)1 << DEVICE_TEMP) | ((uint64_t)1 << DEVICE_DOOR);
+    CHECK_EQUAL(rules.evaluate(facts, changed, fired, RULE_FIRINGS_PER_PASS), 3);
+    CHECK_EQUAL(fired[0].device, DEVICE_PLUG);
+    CHECK_EQUAL(fired[0].action, DEVICE_OFF);
+    CHECK_EQUAL(fired[0].line, 1);
+    CHECK_EQUAL(fired[1].device, DEVICE_ALARM);
+    CHECK_EQUAL(fired[1].action, DEVICE_ON);
+    CHECK_EQUAL(fired[2].device, DEVICE_LAMP);
+    CHECK_EQUAL(fired[2].action, DEVICE_ON);
+    CHECK_EQUAL(fired[2].line, 3);
+
+    // With room for one, the rest come from the following calls
+    facts[DEVICE_TEMP] = 2500;
+    facts[DEVICE_DOOR] = 1;
+    rules.evaluate(facts, changed, fired, RULE_FIRINGS_PER_PASS);
+    facts[DEVICE_TEMP] = 3001;
+    facts[DEVICE_DOOR] = 0;
+    CHECK_EQUAL(rules.evaluate(facts, changed, fired, 1), 1);
+    CHECK_EQUAL(fired[0].device, DEVICE_PLUG);
+    CHECK_EQUAL(rules.evaluate(facts, changed, fired, 1), 1);
+    CHECK_EQUAL(fired[0].device, DEVICE_ALARM);
+    CHECK_EQUAL(rules.evaluate(facts, changed, fired, 1), 1);
+    CHECK_EQUAL(fired[0].device, DEVICE_LAMP);
+    CHECK_EQUAL(rules.evaluate(facts, changed, fired, 1), 0);
+}
+
+int main() {
+    testOverflowFiresEveryRule();
+    testOverflowKeepsPendingAcrossOtherChanges();
+    testOnlyNewlyTrueRulesFire();
+    testCapacityOfOne();
+    testFiringContents();
+    return testResult("test_rules_engine");
+}
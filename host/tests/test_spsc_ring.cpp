@@ -0,0 +1,111 @@
+// ----------------------------------------------------
+// Smart Home Prototype - SPSC Ring Tests
+// ----------------------------------------------------
+// Checks spsc_ring.h on one thread (full ring, drop count, index wrap), then
+// with a producer and a consumer thread, the way the control task hands
+// JournalEvents to the web server task: every item arrives once, in order,
+// and whole.
+
+#include "../../spsc_ring.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <thread>
+
+// Shaped like JournalEvent; the fields are derived from sequence so a torn
+// copy shows
+struct Item {
+    uint32_t sequence;
+    uint8_t type;
+    uint8_t detail;
+    int32_t value;
+    uint32_t atMs;
+};
+
+Item makeItem(uint32_t sequence) {
+    Item item = { sequence, (uint8_t)sequence, (uint8_t)(sequence >> 8), -(int32_t)sequence, ~sequence };
+    return item;
+}
+
+bool itemIsWhole(const Item& item) {
+    Item expected = makeItem(item.sequence);
+    return item.type == expected.type && item.detail == expected.detail
+        && item.value == expected.value && item.atMs == expected.atMs;
+}
+
+void testSingleThread() {
+    SpscRing<Item, 8> ring = {};
+    Item item = makeItem(0);
+    CHECK(ring.empty());
+    CHECK(!ring.pop(item));
+
+    // The indices wrap at 256 many times over
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 8; i++) {
+            CHECK(ring.push(makeItem(next++)));
+        }
+        CHECK(!ring.push(makeItem(999)));   // Full: refused and counted
+        CHECK(!ring.empty());
+        for (int i = 0; i < 8; i++) {
+            CHECK(ring.pop(item));
+            CHECK_EQUAL(item.sequence, expected++);
+            CHECK(itemIsWhole(item));
+        }
+        CHECK(ring.empty());
+    }
+    CHECK_EQUAL(ring.droppedCount(), 200);
+}
+
+void testTwoThreads() {
+    const uint32_t ITEMS = 500000;
+    static SpscRing<Item, 64> ring;
+    std::atomic<bool> producerDone(false);
+
+    // Retries when the ring is full, so every item crosses and the two
+    // threads keep meeting at a full or an empty ring
+    std::thread producer([&producerDone]() {
+        for (uint32_t sequence = 0; sequence < ITEMS; sequence++) {
+            while (!ring.push(makeItem(sequence))) {
+                std::this_thread::yield();
+            }
+        }
+        producerDone = true;
+    });
+
+    uint32_t received = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t torn = 0;
+    Item item = makeItem(0);
+    for (;;) {
+        bool done = producerDone.load();
+        if (!ring.pop(item)) {
+            if (done) {
+                break;   // Done was seen before this pop came back empty
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.sequence != received) {
+            outOfOrder++;
+        }
+        if (!itemIsWhole(item)) {
+            torn++;
+        }
+        received++;
+    }
+    producer.join();
+
+    CHECK_EQUAL(received, ITEMS);
+    CHECK_EQUAL(outOfOrder, 0);
+    CHECK_EQUAL(torn, 0);
+    CHECK(ring.empty());
+    printf("[SPSC] %u items through a 64-slot ring\n", received);
+}
+
+int main() {
+    testSingleThread();
+    testTwoThreads();
+    return testResult("test_spsc_ring");
+}
@@ -0,0 +1,156 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Binary Status Frame Tests
+// ----------------------------------------------------
+// Round-trips status_frame.h over extreme and negative temperatures and
+// thresholds, every flag byte and the sequence wrap, checks that short
+// buffers and other versions are refused, and pins the byte layout to a
+// golden frame. The same frame is quoted next to decodeStatusFrame() in
+// services/arduinoService.ts with the values it must decode to; change
+// both together.
+
+#include "../../status_frame.h"
+#include "test_check.h"
+
+#include <string.h>
+
+// 27.31 C, threshold 27.00 C, door open, plug on, alarm sounding,
+// sequence 0x8000002A
+const uint8_t GOLDEN_FRAME[STATUS_FRAME_SIZE] = { 0x01, 0xAB, 0x0A, 0x8C, 0x0A, 0x0D, 0x2A, 0x00, 0x00, 0x80 };
+
+// -12.34 C, threshold -40.00 C, lamp on, sequence 0x00010203
+const uint8_t GOLDEN_NEGATIVE_FRAME[STATUS_FRAME_SIZE] = { 0x01, 0x2E, 0xFB, 0x60, 0xF0, 0x02, 0x03, 0x02, 0x01, 0x00 };
+
+const int16_t CENTI_VALUES[] = { -32768, -32767, -27315, -4000, -1234, -1, 0, 1, 2700, 2731, 32766, 32767 };
+const uint32_t SEQUENCES[] = { 0, 1, 0xFF, 0x100, 0xFFFF, 0x10000, 0xFFFFFF, 0x1000000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF };
+
+StatusFrame makeFrame(int16_t temperature, int16_t threshold, uint8_t flags, uint32_t sequence) {
+    StatusFrame frame = { temperature, threshold, flags, sequence };
+    return frame;
+}
+
+void checkRoundTrip(const StatusFrame& frame) {
+    uint8_t buffer[STATUS_FRAME_SIZE];
+    CHECK_EQUAL(encodeStatusFrame(buffer, sizeof(buffer), frame), STATUS_FRAME_SIZE);
+
+    StatusFrame decoded = makeFrame(0x5555, 0x5555, 0x55, 0x55555555);
+    CHECK(decodeStatusFrame(buffer, sizeof(buffer), decoded));
+    CHECK_EQUAL(decoded.temperatureCenti, frame.temperatureCenti);
+    CHECK_EQUAL(decoded.thresholdCenti, frame.thresholdCenti);
+    CHECK_EQUAL(decoded.flags, frame.flags);
+    CHECK_EQUAL(decoded.sequence, frame.sequence);
+    CHECK(sameStatus(decoded, frame));
+}
+
+void testRoundTrips() {
+    for (size_t t = 0; t < sizeof(CENTI_VALUES) / sizeof(CENTI_VALUES[0]); t++) {
+        for (size_t h = 0; h < sizeof(CENTI_VALUES) / sizeof(CENTI_VALUES[0]); h++) {
+            checkRoundTrip(makeFrame(CENTI_VALUES[t], CENTI_VALUES[h], STATUS_FLAG_DOOR_OPEN, 7));
+        }
+    }
+
+    // Every flag byte, not only the four the app reads
+    for (int flags = 0; flags <= 0xFF; flags++) {
+        checkRoundTrip(makeFrame(2731, 2700, (uint8_t)flags, 42));
+    }
+
+    for (size_t s = 0; s < sizeof(SEQUENCES) / sizeof(SEQUENCES[0]); s++) {
+        checkRoundTrip(makeFrame(-1, 32767, 0, SEQUENCES[s]));
+    }
+}
+
+// The sequence is a plain uint32 on the wire: it wraps to 0, and a frame
+// after the wrap still differs from the one before it
+void testSequenceWrap() {
+    StatusFrame before = makeFrame(2500, 2700, STATUS_FLAG_LAMP_ON, 0xFFFFFFFF);
+    StatusFrame after = before;
+    after.sequence++;
+    CHECK_EQUAL(after.sequence, 0);
+
+    uint8_t bytesBefore[STATUS_FRAME_SIZE];
+    uint8_t bytesAfter[STATUS_FRAME_SIZE];
+    encodeStatusFrame(bytesBefore, sizeof(bytesBefore), before);
+    encodeStatusFrame(bytesAfter, sizeof(bytesAfter), after);
+    CHECK(memcmp(bytesBefore, bytesAfter, STATUS_FRAME_SIZE) != 0);
+    CHECK_EQUAL(bytesAfter[6] | bytesAfter[7] | bytesAfter[8] | bytesAfter[9], 0);
+
+    StatusFrame decoded = makeFrame(0, 0, 0, 0);
+    CHECK(decodeStatusFrame(bytesAfter, sizeof(bytesAfter), decoded));
+    CHECK_EQUAL(decoded.sequence, 0);
+    CHECK(sameStatus(decoded, before));
+}
+
+void testRejects() {
+    uint8_t buffer[STATUS_FRAME_SIZE + 1];
+    StatusFrame frame = makeFrame(2731, 2700, 0x0D, 0x8000002A);
+
+    // Too small to encode into: nothing written
+    for (size_t capacity = 0; capacity < STATUS_FRAME_SIZE; capacity++) {
+        memset(buffer, 0xEE, sizeof(buffer));
+        CHECK_EQUAL(encodeStatusFrame(buffer, capacity, frame), 0);
+        for (size_t i = 0; i < sizeof(buffer); i++) {
+            CHECK_EQUAL(buffer[i], 0xEE);
+        }
+    }
+
+    // Short frames
+    StatusFrame decoded = makeFrame(0, 0, 0, 0);
+    for (size_t length = 0; length < STATUS_FRAME_SIZE; length++) {
+        CHECK(!decodeStatusFrame(GOLDEN_FRAME, length, decoded));
+    }
+
+    // Other versions
+    const uint8_t versions[] = { 0x00, STATUS_FRAME_VERSION + 1, 0x7F, 0xFF };
+    for (size_t v = 0; v < sizeof(versions); v++) {
+        memcpy(buffer, GOLDEN_FRAME, STATUS_FRAME_SIZE);
+        buffer[0] = versions[v];
+        CHECK(!decodeStatusFrame(buffer, STATUS_FRAME_SIZE, decoded));
+    }
+
+    // Trailing bytes past the frame are ignored
+    memcpy(buffer, GOLDEN_FRAME, STATUS_FRAME_SIZE);
+    buffer[STATUS_FRAME_SIZE] = 0x99;
+    CHECK(decodeStatusFrame(buffer, sizeof(buffer), decoded));
+    CHECK_EQUAL(decoded.sequence, 0x8000002A);
+}
+
+void checkGolden(const uint8_t* golden, const StatusFrame& frame) {
+    uint8_t buffer[STATUS_FRAME_SIZE];
+    CHECK_EQUAL(encodeStatusFrame(buffer, sizeof(buffer), frame), STATUS_FRAME_SIZE);
+    for (size_t i = 0; i < STATUS_FRAME_SIZE; i++) {
+        CHECK_EQUAL(buffer[i], golden[i]);
+    }
+
+    StatusFrame decoded = makeFrame(0, 0, 0, 0);
+    CHECK(decodeStatusFrame(golden, STATUS_FRAME_SIZE, decoded));
+    CHECK(sameStatus(decoded, frame));
+    CHECK_EQUAL(decoded.sequence, frame.sequence);
+}
+
+void testGoldenFrames() {
+    CHECK_EQUAL(STATUS_FRAME_VERSION, 1);
+    CHECK_EQUAL(STATUS_FRAME_SIZE, 10);
+    CHECK_EQUAL(STATUS_FLAG_DOOR_OPEN, 0x01);
+    CHECK_EQUAL(STATUS_FLAG_LAMP_ON, 0x02);
+    CHECK_EQUAL(STATUS_FLAG_PLUG_ON, 0x04);
+    CHECK_EQUAL(STATUS_FLAG_ALARM, 0x08);
+
+    checkGolden(GOLDEN_FRAME, makeFrame(2731, 2700, STATUS_FLAG_DOOR_OPEN | STATUS_FLAG_PLUG_ON | STATUS_FLAG_ALARM, 0x8000002A));
+    checkGolden(GOLDEN_NEGATIVE_FRAME, makeFrame(-1234, -4000, STATUS_FLAG_LAMP_ON, 0x00010203));
+}
+
+void testSaturation() {
+    CHECK_EQUAL(toStatusCenti(40000), 32767);
+    CHECK_EQUAL(toStatusCenti(32767), 32767);
+    CHECK_EQUAL(toStatusCenti(-32768), -32768);
+    CHECK_EQUAL(toStatusCenti(-40000), -32768);
+    CHECK_EQUAL(toStatusCenti(-1234), -1234);
+}
+
+int main() {
+    testRoundTrips();
+    testSequenceWrap();
+    testRejects();
+    testGoldenFrames();
+    testSaturation();
+    return testResult("test_status_frame");
+}
@@ -0,0 +1,132 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Incremental HTTP Request Parser
+// ----------------------------------------------------
+// Used by arduino_main_code.cpp. When building with the Arduino IDE, keep
+// this file in the sketch folder.
+//
+// The ESP8266 hands over request bytes in +IPD frames of any size, from up
+// to CONNECTIONS links, interleaved. feed() takes those bytes one at a time.
+// Only the request line is kept, in a LINE_SIZE buffer shared by all links;
+// headers are skipped by watching for the blank line that ends them, so
+// pipelined requests and requests split across several frames parse the
+// same as a single frame.
+//
+// Each request line ends in a call to onRequest(connectionId, action), with
+// action the GET path without its leading '/', or "" for anything else
+// (another method, no path, or a path cut short by the buffer). Any HTTP
+// version, or none, is accepted. A line cut off by another link's frame is
+// answered at once with "" rather than leave its client waiting.
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+
+template<uint8_t CONNECTIONS, uint8_t LINE_SIZE> class HttpRequestParser {
+public:
+    HttpRequestParser() : lineLength(0), lineOwner(-1), lineTruncated(false) {
+        for (uint8_t i = 0; i < CONNECTIONS; i++) {
+            phase[i] = LINE;
+            headerLineHasText[i] = false;
+        }
+    }
+
+    // Advances the parser of one connection by one payload byte
+    template<class OnRequest> void feed(int connectionId, char c, OnRequest onRequest) {
+        if (connectionId < 0 || connectionId >= CONNECTIONS || c == '\r') {
+            return;
+        }
+
+        if (phase[connectionId] == HEADERS) {
+            // A line with no text is the blank line that ends the headers
+            if (c == '\n') {
+                if (!headerLineHasText[connectionId]) {
+                    phase[connectionId] = LINE;
+                }
+                headerLineHasText[connectionId] = false;
+            }
+            else {
+                headerLineHasText[connectionId] = true;
+            }
+            return;
+        }
+
+        // Another connection's request line was cut off by this frame
+        if (lineOwner != connectionId) {
+            if (lineOwner >= 0) {
+                lineTruncated = true;
+                finishLine(onRequest);
+            }
+            lineOwner = connectionId;
+        }
+
+        if (c == '\n') {
+            if (lineLength > 0) {
+                finishLine(onRequest);
+            }
+            return;  // Blank lines before a request line are ignored
+        }
+
+        if (lineLength < LINE_SIZE - 1) {
+            line[lineLength++] = c;
+        }
+        else {
+            lineTruncated = true;
+        }
+    }
+
+    // Forgets a half-parsed request when its connection goes away
+    void close(int connectionId) {
+        if (connectionId < 0 || connectionId >= CONNECTIONS) {
+            return;
+        }
+        phase[connectionId] = LINE;
+        headerLineHasText[connectionId] = false;
+        if (lineOwner == connectionId) {
+            clearLine();
+        }
+    }
+
+private:
+    enum Phase : uint8_t { LINE, HEADERS };
+
+    // Splits "METHOD /path[ HTTP/1.x]" in place and hands over the path. A
+    // line cut short by the buffer still counts if the whole path made it in.
+    template<class OnRequest> void finishLine(OnRequest onRequest) {
+        int connectionId = lineOwner;
+        line[lineLength] = '\0';
+
+        const char* action = "";
+        char* pathStart = strchr(line, ' ');
+        if (pathStart != NULL && pathStart[1] == '/') {
+            *pathStart = '\0';
+            char* pathEnd = strchr(pathStart + 1, ' ');
+            if (pathEnd != NULL) {
+                *pathEnd = '\0';
+            }
+            if (strcmp_P(line, PSTR("GET")) == 0 && (pathEnd != NULL || !lineTruncated)) {
+                action = pathStart + 2;
+            }
+        }
+
+        onRequest(connectionId, action);
+
+        phase[connectionId] = HEADERS;
+        headerLineHasText[connectionId] = false;
+        clearLine();
+    }
+
+    void clearLine() {
+        lineLength = 0;
+        lineOwner = -1;
+        lineTruncated = false;
+    }
+
+    char line[LINE_SIZE];
+    uint8_t lineLength;
+    int lineOwner;              // Connection whose request line is in the buffer
+    bool lineTruncated;
+    Phase phase[CONNECTIONS];
+    bool headerLineHasText[CONNECTIONS];
+};
@@ -0,0 +1,26 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Compile-time Index Lists
+// ----------------------------------------------------
+// Included by both firmwares' shared headers. When building with the
+// Arduino IDE, keep this file in the sketch folder.
+//
+// IndexList<0, 1, ..., N-1> expands a constexpr generator into a static
+// table, one element per index: the command slots in command_table.h and
+// the NTC lookup table in ntc_table.h are built this way.
+
+#pragma once
+
+template<int... Is> struct IndexList {};
+
+template<class A, class B> struct ConcatIndexList;
+template<int... A, int... B> struct ConcatIndexList<IndexList<A...>, IndexList<B...> > {
+    typedef IndexList<A..., (int)sizeof...(A) + B...> type;
+};
+
+// Builds IndexList<0, 1, ..., N-1> with only log2(N) levels of recursion
+template<int N> struct MakeIndexList {
+    typedef typename ConcatIndexList<typename MakeIndexList<N / 2>::type,
+                                     typename MakeIndexList<N - N / 2>::type>::type type;
+};
+template<> struct MakeIndexList<0> { typedef IndexList<> type; };
+template<> struct MakeIndexList<1> { typedef IndexList<0> type; };
@@ -0,0 +1,186 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Journal Storage Backends
+// ----------------------------------------------------
+// Used by event_journal.h. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// The journal only sees a JournalStorage: a row of equal sectors that
+// behave like NOR flash. Erasing a sector sets every byte to 0xFF, and
+// writing can only clear bits. Two backends are provided:
+//   EspPartitionJournalStorage - a raw data partition on the ESP32
+//   FileJournalStorage         - a flash image in a file, for Linux host builds
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class JournalStorage {
+public:
+    virtual ~JournalStorage() {}
+
+    virtual uint32_t sectorSize() const = 0;
+    virtual uint32_t sectorCount() const = 0;
+
+    virtual bool read(uint32_t offset, void* data, size_t length) = 0;
+    // Like NOR flash: the stored bytes become (old & data)
+    virtual bool write(uint32_t offset, const void* data, size_t length) = 0;
+    // Sets the whole sector to 0xFF
+    virtual bool eraseSector(uint32_t sector) = 0;
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_partition.h>
+
+// A data partition from the partition table, looked up by label. Give the
+// journal its own "journal" partition in a custom partitions.csv; the
+// default table's "spiffs" partition also works if nothing else uses it.
+class EspPartitionJournalStorage : public JournalStorage {
+public:
+    EspPartitionJournalStorage() : partition(NULL) {}
+
+    bool begin(const char* label) {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+        return partition != NULL;
+    }
+
+    const char* label() const {
+        return partition ? partition->label : "";
+    }
+
+    uint32_t sectorSize() const {
+        return SPI_FLASH_SEC_SIZE;
+    }
+
+    uint32_t sectorCount() const {
+        return partition ? partition->size / SPI_FLASH_SEC_SIZE : 0;
+    }
+
+    bool read(uint32_t offset, void* data, size_t length) {
+        return esp_partition_read(partition, offset, data, length) == ESP_OK;
+    }
+
+    bool write(uint32_t offset, const void* data, size_t length) {
+        return esp_partition_write(partition, offset, data, length) == ESP_OK;
+    }
+
+    bool eraseSector(uint32_t sector) {
+        return esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+    }
+
+private:
+    const esp_partition_t* partition;
+};
+#endif
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#include <string.h>
+
+// Flash image in a regular file. Writes AND into the existing bytes the
+// way NOR flash does, so a journal that works here also works on the
+// chip. To simulate power loss, truncate or corrupt the file between opens.
+class FileJournalStorage : public JournalStorage {
+public:
+    FileJournalStorage(const char* path, uint32_t sectorSize, uint32_t sectorCount)
+        : path(path), sectorBytes(sectorSize), sectors(sectorCount), file(NULL) {}
+
+    ~FileJournalStorage() {
+        close();
+    }
+
+    // Opens the image, creating it erased (all 0xFF) if it is missing or
+    // shorter than sectorSize * sectorCount
+    bool open() {
+        close();
+        file = fopen(path, "r+b");
+        if (file == NULL) {
+            file = fopen(path, "w+b");
+        }
+        if (file == NULL || fseek(file, 0, SEEK_END) != 0) {
+            return false;
+        }
+
+        long size = ftell(file);
+        uint8_t blank[256];
+        memset(blank, 0xFF, sizeof(blank));
+        for (long at = size < 0 ? 0 : size; at < (long)(sectorBytes * sectors); at += sizeof(blank)) {
+            size_t length = (size_t)((long)(sectorBytes * sectors) - at);
+            if (length > sizeof(blank)) {
+                length = sizeof(blank);
+            }
+            if (fwrite(blank, 1, length, file) != length) {
+                return false;
+            }
+        }
+        return fflush(file) == 0;
+    }
+
+    void close() {
+        if (file) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    uint32_t sectorSize() const {
+        return sectorBytes;
+    }
+
+    uint32_t sectorCount() const {
+        return sectors;
+    }
+
+    bool read(uint32_t offset, void* data, size_t length) {
+        return inRange(offset, length)
+            && fseek(file, offset, SEEK_SET) == 0
+            && fread(data, 1, length, file) == length;
+    }
+
+    bool write(uint32_t offset, const void* data, size_t length) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        uint8_t merged[256];
+        while (length > 0) {
+            size_t part = length < sizeof(merged) ? length : sizeof(merged);
+            if (!read(offset, merged, part)) {
+                return false;
+            }
+            for (size_t i = 0; i < part; i++) {
+                merged[i] &= bytes[i];
+            }
+            if (fseek(file, offset, SEEK_SET) != 0 || fwrite(merged, 1, part, file) != part) {
+                return false;
+            }
+            offset += part;
+            bytes += part;
+            length -= part;
+        }
+        return fflush(file) == 0;
+    }
+
+    bool eraseSector(uint32_t sector) {
+        if (sector >= sectors || fseek(file, sector * sectorBytes, SEEK_SET) != 0) {
+            return false;
+        }
+        uint8_t blank[256];
+        memset(blank, 0xFF, sizeof(blank));
+        for (uint32_t done = 0; done < sectorBytes; done += sizeof(blank)) {
+            size_t part = sectorBytes - done < sizeof(blank) ? sectorBytes - done : sizeof(blank);
+            if (fwrite(blank, 1, part, file) != part) {
+                return false;
+            }
+        }
+        return fflush(file) == 0;
+    }
+
+private:
+    bool inRange(uint32_t offset, size_t length) const {
+        return file != NULL && offset <= sectorBytes * sectors && length <= sectorBytes * sectors - offset;
+    }
+
+    const char* path;
+    uint32_t sectorBytes;
+    uint32_t sectors;
+    FILE* file;
+};
+#endif
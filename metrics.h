@@ -0,0 +1,83 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Latency Metrics
+// ----------------------------------------------------
+// Used by esp32_main_code.cpp. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// Fixed log2 histograms of durations in microseconds, allocated up front.
+// MetricsTable<false, N> has no storage and an empty record(), so a build
+// with metrics switched off carries neither the RAM nor the timing code.
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+const uint8_t METRIC_BUCKETS = 17;   // <= 1, 2, 4 ... 32768 us, then +Inf
+
+struct LatencyHistogram {
+    uint32_t buckets[METRIC_BUCKETS];   // Bucket i: 2^(i-1) < us <= 2^i (bucket 0: us <= 1)
+    uint64_t sumUs;
+
+    void record(uint32_t us) {
+        uint8_t bucket = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);
+        if (bucket >= METRIC_BUCKETS) {
+            bucket = METRIC_BUCKETS - 1;
+        }
+        buckets[bucket]++;
+        sumUs += us;
+    }
+
+    uint32_t count() const {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < METRIC_BUCKETS; i++) {
+            total += buckets[i];
+        }
+        return total;
+    }
+};
+
+// Upper bound of bucket i in microseconds (the last bucket has none)
+inline uint32_t metricBucketBoundUs(uint8_t bucket) {
+    return (uint32_t)1 << bucket;
+}
+
+// Each histogram sits behind its own seqlock, like DeviceSnapshot: the
+// sequence is odd while record() writes. A histogram must have only one
+// writing task; any task may take snapshots.
+template<bool Enabled, uint8_t N> struct MetricsTable {
+    LatencyHistogram histograms[N];
+    std::atomic<uint32_t> sequences[N];
+
+    void record(uint8_t metric, uint32_t us) {
+        uint32_t sequence = sequences[metric].load(std::memory_order_relaxed);
+        sequences[metric].store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        histograms[metric].record(us);
+        sequences[metric].store(sequence + 2, std::memory_order_release);
+    }
+
+    // A copy taken between two record() calls, so the buckets and the sum
+    // agree; retries while the writer is in record()
+    LatencyHistogram snapshot(uint8_t metric) const {
+        LatencyHistogram copy;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequences[metric].load(std::memory_order_acquire);
+            copy = histograms[metric];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequences[metric].load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+};
+
+template<uint8_t N> struct MetricsTable<false, N> {
+    void record(uint8_t, uint32_t) {}
+
+    LatencyHistogram snapshot(uint8_t) const {
+        LatencyHistogram empty = {};
+        return empty;
+    }
+};
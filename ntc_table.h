@@ -0,0 +1,74 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Compile-time NTC Lookup Table
+// ----------------------------------------------------
+// Included by both esp32_main_code.cpp and arduino_main_code.cpp. When
+// building with the Arduino IDE, keep this file in the sketch folder.
+//
+// The Beta equation is evaluated by the compiler for every possible ADC code,
+// so converting a reading is an indexed load instead of a divide + log().
+// Entries are centi-degrees C, clamped to the int16_t range. Each sketch
+// describes its divider and thermistor in a struct with a constexpr
+// centiCelsiusAt(adc) built from the functions below, and instantiates
+// NtcLookupTable with it:
+//
+//   typedef NtcLookupTable<NtcThermistor, MakeIndexList<ADC_RESOLUTION>::type> NtcTable;
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "index_list.h"
+
+// constexpr ln(x): scale x into [0.5, 2] by powers of two, then the atanh
+// series ln(x) = 2 * sum(y^(2k+1) / (2k+1)) with y = (x-1)/(x+1), |y| <= 1/3
+constexpr double NTC_LN2 = 0.69314718055994530942;
+
+constexpr double ntcLnSeries(double term, double y2, int k) {
+    return k > 24 ? 0.0 : term / (2 * k + 1) + ntcLnSeries(term * y2, y2, k + 1);
+}
+
+constexpr double ntcLn(double x) {
+    return x > 2.0 ? ntcLn(x / 2.0) + NTC_LN2
+         : x < 0.5 ? ntcLn(x * 2.0) - NTC_LN2
+         : 2.0 * ntcLnSeries((x - 1.0) / (x + 1.0), ((x - 1.0) / (x + 1.0)) * ((x - 1.0) / (x + 1.0)), 0);
+}
+
+constexpr int16_t ntcRoundCenti(double centi) {
+    return centi >= 32767.0 ? 32767
+         : centi <= -32768.0 ? -32768
+         : (int16_t)(centi < 0 ? centi - 0.5 : centi + 0.5);
+}
+
+// supply --- [reference] --- ADC pin --- [NTC] --- GND
+// R_ntc = R_ref × ADC / (ADC_max - ADC). Codes within 10 of either end read
+// as a short (100 ohm, extremely hot) or an open circuit (100 × R0).
+constexpr double ntcResistanceToGround(int adc, int adcResolution, double referenceResistance, double nominalResistance) {
+    return adc <= 10 ? 100.0
+         : adc >= adcResolution - 10 ? nominalResistance * 100.0
+         : referenceResistance * ((double)adc / (adcResolution - adc));
+}
+
+// supply --- [NTC] --- ADC pin --- [reference] --- GND
+// R_ntc = R_ref × (ADC_max / ADC - 1). Code 0 reads as R0.
+constexpr double ntcResistanceToSupply(int adc, int adcResolution, double referenceResistance, double nominalResistance) {
+    return adc == 0 ? nominalResistance
+         : referenceResistance * ((double)adcResolution / adc - 1.0);
+}
+
+// Simplified Beta model: 1/T = 1/T0 + (1/B) * ln(R/R0), T0 in degrees C
+constexpr int16_t ntcBetaCentiCelsius(double resistance, double nominalResistance, double nominalTemperature, double beta) {
+    return ntcRoundCenti((1.0 / (1.0 / (nominalTemperature + 273.15)
+                                 + ntcLn(resistance / nominalResistance) / beta) - 273.15) * 100.0);
+}
+
+template<class Thermistor, class L> struct NtcLookupTable;
+template<class Thermistor, int... Is> struct NtcLookupTable<Thermistor, IndexList<Is...> > {
+    static const int16_t centiC[sizeof...(Is)] PROGMEM;
+};
+// In flash on both boards: the Uno reads it with pgm_read_word(), the
+// ESP32 toolchain maps const data (DROM) so it reads it directly
+template<class Thermistor, int... Is>
+const int16_t NtcLookupTable<Thermistor, IndexList<Is...> >::centiC[sizeof...(Is)] PROGMEM = {
+    Thermistor::centiCelsiusAt(Is)...
+};
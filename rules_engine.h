@@ -0,0 +1,405 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Local Automation Rules
+// ----------------------------------------------------
+// Used by esp32_main_code.cpp. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// Rules are uploaded as text, one per line or separated by ';' ('#' starts
+// a comment; error line numbers count ';' as a line break):
+//   WHEN TEMP > 30 THEN PLUG_OFF
+//   WHEN DOOR == OPEN AND TIME >= 23:00 THEN ALARM_ON, LAMP_ON
+// Operands are the devices of the sketch's table (binary devices compare
+// with their status texts, the analog one in degrees C) and TIME, local
+// time of day. Actions are the device commands, "<DEVICE>_ON/_OFF/_TOGGLE".
+//
+// compileRules() turns the text into a flat table: each condition is an
+// operand index, a comparison and a 16-bit constant, and each action is an
+// entry pointing at its rule's conditions. A rule fires once each time its
+// conditions become true. evaluate() only re-checks entries that read an
+// operand that changed, so one pass is bounded by the table sizes.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "device_registry.h"
+
+const uint8_t RULE_OPERAND_TIME = MAX_DEVICES;        // Minutes since local midnight
+const uint8_t RULE_OPERAND_COUNT = MAX_DEVICES + 1;
+const int16_t RULE_FACT_UNKNOWN = -32768;             // E.g. TIME before the clock is set: no comparison holds
+const uint8_t RULE_TOKEN_SIZE = 24;
+const uint8_t RULE_CONDITIONS_PER_RULE = 6;           // Keeps a decompiled rule to one short line
+const uint8_t RULE_ACTIONS_PER_RULE = 6;
+const uint32_t RULES_FORMAT_VERSION = 1;
+
+enum RuleOperator : uint8_t {
+    RULE_LT,
+    RULE_LE,
+    RULE_GT,
+    RULE_GE,
+    RULE_EQ,
+    RULE_NE,
+    RULE_OPERATOR_COUNT
+};
+
+const char* const RULE_OPERATOR_TEXT[RULE_OPERATOR_COUNT] = { "<", "<=", ">", ">=", "==", "!=" };
+
+struct RuleCondition {
+    uint8_t operand;    // Device index, or RULE_OPERAND_TIME
+    uint8_t op;         // RuleOperator
+    int16_t value;      // 0/1, centi-degrees C or minutes
+};
+
+// One action of a rule. A rule with several actions compiles to one entry
+// per action, all pointing at the same conditions.
+struct Rule {
+    uint64_t operands;        // Bit per operand the conditions read
+    uint16_t firstCondition;
+    uint8_t conditionCount;
+    uint8_t device;
+    uint8_t action;           // DeviceAction
+    uint16_t line;            // Source line, from 1
+};
+
+struct RuleFiring {
+    uint8_t device;
+    uint8_t action;           // DeviceAction
+    uint16_t line;
+};
+
+struct RuleError {
+    uint16_t line;
+    const char* message;
+};
+
+inline bool ruleCompare(int16_t fact, uint8_t op, int16_t value) {
+    switch (op) {
+        case RULE_LT: return fact < value;
+        case RULE_LE: return fact <= value;
+        case RULE_GT: return fact > value;
+        case RULE_GE: return fact >= value;
+        case RULE_EQ: return fact == value;
+        default:      return fact != value;
+    }
+}
+
+// Identifies the device table the indices in a stored rule set refer to
+inline uint32_t ruleDeviceSignature(const DeviceTable& devices) {
+    uint32_t hash = 2166136261UL ^ RULES_FORMAT_VERSION;
+    for (uint8_t i = 0; i < devices.count; i++) {
+        for (const char* c = devices.specs[i].name; *c; c++) {
+            hash = (hash ^ (uint8_t)*c) * 16777619UL;
+        }
+        hash = (hash ^ devices.specs[i].kind) * 16777619UL;
+    }
+    return hash;
+}
+
+// Fixed-size, so a set can be stored and loaded as one blob
+template<uint16_t MaxRules, uint16_t MaxConditions> struct RuleSet {
+    uint32_t signature;       // ruleDeviceSignature() it was compiled for
+    uint16_t ruleCount;
+    uint16_t conditionCount;
+    Rule rules[MaxRules];
+    RuleCondition conditions[MaxConditions];
+    uint8_t held[(MaxRules + 7) / 8];   // Conditions held at the last evaluation
+    bool primed;                         // evaluate() has run since reset()
+
+    void clear(uint32_t deviceSignature) {
+        signature = deviceSignature;
+        ruleCount = 0;
+        conditionCount = 0;
+        reset();
+    }
+
+    // Checks a set read back from storage before it is evaluated
+    bool isConsistent(uint8_t deviceCount) const {
+        if (ruleCount > MaxRules || conditionCount > MaxConditions) {
+            return false;
+        }
+        for (uint16_t r = 0; r < ruleCount; r++) {
+            const Rule& rule = rules[r];
+            if (rule.device >= deviceCount || rule.action >= DEVICE_ACTION_COUNT
+                || rule.firstCondition + rule.conditionCount > conditionCount) {
+                return false;
+            }
+        }
+        for (uint16_t c = 0; c < conditionCount; c++) {
+            const RuleCondition& condition = conditions[c];
+            if ((condition.operand >= deviceCount && condition.operand != RULE_OPERAND_TIME)
+                || condition.op >= RULE_OPERATOR_COUNT) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Forgets the evaluation state: the next evaluate() only primes it
+    void reset() {
+        memset(held, 0, sizeof(held));
+        primed = false;
+    }
+
+    bool conditionsHold(const Rule& rule, const int16_t* facts) const {
+        for (uint8_t i = 0; i < rule.conditionCount; i++) {
+            const RuleCondition& condition = conditions[rule.firstCondition + i];
+            int16_t fact = facts[condition.operand];
+            if (fact == RULE_FACT_UNKNOWN || !ruleCompare(fact, condition.op, condition.value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Re-checks the entries that read an operand in changed and returns up to
+    // capacity actions whose conditions have just become true. The first
+    // call after reset() checks every entry and fires nothing, so rules that
+    // already hold when they are loaded wait for their next change.
+    //
+    // Firings that do not fit are not marked as held: when the result fills
+    // capacity, call again with the same facts and changed for the rest.
+    uint16_t evaluate(const int16_t* facts, uint64_t changed, RuleFiring* fired, uint16_t capacity) {
+        uint16_t count = 0;
+        for (uint16_t r = 0; r < ruleCount; r++) {
+            const Rule& rule = rules[r];
+            if (primed && (rule.operands & changed) == 0) {
+                continue;
+            }
+
+            bool holds = conditionsHold(rule, facts);
+            uint8_t mask = 1 << (r & 7);
+            if (holds == ((held[r >> 3] & mask) != 0)) {
+                continue;
+            }
+            if (holds && primed) {
+                if (count == capacity) {
+                    continue;
+                }
+                RuleFiring firing = { rule.device, rule.action, rule.line };
+                fired[count++] = firing;
+            }
+            held[r >> 3] ^= mask;
+        }
+        primed = true;
+        return count;
+    }
+};
+
+// --- Compiler ---
+
+inline bool ruleIsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool ruleIsLineEnd(char c) {
+    return c == '\0' || c == '\n' || c == ';';
+}
+
+// Copies the next token of the line into token ("" at the end of the line
+// or at a comment). ',' is a token of its own. Returns false if the token
+// does not fit.
+inline bool ruleNextToken(const char*& text, char* token) {
+    while (ruleIsSpace(*text)) {
+        text++;
+    }
+    if (*text == ',') {
+        token[0] = *text++;
+        token[1] = '\0';
+        return true;
+    }
+
+    uint8_t length = 0;
+    while (!ruleIsLineEnd(*text) && !ruleIsSpace(*text) && *text != ',' && *text != '#') {
+        if (length + 1 >= RULE_TOKEN_SIZE) {
+            return false;
+        }
+        token[length++] = *text++;
+    }
+    token[length] = '\0';
+    return true;
+}
+
+inline bool ruleParseOperator(const char* token, uint8_t& op) {
+    for (uint8_t i = 0; i < RULE_OPERATOR_COUNT; i++) {
+        if (strcmp(token, RULE_OPERATOR_TEXT[i]) == 0) {
+            op = i;
+            return true;
+        }
+    }
+    if (strcmp(token, "=") == 0) {
+        op = RULE_EQ;
+        return true;
+    }
+    return false;
+}
+
+// "HH:MM" -> minutes since midnight
+inline bool ruleParseTime(const char* token, int16_t& minutes) {
+    char* end;
+    long hours = strtol(token, &end, 10);
+    if (end == token || *end != ':' || hours < 0 || hours > 23) {
+        return false;
+    }
+    const char* minuteText = end + 1;
+    long minute = strtol(minuteText, &end, 10);
+    if (end - minuteText != 2 || *end != '\0' || minute < 0 || minute > 59) {
+        return false;
+    }
+    minutes = (int16_t)(hours * 60 + minute);
+    return true;
+}
+
+// Parses "<operand> <op> <value>"; returns an error message or NULL
+inline const char* ruleParseCondition(const char*& text, const char* operandName, const DeviceTable& devices,
+                                      RuleCondition& condition) {
+    char token[RULE_TOKEN_SIZE];
+    const DeviceSpec* spec = NULL;
+    if (strcmp(operandName, "TIME") == 0) {
+        condition.operand = RULE_OPERAND_TIME;
+    } else {
+        for (uint8_t d = 0; d < devices.count && spec == NULL; d++) {
+            if (strcmp(operandName, devices.specs[d].name) == 0) {
+                spec = &devices.specs[d];
+                condition.operand = d;
+            }
+        }
+        if (spec == NULL) {
+            return "unknown operand";
+        }
+    }
+
+    if (!ruleNextToken(text, token) || !ruleParseOperator(token, condition.op)) {
+        return "expected <, <=, >, >=, == or !=";
+    }
+    if (!ruleNextToken(text, token) || token[0] == '\0') {
+        return "expected a value";
+    }
+
+    if (spec == NULL) {
+        return ruleParseTime(token, condition.value) ? NULL : "expected a time as HH:MM";
+    }
+    if (deviceIsBinary(*spec)) {
+        if (condition.op != RULE_EQ && condition.op != RULE_NE) {
+            return "only == and != apply to on/off devices";
+        }
+        if (strcmp(token, spec->onText) == 0 || strcmp(token, spec->offText) == 0) {
+            condition.value = strcmp(token, spec->onText) == 0;
+            return NULL;
+        }
+        return "value is not one of the device's states";
+    }
+
+    char* end;
+    double degrees = strtod(token, &end);
+    if (end == token || *end != '\0' || !(degrees > -300 && degrees < 300)) {
+        return "expected a temperature";
+    }
+    condition.value = (int16_t)(degrees * 100 + (degrees < 0 ? -0.5 : 0.5));
+    return NULL;
+}
+
+// Compiles one "WHEN ... THEN ..." line into set; returns an error or NULL
+template<uint16_t MaxRules, uint16_t MaxConditions>
+const char* ruleCompileLine(const char* text, uint16_t line, const DeviceTable& devices,
+                            RuleSet<MaxRules, MaxConditions>& set) {
+    char token[RULE_TOKEN_SIZE];
+    if (!ruleNextToken(text, token) || strcmp(token, "WHEN") != 0) {
+        return "expected WHEN";
+    }
+
+    uint16_t firstCondition = set.conditionCount;
+    uint64_t operands = 0;
+    while (true) {
+        if (!ruleNextToken(text, token) || token[0] == '\0') {
+            return "expected a condition";
+        }
+        if (set.conditionCount - firstCondition >= RULE_CONDITIONS_PER_RULE) {
+            return "too many conditions in one rule";
+        }
+        if (set.conditionCount >= MaxConditions) {
+            return "too many conditions";
+        }
+        RuleCondition& condition = set.conditions[set.conditionCount];
+        const char* error = ruleParseCondition(text, token, devices, condition);
+        if (error) {
+            return error;
+        }
+        operands |= (uint64_t)1 << condition.operand;
+        set.conditionCount++;
+
+        if (!ruleNextToken(text, token)) {
+            return "expected AND or THEN";
+        }
+        if (strcmp(token, "THEN") == 0) {
+            break;
+        }
+        if (strcmp(token, "AND") != 0) {
+            return "expected AND or THEN";
+        }
+    }
+
+    uint16_t firstRule = set.ruleCount;
+    while (true) {
+        uint8_t device;
+        DeviceAction action;
+        if (!ruleNextToken(text, token) || !findDeviceCommand(token, strlen(token), devices, device, action)) {
+            return "expected a device command";
+        }
+        if (set.ruleCount - firstRule >= RULE_ACTIONS_PER_RULE) {
+            return "too many actions in one rule";
+        }
+        if (set.ruleCount >= MaxRules) {
+            return "too many rules";
+        }
+        Rule& rule = set.rules[set.ruleCount++];
+        rule.operands = operands;
+        rule.firstCondition = firstCondition;
+        rule.conditionCount = (uint8_t)(set.conditionCount - firstCondition);
+        rule.device = device;
+        rule.action = action;
+        rule.line = line;
+
+        if (!ruleNextToken(text, token)) {
+            return "expected ','";
+        }
+        if (token[0] == '\0') {
+            return NULL;
+        }
+        if (strcmp(token, ",") != 0) {
+            return "expected ','";
+        }
+    }
+}
+
+// Replaces the contents of set with the rules in source. On failure error
+// names the line and set is left incomplete.
+template<uint16_t MaxRules, uint16_t MaxConditions>
+bool compileRules(const char* source, const DeviceTable& devices, RuleSet<MaxRules, MaxConditions>& set,
+                  RuleError& error) {
+    set.clear(ruleDeviceSignature(devices));
+
+    uint16_t line = 1;
+    const char* text = source;
+    while (true) {
+        while (ruleIsSpace(*text)) {
+            text++;
+        }
+        if (!ruleIsLineEnd(*text) && *text != '#') {
+            error.message = ruleCompileLine(text, line, devices, set);
+            if (error.message) {
+                error.line = line;
+                return false;
+            }
+        }
+
+        while (!ruleIsLineEnd(*text)) {
+            text++;
+        }
+        if (*text == '\0') {
+            return true;
+        }
+        text++;
+        line++;
+    }
+}
@@ -0,0 +1,253 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Buffered Serial Log
+// ----------------------------------------------------
+// Included by both firmwares. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// LOG_ERROR/WARN/INFO/DEBUG("text", value, logFloat(x, 2), logFixed(centi, 2),
+// ...) format one
+// line into the sketch's SerialLog, named serialLog, instead of writing to
+// the UART. drain() later hands the UART only as many bytes as its
+// interrupt-driven transmit buffer can take, so logging never waits for the
+// wire. A line that does not fit is dropped whole and counted. The Uno
+// passes its text as F("...") so the literals stay in flash, not SRAM.
+//
+// Levels above LOG_LEVEL are removed at compile time: their arguments are
+// not evaluated and no code is generated. Define LOG_LEVEL before including
+// this file to change it.
+//
+// One producer and one consumer: a line is written by one task at a time
+// (setup(), then the task or loop() that owns the log), and only the drain
+// side moves tail.
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Part of a line without the newline, e.g. for progress dots
+#define LOG_PART(level, ...) do { if (LOG_LEVEL >= (level)) logMessage(serialLog, __VA_ARGS__); } while (0)
+#define LOG_LINE(level, ...) LOG_PART(level, __VA_ARGS__, '\n')
+
+#define LOG_ERROR(...) LOG_LINE(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_LINE(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_LINE(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_LINE(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// A float printed with a fixed number of decimals, like Serial.print(x, n)
+struct LogFloat {
+    float value;
+    uint8_t decimals;
+};
+
+inline LogFloat logFloat(float value, uint8_t decimals) {
+    LogFloat number = { value, decimals };
+    return number;
+}
+
+// A fixed-point number, scaled / 10^decimals: logFixed(2735, 2) is "27.35".
+// No float code, for the Uno.
+struct LogFixed {
+    long scaled;
+    uint8_t decimals;
+};
+
+inline LogFixed logFixed(long scaled, uint8_t decimals) {
+    LogFixed number = { scaled, decimals };
+    return number;
+}
+
+template<uint16_t N> class SerialLog {
+    static_assert(N >= 16 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    volatile uint16_t dropped;   // Lines refused because the buffer was full
+    bool blocking;               // Write every line out at once (setup, before anything drains)
+
+    SerialLog() : dropped(0), blocking(true), head(0), tail(0), pending(0), overflowed(false) {}
+
+    // --- Producer ---
+
+    void append(char c) {
+        if ((uint16_t)(pending - tail) >= N) {
+            overflowed = true;
+            return;
+        }
+        buffer[pending & (N - 1)] = c;
+        pending++;
+    }
+
+    void append(const char* text) {
+        while (*text) {
+            append(*text++);
+        }
+    }
+
+    // F("...") text, which stays in flash on the Uno
+    void append(const __FlashStringHelper* text) {
+        PGM_P next = reinterpret_cast<PGM_P>(text);
+        for (char c = pgm_read_byte(next); c != '\0'; c = pgm_read_byte(++next)) {
+            append(c);
+        }
+    }
+
+    void append(const String& text) {
+        append(text.c_str());
+    }
+
+    void append(unsigned long value) {
+        char digits[10];
+        uint8_t count = 0;
+        do {
+            digits[count++] = '0' + value % 10;
+            value /= 10;
+        } while (value > 0);
+        while (count > 0) {
+            append(digits[--count]);
+        }
+    }
+
+    void append(long value) {
+        if (value < 0) {
+            append('-');
+            append((unsigned long)-(value + 1) + 1);
+        } else {
+            append((unsigned long)value);
+        }
+    }
+
+    void append(unsigned int value) {
+        append((unsigned long)value);
+    }
+
+    void append(int value) {
+        append((long)value);
+    }
+
+    void append(const LogFloat& number) {
+        unsigned long scale = 1;
+        for (uint8_t i = 0; i < number.decimals; i++) {
+            scale *= 10;
+        }
+        float scaled = number.value * scale;
+        if (scaled != scaled) {
+            append("nan");
+            return;
+        }
+        if (scaled > 2.0e9f || scaled < -2.0e9f) {
+            append("ovf");
+            return;
+        }
+
+        append(logFixed((long)(scaled + (scaled < 0 ? -0.5f : 0.5f)), number.decimals));
+    }
+
+    void append(const LogFixed& number) {
+        unsigned long scale = 1;
+        for (uint8_t i = 0; i < number.decimals; i++) {
+            scale *= 10;
+        }
+        unsigned long magnitude = number.scaled < 0 ? 0UL - (unsigned long)number.scaled : (unsigned long)number.scaled;
+        if (number.scaled < 0) {
+            append('-');
+        }
+        append(magnitude / scale);
+        if (number.decimals > 0) {
+            append('.');
+            unsigned long fraction = magnitude % scale;
+            for (unsigned long digit = scale / 10; digit > fraction && digit > 1; digit /= 10) {
+                append('0');
+            }
+            append(fraction);
+        }
+    }
+
+    // Publishes the line appended since the last commit, or drops it whole
+    void commit() {
+        if (overflowed) {
+            dropped = dropped + 1;
+            pending = head;
+            overflowed = false;
+            return;
+        }
+        SPSC_BARRIER();
+        head = pending;
+        if (blocking) {
+            flush();
+        }
+    }
+
+    // --- Consumer ---
+
+    // Writes what the UART can take without waiting; returns true if all
+    // published lines have gone out
+    bool drain() {
+        return write(false);
+    }
+
+    // Writes everything, waiting for the UART as needed
+    void flush() {
+        write(true);
+    }
+
+private:
+    char buffer[N];
+    volatile uint16_t head;      // Published end, written by the producer
+    volatile uint16_t tail;      // Written by the consumer
+    uint16_t pending;            // Producer: end of the line being appended
+    bool overflowed;             // Producer: the line being appended did not fit
+
+    bool write(bool wait) {
+        uint16_t at = tail;
+        uint16_t end = head;
+        SPSC_BARRIER();
+        while (at != end) {
+            uint16_t length = end - at;
+            uint16_t offset = at & (N - 1);
+            if (length > N - offset) {
+                length = N - offset;   // Up to the wrap first
+            }
+            if (!wait) {
+                int room = Serial.availableForWrite();
+                if (room <= 0) {
+                    break;
+                }
+                if (length > (uint16_t)room) {
+                    length = room;
+                }
+            }
+
+            Serial.write((const uint8_t*)buffer + offset, length);
+            at += length;
+            SPSC_BARRIER();
+            tail = at;
+        }
+        return at == end;
+    }
+};
+
+template<class Log> inline void logParts(Log& log) {
+    (void)log;
+}
+
+template<class Log, class Part, class... Rest> inline void logParts(Log& log, const Part& part, const Rest&... rest) {
+    log.append(part);
+    logParts(log, rest...);
+}
+
+// One message, committed as a whole
+template<class Log, class... Parts> void logMessage(Log& log, const Parts&... parts) {
+    logParts(log, parts...);
+    log.commit();
+}
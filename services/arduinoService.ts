@@ -24,11 +24,79 @@ export type ArduinoCommand =
     | { type: 'ALARM_OFF' }
     | { type: 'STATUS' };
 
+// How long to wait before reopening a dropped /EVENTS stream
+const EVENT_STREAM_RETRY_MS = 5000;
+
+// Binary status frame, see status_frame.h in the firmware:
+// [version u8][temp centi-C i16][threshold centi-C i16][flags u8][sequence u32], little-endian
+// Golden frames, also checked against the firmware's encoder by
+// host/tests/test_status_frame.cpp; decodeStatusFrame() must read
+//   01 ab 0a 8c 0a 0d 2a 00 00 80  as 27.31 C, threshold 27, door open, plug on, alarm, sequence 0x8000002a
+//   01 2e fb 60 f0 02 03 02 01 00  as -12.34 C, threshold -40, lamp on, sequence 0x00010203
+const STATUS_FRAME_VERSION = 1;
+const STATUS_FRAME_SIZE = 10;
+const STATUS_FRAME_CONTENT_TYPE = 'application/octet-stream';
+const STATUS_FLAG_DOOR_OPEN = 1 << 0;
+const STATUS_FLAG_LAMP_ON = 1 << 1;
+const STATUS_FLAG_PLUG_ON = 1 << 2;
+const STATUS_FLAG_ALARM = 1 << 3;
+
+// Prefer the binary frame; boards that ignore Accept still send text
+const STATUS_ACCEPT = `${STATUS_FRAME_CONTENT_TYPE}, text/plain;q=0.5`;
+
+export interface StatusFrame {
+    sequence: number;   // Goes up whenever any other field changes
+    status: Partial<ArduinoState>;
+}
+
+// Returns null for a short buffer or an unknown frame version
+export function decodeStatusFrame(buffer: ArrayBuffer): StatusFrame | null {
+    if (buffer.byteLength < STATUS_FRAME_SIZE) return null;
+
+    const view = new DataView(buffer);
+    if (view.getUint8(0) !== STATUS_FRAME_VERSION) return null;
+
+    const flags = view.getUint8(5);
+    return {
+        sequence: view.getUint32(6, true),
+        status: {
+            temperature: view.getInt16(1, true) / 100,
+            alarmThreshold: view.getInt16(3, true) / 100,
+            doorStatus: flags & STATUS_FLAG_DOOR_OPEN ? DoorStatus.OPEN : DoorStatus.CLOSED,
+            lampOn: (flags & STATUS_FLAG_LAMP_ON) !== 0,
+            plugOn: (flags & STATUS_FLAG_PLUG_ON) !== 0,
+            buzzerOn: (flags & STATUS_FLAG_ALARM) !== 0,
+        },
+    };
+}
+
+// One line of the ESP32 /HISTORY CSV; a 1 s point has min = avg = max
+export interface HistoryPoint {
+    time: number;   // Board uptime in seconds at the start of the bucket
+    min: number;
+    avg: number;
+    max: number;
+}
+
+// Bucket sizes /HISTORY can serve, in seconds
+export type HistoryResolution = 1 | 60 | 3600;
+
+// One line of the ESP32 /LOG CSV
+export interface JournalEntry {
+    seq: number;
+    boot: number;       // Board boot the event happened in
+    timeMs: number;     // Milliseconds since that boot
+    event: string;      // BOOT, DOOR, ALARM, THRESHOLD or a command name
+    value: string;      // Boot number, OPEN/CLOSED, ON/OFF, degrees C or empty
+}
+
 class ArduinoService {
     private listeners: ((state: ArduinoState) => void)[] = [];
     private arduinoIP: string = '';
     private pollingInterval: number | null = null;
     private isPolling: boolean = false;
+    private eventSource: EventSource | null = null;
+    private streamRetryTimeout: number | null = null;
 
     private state: ArduinoState = {
         lampOn: false,
@@ -40,13 +108,15 @@ class ArduinoService {
         isConnected: false,
     };
 
-    // Set the Arduino IP address and start polling
+    // Set the Arduino IP address, start polling and try the /EVENTS push stream
     public connect(ip: string): void {
         this.arduinoIP = ip;
         this.startPolling();
+        this.openEventStream();
     }
 
     public disconnect(): void {
+        this.closeEventStream();
         this.stopPolling();
         this.updateState({ isConnected: false });
     }
@@ -98,6 +168,53 @@ class ArduinoService {
         }
     }
 
+    // Subscribe to Server-Sent Events (ESP32 firmware only).
+    // Polling stops once the stream is open and resumes if it drops.
+    // Boards without /EVENTS (the Uno) fail the stream and keep polling.
+    private openEventStream(): void {
+        this.closeEventStream();
+        if (!this.arduinoIP || typeof EventSource === 'undefined') return;
+
+        const source = new EventSource(`http://${this.arduinoIP}/EVENTS`);
+        let opened = false;
+
+        source.onopen = () => {
+            opened = true;
+            this.stopPolling();
+            this.updateState({ isConnected: true });
+        };
+
+        // First message is the full status, later ones carry only changed fields
+        source.onmessage = (event: MessageEvent<string>) => {
+            this.parseStatus(event.data);
+            this.updateState({ isConnected: true });
+        };
+
+        source.onerror = () => {
+            this.closeEventStream();
+            if (!opened) return;
+
+            this.startPolling();
+            this.streamRetryTimeout = window.setTimeout(() => {
+                this.streamRetryTimeout = null;
+                this.openEventStream();
+            }, EVENT_STREAM_RETRY_MS);
+        };
+
+        this.eventSource = source;
+    }
+
+    private closeEventStream(): void {
+        if (this.streamRetryTimeout) {
+            clearTimeout(this.streamRetryTimeout);
+            this.streamRetryTimeout = null;
+        }
+        if (this.eventSource) {
+            this.eventSource.close();
+            this.eventSource = null;
+        }
+    }
+
     // Fetch current status from Arduino
     private async fetchStatus(): Promise<void> {
         if (!this.arduinoIP || this.isPolling) return;
@@ -110,6 +227,7 @@ class ArduinoService {
 
             const response = await fetch(`http://${this.arduinoIP}/STATUS`, {
                 method: 'GET',
+                headers: { Accept: STATUS_ACCEPT },
                 signal: controller.signal,
             });
 
@@ -119,8 +237,7 @@ class ArduinoService {
                 throw new Error(`HTTP ${response.status}`);
             }
 
-            const data = await response.text();
-            this.parseStatus(data);
+            await this.readStatusResponse(response);
             this.updateState({ isConnected: true });
 
         } catch (error) {
@@ -131,6 +248,18 @@ class ArduinoService {
         }
     }
 
+    // Apply a status reply in whichever format the board chose
+    private async readStatusResponse(response: Response): Promise<void> {
+        const contentType = response.headers.get('Content-Type') || '';
+        if (contentType.startsWith(STATUS_FRAME_CONTENT_TYPE)) {
+            const frame = decodeStatusFrame(await response.arrayBuffer());
+            if (frame) this.updateState(frame.status);
+            return;
+        }
+
+        this.parseStatus(await response.text());
+    }
+
     // Parse Arduino status response
     // Format: "TEMP:XX.XX,DOOR:STATUS,LAMP:STATUS,PLUG:STATUS,ALARM:STATUS,THRESHOLD:XX.X"
     private parseStatus(data: string): void {
@@ -165,13 +294,78 @@ class ArduinoService {
         this.updateState(statusObj);
     }
 
+    // Temperature history recorded on the board (ESP32 firmware only).
+    // from/to are seconds of board uptime, negative values count back from
+    // now. Without res the board picks the finest resolution it keeps for
+    // the span: 1 s up to 10 minutes, 1 min up to a day, otherwise 1 h.
+    public async fetchHistory(from: number = -3600, to?: number, res?: HistoryResolution): Promise<HistoryPoint[] | null> {
+        if (!this.arduinoIP) return null;
+
+        const params = new URLSearchParams({ from: String(Math.trunc(from)) });
+        if (to !== undefined) params.set('to', String(Math.trunc(to)));
+        if (res !== undefined) params.set('res', String(res));
+
+        try {
+            const response = await fetch(`http://${this.arduinoIP}/HISTORY?${params}`);
+            if (!response.ok) {
+                throw new Error(`HTTP ${response.status}`);
+            }
+
+            // Header line first: "time_s,min_c,avg_c,max_c"
+            const lines = (await response.text()).trim().split('\n').slice(1);
+            return lines.map(line => {
+                const [time, min, avg, max] = line.split(',').map(Number);
+                return { time, min, avg, max };
+            });
+
+        } catch (error) {
+            console.error('Arduino history error:', error);
+            return null;
+        }
+    }
+
+    // Door, alarm and command events kept in the board's flash journal
+    // (ESP32 firmware only). Pass the returned next as since to get only
+    // newer events on the following call.
+    public async fetchLog(since: number = 0): Promise<{ entries: JournalEntry[]; next: number } | null> {
+        if (!this.arduinoIP) return null;
+
+        try {
+            const response = await fetch(`http://${this.arduinoIP}/LOG?since=${Math.max(0, Math.trunc(since))}`);
+            if (!response.ok) {
+                throw new Error(`HTTP ${response.status}`);
+            }
+
+            // Header line first: "seq,boot,time_ms,event,value"
+            const lines = (await response.text()).trim().split('\n').slice(1);
+            const entries = lines.map(line => {
+                const [seq, boot, timeMs, event, value = ''] = line.split(',');
+                return { seq: Number(seq), boot: Number(boot), timeMs: Number(timeMs), event, value };
+            });
+            const next = Number(response.headers.get('X-Journal-Next'));
+            return { entries, next: next || since };
+
+        } catch (error) {
+            console.error('Arduino log error:', error);
+            return null;
+        }
+    }
+
     // Send command to Arduino
     public async sendCommand(command: ArduinoCommand): Promise<boolean> {
-        if (!this.arduinoIP) {
-            console.error('No Arduino IP configured');
-            return false;
-        }
+        return this.sendEndpoint(this.commandEndpoint(command));
+    }
 
+    // Send several commands as one /BATCH request (e.g. a scene).
+    // The board applies them in order in one pass, or none of them if any
+    // entry is invalid, and replies with a single status.
+    public async sendBatch(commands: ArduinoCommand[]): Promise<boolean> {
+        if (commands.length === 0) return true;
+        if (commands.length === 1) return this.sendCommand(commands[0]);
+        return this.sendEndpoint(`BATCH:${commands.map(c => this.commandEndpoint(c)).join(',')}`);
+    }
+
+    private commandEndpoint(command: ArduinoCommand): string {
         let endpoint = '';
 
         switch (command.type) {
@@ -204,12 +398,22 @@ class ArduinoService {
                 break;
         }
 
+        return endpoint;
+    }
+
+    private async sendEndpoint(endpoint: string): Promise<boolean> {
+        if (!this.arduinoIP) {
+            console.error('No Arduino IP configured');
+            return false;
+        }
+
         try {
             const controller = new AbortController();
             const timeoutId = setTimeout(() => controller.abort(), 3000);
 
             const response = await fetch(`http://${this.arduinoIP}/${endpoint}`, {
                 method: 'GET',
+                headers: { Accept: STATUS_ACCEPT },
                 signal: controller.signal,
             });
 
@@ -220,8 +424,7 @@ class ArduinoService {
             }
 
             // Parse the response to update local state
-            const data = await response.text();
-            this.parseStatus(data);
+            await this.readStatusResponse(response);
             this.updateState({ isConnected: true });
 
             return true;
@@ -0,0 +1,108 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Single-Producer/Single-Consumer Ring
+// ----------------------------------------------------
+// Included by both firmwares. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// Hands items from exactly one producer (an interrupt handler, or a task)
+// to exactly one consumer (a task or loop()) without locks and without
+// turning interrupts off. Each side only writes its own index, and the
+// indices are 8-bit so every load and store of them is atomic on the Uno as
+// well.
+//
+// The producer publishes an item by storing head with release order, and
+// the consumer frees a slot by storing tail with release order; each side
+// loads the other's index with acquire order. On the ESP32 and the host
+// the indices are std::atomic, so this holds between the two cores (the
+// control task to the web server task) and between host threads. The Uno
+// has one core and no <atomic>: there the indices are volatile and a
+// compiler barrier keeps the item copy on its side of the index update.
+
+#pragma once
+
+#include <stdint.h>
+
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+// Stops the compiler from moving the item copy past the index update
+#define SPSC_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Forced inline so push() stays in IRAM when called from an ESP32 ISR
+#define SPSC_INLINE inline __attribute__((always_inline))
+
+#if defined(__AVR__)
+typedef volatile uint8_t SpscIndex;
+
+SPSC_INLINE uint8_t spscLoadRelaxed(const SpscIndex& index) {
+    return index;
+}
+
+SPSC_INLINE uint8_t spscLoadAcquire(const SpscIndex& index) {
+    uint8_t value = index;
+    SPSC_BARRIER();
+    return value;
+}
+
+SPSC_INLINE void spscStoreRelease(SpscIndex& index, uint8_t value) {
+    SPSC_BARRIER();
+    index = value;
+}
+#else
+typedef std::atomic<uint8_t> SpscIndex;
+
+SPSC_INLINE uint8_t spscLoadRelaxed(const SpscIndex& index) {
+    return index.load(std::memory_order_relaxed);
+}
+
+SPSC_INLINE uint8_t spscLoadAcquire(const SpscIndex& index) {
+    return index.load(std::memory_order_acquire);
+}
+
+SPSC_INLINE void spscStoreRelease(SpscIndex& index, uint8_t value) {
+    index.store(value, std::memory_order_release);
+}
+#endif
+
+template<class T, uint8_t N> struct SpscRing {
+    static_assert(N >= 2 && N <= 128 && (N & (N - 1)) == 0, "N must be a power of two <= 128");
+
+    T items[N];
+    SpscIndex head;      // Written by the producer only
+    SpscIndex tail;      // Written by the consumer only
+    SpscIndex dropped;   // Items refused because the ring was full; producer only
+
+    // Producer side. Returns false (and counts the drop) if the ring is full.
+    SPSC_INLINE bool push(const T& item) {
+        uint8_t at = spscLoadRelaxed(head);
+        if ((uint8_t)(at - spscLoadAcquire(tail)) >= N) {
+            spscStoreRelease(dropped, spscLoadRelaxed(dropped) + 1);
+            return false;
+        }
+        items[at & (N - 1)] = item;
+        spscStoreRelease(head, at + 1);
+        return true;
+    }
+
+    // Consumer side. Returns false if there is nothing to take.
+    SPSC_INLINE bool pop(T& item) {
+        uint8_t at = spscLoadRelaxed(tail);
+        if (at == spscLoadAcquire(head)) {
+            return false;
+        }
+        item = items[at & (N - 1)];
+        spscStoreRelease(tail, at + 1);
+        return true;
+    }
+
+    // Either side: true if the consumer has nothing to take right now
+    SPSC_INLINE bool empty() const {
+        return spscLoadRelaxed(head) == spscLoadRelaxed(tail);
+    }
+
+    // Either side, for reports
+    SPSC_INLINE uint8_t droppedCount() const {
+        return spscLoadRelaxed(dropped);
+    }
+};
@@ -0,0 +1,96 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Binary Status Frame
+// ----------------------------------------------------
+// Included by both firmwares. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// A fixed 10-byte alternative to the "TEMP:..,THRESHOLD:.." text reply,
+// served from /STATUS.bin or whenever the request sends
+// "Accept: application/octet-stream". The text format stays the default.
+//
+//   offset  size  field
+//   0       1     version (STATUS_FRAME_VERSION)
+//   1       2     temperature, centi-degrees C, int16 little-endian
+//   3       2     alarm threshold, centi-degrees C, int16 little-endian
+//   5       1     flags (STATUS_FLAG_*)
+//   6       4     state sequence, uint32 little-endian
+//
+// The sequence goes up by one every time any other field changes, so a
+// client can tell a repeated reply from a new state without comparing it.
+// services/arduinoService.ts holds the matching decoder.
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+
+const uint8_t STATUS_FRAME_VERSION = 1;
+const size_t STATUS_FRAME_SIZE = 10;
+const char STATUS_FRAME_CONTENT_TYPE[] PROGMEM = "application/octet-stream";   // Flash on the Uno
+
+// Bit n is the n-th binary device of the sketch's device table; both tables
+// start DOOR, LAMP, PLUG, ALARM, which the app decodes as:
+enum StatusFrameFlag : uint8_t {
+    STATUS_FLAG_DOOR_OPEN = 1 << 0,
+    STATUS_FLAG_LAMP_ON   = 1 << 1,
+    STATUS_FLAG_PLUG_ON   = 1 << 2,
+    STATUS_FLAG_ALARM     = 1 << 3
+};
+
+struct StatusFrame {
+    int16_t temperatureCenti;
+    int16_t thresholdCenti;
+    uint8_t flags;
+    uint32_t sequence;
+};
+
+// Saturates a centi-degree value into the int16 field
+inline int16_t toStatusCenti(long centi) {
+    return centi > 32767 ? 32767 : centi < -32768 ? -32768 : (int16_t)centi;
+}
+
+// True if everything except the sequence matches
+inline bool sameStatus(const StatusFrame& a, const StatusFrame& b) {
+    return a.temperatureCenti == b.temperatureCenti
+        && a.thresholdCenti == b.thresholdCenti
+        && a.flags == b.flags;
+}
+
+// Returns the bytes written, or 0 if the buffer is too small
+inline size_t encodeStatusFrame(uint8_t* buffer, size_t capacity, const StatusFrame& frame) {
+    if (capacity < STATUS_FRAME_SIZE) {
+        return 0;
+    }
+
+    uint16_t temperature = (uint16_t)frame.temperatureCenti;
+    uint16_t threshold = (uint16_t)frame.thresholdCenti;
+
+    buffer[0] = STATUS_FRAME_VERSION;
+    buffer[1] = temperature & 0xFF;
+    buffer[2] = temperature >> 8;
+    buffer[3] = threshold & 0xFF;
+    buffer[4] = threshold >> 8;
+    buffer[5] = frame.flags;
+    buffer[6] = frame.sequence & 0xFF;
+    buffer[7] = (frame.sequence >> 8) & 0xFF;
+    buffer[8] = (frame.sequence >> 16) & 0xFF;
+    buffer[9] = (frame.sequence >> 24) & 0xFF;
+    return STATUS_FRAME_SIZE;
+}
+
+// Returns false for a short buffer or an unknown version
+inline bool decodeStatusFrame(const uint8_t* buffer, size_t length, StatusFrame& frame) {
+    if (length < STATUS_FRAME_SIZE || buffer[0] != STATUS_FRAME_VERSION) {
+        return false;
+    }
+
+    frame.temperatureCenti = (int16_t)(buffer[1] | (uint16_t)buffer[2] << 8);
+    frame.thresholdCenti = (int16_t)(buffer[3] | (uint16_t)buffer[4] << 8);
+    frame.flags = buffer[5];
+    frame.sequence = (uint32_t)buffer[6]
+                   | (uint32_t)buffer[7] << 8
+                   | (uint32_t)buffer[8] << 16
+                   | (uint32_t)buffer[9] << 24;
+    return true;
+}
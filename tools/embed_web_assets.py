@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------
+# Smart Home Prototype - Web Asset Embedder
+# ----------------------------------------------------
+# Compresses every file in web/ with gzip and writes them into web_assets.h
+# as flash-resident byte arrays, for esp32_main_code.cpp to serve as they
+# are with "Content-Encoding: gzip". The CMake build runs it into its build
+# directory whenever web/ changes. The copy in the sketch folder is
+# committed for the Arduino IDE, which has no build step; refresh it with
+# the update_web_assets target, or by hand:
+#
+#   python3 tools/embed_web_assets.py web web_assets.h
+#
+# index.html is served at "/" and revalidated on every load. The other files
+# are referenced from it with a "?v=<hash>" suffix, added here, so browsers
+# may cache them for a year: a new firmware changes the hash and the URL.
+
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    '.html': 'text/html',
+    '.js': 'application/javascript',
+    '.css': 'text/css',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+    '.png': 'image/png',
+}
+
+INDEX = 'index.html'
+
+
+def digest(data):
+    return hashlib.sha1(data).hexdigest()[:12]
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: embed_web_assets.py <web dir> <output header>')
+    source_dir, output = sys.argv[1], sys.argv[2]
+
+    names = sorted(name for name in os.listdir(source_dir)
+                   if os.path.isfile(os.path.join(source_dir, name)))
+    if INDEX not in names:
+        sys.exit('%s: no %s' % (source_dir, INDEX))
+
+    files = {}
+    for name in names:
+        extension = os.path.splitext(name)[1]
+        if extension not in CONTENT_TYPES:
+            sys.exit('%s: unknown content type' % name)
+        with open(os.path.join(source_dir, name), 'rb') as f:
+            files[name] = f.read()
+
+    # Versioned URLs for everything the page references
+    index = files[INDEX]
+    for name in names:
+        if name != INDEX:
+            versioned = '/%s?v=%s' % (name, digest(files[name]))
+            index = index.replace(('"%s"' % name).encode(), ('"%s"' % versioned).encode())
+    files[INDEX] = index
+
+    out = []
+    out.append('// ----------------------------------------------------')
+    out.append('// Smart Home Prototype - Embedded Web Assets')
+    out.append('// ----------------------------------------------------')
+    out.append('// Generated by tools/embed_web_assets.py from web/. Do not edit; change the')
+    out.append('// files in web/ and build the update_web_assets target (or run the script).')
+    out.append('')
+    out.append('#pragma once')
+    out.append('')
+    out.append('#include <Arduino.h>')
+    out.append('#include <stdint.h>')
+    out.append('#include <stddef.h>')
+    out.append('')
+    out.append('struct WebAsset {')
+    out.append('    const char* path;')
+    out.append('    const char* contentType;')
+    out.append('    const char* etag;')
+    out.append('    bool immutable;         // Referenced by a versioned URL: cache for good')
+    out.append('    const uint8_t* gzip;    // In flash')
+    out.append('    size_t gzipLength;')
+    out.append('    size_t length;          // Uncompressed')
+    out.append('};')
+    out.append('')
+
+    entries = []
+    total = 0
+    for i, name in enumerate(names):
+        data = files[name]
+        compressed = gzip.compress(data, compresslevel=9, mtime=0)
+        total += len(compressed)
+        path = '/' if name == INDEX else '/' + name
+        content_type = CONTENT_TYPES[os.path.splitext(name)[1]]
+        out.append('// %s: %d bytes, %d gzipped' % (name, len(data), len(compressed)))
+        out.append('const uint8_t WEB_ASSET_%d[] PROGMEM = {' % i)
+        out.append(c_array(compressed))
+        out.append('};')
+        out.append('')
+        entries.append('    { "%s", "%s", "\\"%s\\"", %s, WEB_ASSET_%d, %d, %d },'
+                       % (path, content_type, digest(data), 'false' if name == INDEX else 'true',
+                          i, len(compressed), len(data)))
+
+    out.append('const WebAsset WEB_ASSETS[] = {')
+    out.extend(entries)
+    out.append('};')
+    out.append('')
+    out.append('const uint8_t WEB_ASSET_COUNT = %d;' % len(names))
+    out.append('const size_t WEB_ASSETS_GZIP_SIZE = %d;' % total)
+    out.append('')
+
+    with open(output, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
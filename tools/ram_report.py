@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------
+# Smart Home Prototype - Static RAM Report
+# ----------------------------------------------------
+# Prints the static RAM (initialised data plus zeroed data) of a linked
+# firmware and exits with an error if it is over budget, so the build that
+# runs it fails. Reads the section table with `size -A`; pass the
+# toolchain's own size for target binaries.
+#
+#   python3 tools/ram_report.py <elf> <budget bytes> [size tool]
+#
+# CMake runs it on smart_home_host after every link, as a regression guard
+# for the host binary (SMART_HOME_HOST_RAM_BUDGET). The board budgets are
+# checked by the Arduino IDE after each build, with avr-size (Uno) or
+# xtensa-esp32-elf-size (ESP32); see README.md.
+
+import subprocess
+import sys
+
+# Sections that take RAM at run time, across the host, AVR and ESP32
+# linkers. Stack and heap are not included.
+RAM_SECTIONS = (
+    '.data', '.bss', '.noinit', '.tdata', '.tbss', '.sdata', '.sbss',
+    '.dram0.data', '.dram0.bss', '.iram0.text', '.iram0.vectors', '.noinit_dram',
+)
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit('usage: ram_report.py <elf> <budget bytes> [size tool]')
+    elf, budget = sys.argv[1], int(sys.argv[2])
+    size_tool = sys.argv[3] if len(sys.argv) == 4 else 'size'
+
+    table = subprocess.check_output([size_tool, '-A', elf]).decode()
+    sections = []
+    for line in table.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in RAM_SECTIONS and fields[1].isdigit():
+            sections.append((fields[0], int(fields[1])))
+
+    used = sum(size for _, size in sections)
+    detail = ', '.join('%s %d' % section for section in sections)
+    print('[RAM] %s: %d of %d bytes static (%d%%): %s'
+          % (elf, used, budget, 100 * used // budget if budget else 0, detail))
+    if used > budget:
+        sys.exit('[RAM] over budget by %d bytes' % (used - budget))
+
+
+if __name__ == '__main__':
+    main()
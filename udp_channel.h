@@ -0,0 +1,159 @@
+// ----------------------------------------------------
+// Smart Home Prototype - UDP Command Channel
+// ----------------------------------------------------
+// Used by esp32_main_code.cpp. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// Next to HTTP, the ESP32 takes commands as single UDP datagrams on
+// UDP_COMMAND_PORT: no handshake, no headers, one packet each way.
+//
+// Request:
+//   offset  size  field
+//   0       1     version (UDP_PROTOCOL_VERSION)
+//   1       1     type (UdpMessageType)
+//   2       4     sequence, uint32 little-endian
+//   6       n     UDP_COMMAND: the command as in the URL path, without the
+//                 '/', e.g. "LAMP_ON" or "BATCH:LAMP_ON,PLUG_OFF"
+//
+// Reply, sent to the request's source address and port:
+//   0       1     version
+//   1       1     type | UDP_REPLY
+//   2       4     sequence of the request
+//   6       1     result (UdpResult)
+//   7       10    status frame (status_frame.h) after the command
+//   17      n     UDP_DISCOVER only: the device name
+//
+// A client numbers its requests from one socket with an increasing
+// sequence and resends a request, unchanged, when no reply arrives. The
+// device remembers the last sequence and result per client address and
+// port: a resent request gets its first result again without being
+// applied twice (so a resent LAMP_TOGGLE does not toggle back), and a
+// request older than the last one is answered UDP_STALE and dropped.
+// UDP_DISCOVER may be broadcast; the reply's source address is the
+// device's IP.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "status_frame.h"
+
+const uint8_t UDP_PROTOCOL_VERSION = 1;
+const uint16_t UDP_COMMAND_PORT = 4210;
+const size_t UDP_HEADER_SIZE = 6;
+const size_t UDP_REQUEST_SIZE = 128;                                // Longest request accepted
+const size_t UDP_REPLY_HEADER_SIZE = UDP_HEADER_SIZE + 1;
+const size_t UDP_REPLY_SIZE = UDP_REPLY_HEADER_SIZE + STATUS_FRAME_SIZE + 32;  // Room for the device name
+const uint8_t UDP_REPLY = 0x80;
+const uint8_t UDP_CLIENT_SLOTS = 8;   // Clients whose last sequence is remembered
+
+enum UdpMessageType : uint8_t {
+    UDP_DISCOVER = 1,
+    UDP_COMMAND = 2
+};
+
+enum UdpResult : uint8_t {
+    UDP_OK = 0,
+    UDP_STALE,          // Older than the client's last request: not applied
+    UDP_BAD_ARG,        // As HTTP 400
+    UDP_UNKNOWN,        // As HTTP 404
+    UDP_BUSY,           // As HTTP 503: not applied, resend with the same sequence
+    UDP_MALFORMED       // Short request, unknown version or type
+};
+
+struct UdpRequest {
+    uint8_t type;
+    uint32_t sequence;
+    const char* command;   // Points into the datagram
+    size_t commandLength;
+};
+
+// Returns false for a short datagram or an unknown version
+inline bool decodeUdpRequest(const uint8_t* buffer, size_t length, UdpRequest& request) {
+    if (length < UDP_HEADER_SIZE || buffer[0] != UDP_PROTOCOL_VERSION) {
+        return false;
+    }
+
+    request.type = buffer[1];
+    request.sequence = (uint32_t)buffer[2]
+                     | (uint32_t)buffer[3] << 8
+                     | (uint32_t)buffer[4] << 16
+                     | (uint32_t)buffer[5] << 24;
+    request.command = (const char*)buffer + UDP_HEADER_SIZE;
+    request.commandLength = length - UDP_HEADER_SIZE;
+    return true;
+}
+
+// Writes the reply header and status frame; returns the bytes written, or
+// 0 if the buffer is too small
+inline size_t encodeUdpReply(uint8_t* buffer, size_t capacity, uint8_t type, uint32_t sequence, uint8_t result,
+                             const StatusFrame& status) {
+    if (capacity < UDP_REPLY_HEADER_SIZE + STATUS_FRAME_SIZE) {
+        return 0;
+    }
+
+    buffer[0] = UDP_PROTOCOL_VERSION;
+    buffer[1] = type | UDP_REPLY;
+    buffer[2] = sequence & 0xFF;
+    buffer[3] = (sequence >> 8) & 0xFF;
+    buffer[4] = (sequence >> 16) & 0xFF;
+    buffer[5] = (sequence >> 24) & 0xFF;
+    buffer[6] = result;
+    return UDP_REPLY_HEADER_SIZE + encodeStatusFrame(buffer + UDP_REPLY_HEADER_SIZE, capacity - UDP_REPLY_HEADER_SIZE, status);
+}
+
+// --- Duplicate Suppression ---
+
+struct UdpClient {
+    uint32_t address;
+    uint16_t port;
+    bool used;
+    uint8_t lastResult;
+    uint32_t lastSequence;
+    uint32_t lastSeenMs;
+};
+
+enum UdpSequenceCheck : uint8_t {
+    UDP_SEQUENCE_NEW,
+    UDP_SEQUENCE_REPEATED,   // Same as the last one: answer with its result
+    UDP_SEQUENCE_STALE
+};
+
+// Last sequence per client; the least recently seen client gives up its slot
+struct UdpClientTable {
+    UdpClient clients[UDP_CLIENT_SLOTS];
+
+    // Finds or makes the client's slot and classifies sequence against it
+    UdpSequenceCheck check(uint32_t address, uint16_t port, uint32_t sequence, uint32_t nowMs, UdpClient*& client) {
+        UdpClient* oldest = &clients[0];
+        for (uint8_t i = 0; i < UDP_CLIENT_SLOTS; i++) {
+            UdpClient& slot = clients[i];
+            if (slot.used && slot.address == address && slot.port == port) {
+                client = &slot;
+                slot.lastSeenMs = nowMs;
+                int32_t ahead = (int32_t)(sequence - slot.lastSequence);
+                return ahead > 0 ? UDP_SEQUENCE_NEW : ahead == 0 ? UDP_SEQUENCE_REPEATED : UDP_SEQUENCE_STALE;
+            }
+            if (!slot.used || (oldest->used && (int32_t)(slot.lastSeenMs - oldest->lastSeenMs) < 0)) {
+                oldest = &slot;
+            }
+        }
+
+        oldest->used = true;
+        oldest->address = address;
+        oldest->port = port;
+        oldest->lastSequence = sequence - 1;
+        oldest->lastSeenMs = nowMs;
+        client = oldest;
+        return UDP_SEQUENCE_NEW;
+    }
+
+    // Remembers a handled request. Busy replies are not remembered, so
+    // their resend is applied.
+    void record(UdpClient& client, uint32_t sequence, uint8_t result) {
+        if (result != UDP_BUSY) {
+            client.lastSequence = sequence;
+            client.lastResult = result;
+        }
+    }
+};
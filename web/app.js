@@ -0,0 +1,95 @@
+// Live status and commands over the /WS channel. Every message the device
+// pushes is "FIELD:VALUE,..." (the full status on connect, then deltas);
+// command replies are OK, BUSY, BAD_ARG or UNKNOWN.
+(function () {
+  var table = document.getElementById('status');
+  var reply = document.getElementById('reply');
+  var link = document.getElementById('link');
+  var rows = {};
+  var socket = null;
+  var retryMs = 1000;
+
+  document.getElementById('host').textContent = location.host;
+
+  function send(command) {
+    if (socket && socket.readyState === 1) {
+      socket.send(command);
+    }
+  }
+
+  // Binary fields get buttons; a sensor answers UNKNOWN and loses them
+  function row(name, value) {
+    var entry = rows[name];
+    if (entry) {
+      return entry;
+    }
+    var tr = table.insertRow(-1);
+    tr.insertCell(-1).textContent = name;
+    entry = rows[name] = { value: tr.insertCell(-1), buttons: [] };
+    entry.value.className = 'value';
+    if (name !== 'THRESHOLD' && isNaN(parseFloat(value))) {
+      var cell = tr.insertCell(-1);
+      ['ON', 'OFF', 'TOGGLE'].forEach(function (action) {
+        var button = document.createElement('button');
+        button.textContent = action;
+        button.onclick = function () {
+          entry.pending = true;
+          send(name + '_' + action);
+        };
+        entry.buttons.push(button);
+        cell.appendChild(button);
+      });
+    }
+    return entry;
+  }
+
+  function onReply(text) {
+    var name;
+    for (name in rows) {
+      if (rows[name].pending) {
+        rows[name].pending = false;
+        if (text === 'UNKNOWN') {
+          rows[name].buttons.forEach(function (button) { button.disabled = true; });
+        }
+      }
+    }
+    reply.textContent = text === 'OK' || text === 'UNKNOWN' ? '' : text;
+  }
+
+  function onMessage(event) {
+    var text = String(event.data);
+    if (text.indexOf(':') < 0) {
+      onReply(text);
+      return;
+    }
+    text.split(',').forEach(function (field) {
+      var colon = field.indexOf(':');
+      var name = field.substring(0, colon);
+      var value = field.substring(colon + 1);
+      row(name, value).value.textContent = value;
+    });
+  }
+
+  function connect() {
+    socket = new WebSocket('ws://' + location.host + '/WS');
+    socket.onopen = function () {
+      link.textContent = 'Connected to ' + location.host;
+      retryMs = 1000;
+    };
+    socket.onmessage = onMessage;
+    socket.onclose = function () {
+      link.textContent = 'Reconnecting to ' + location.host + '...';
+      setTimeout(connect, retryMs);
+      retryMs = Math.min(retryMs * 2, 30000);
+    };
+  }
+
+  document.getElementById('setThreshold').onclick = function () {
+    var value = parseFloat(document.getElementById('threshold').value);
+    if (!isNaN(value)) {
+      send('SET_THRESHOLD:' + value.toFixed(1));
+    }
+  };
+
+  connect();
+})();
@@ -0,0 +1,185 @@
+// ----------------------------------------------------
+// Smart Home Prototype - Embedded Web Assets
+// ----------------------------------------------------
+// Generated by tools/embed_web_assets.py from web/. Do not edit; change the
+// files in web/ and build the update_web_assets target (or run the script).
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct WebAsset {
+    const char* path;
+    const char* contentType;
+    const char* etag;
+    bool immutable;         // Referenced by a versioned URL: cache for good
+    const uint8_t* gzip;    // In flash
+    size_t gzipLength;
+    size_t length;          // Uncompressed
+};
+
+// app.js: 2836 bytes, 1098 gzipped
+const uint8_t WEB_ASSET_0[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x56, 0x6d, 0x6f, 0xe2, 0x38,
+    0x10, 0xfe, 0xce, 0xaf, 0x98, 0xdd, 0x0f, 0xeb, 0xe4, 0x96, 0x0b, 0xf4, 0xee, 0x1b, 0x5c, 0x75,
+    0xea, 0x0b, 0x74, 0x57, 0x6d, 0x41, 0x82, 0xf6, 0xaa, 0x53, 0x55, 0x55, 0x6e, 0x62, 0x4a, 0xb4,
+    0xc1, 0xae, 0x62, 0x87, 0xb6, 0xda, 0xe5, 0xbf, 0xdf, 0x8c, 0xed, 0x10, 0x13, 0xda, 0x4a, 0x87,
+    0x44, 0x02, 0xf6, 0x78, 0x5e, 0x9e, 0x79, 0x66, 0xc6, 0xbd, 0x1e, 0x5c, 0xe4, 0x6b, 0x01, 0xda,
+    0x70, 0x53, 0x69, 0xe0, 0x32, 0x83, 0x54, 0xad, 0x56, 0xf8, 0xd6, 0xa0, 0xd6, 0xa2, 0x04, 0xb3,
+    0x14, 0xd0, 0xbb, 0x99, 0x43, 0xba, 0xe4, 0x52, 0x8a, 0x22, 0x81, 0x11, 0xae, 0xbe, 0xc2, 0x4a,
+    0x68, 0xcd, 0x1f, 0x85, 0xdd, 0xce, 0xc4, 0x3a, 0x4f, 0x45, 0xa7, 0xd7, 0x83, 0xa7, 0x4a, 0x2f,
+    0x85, 0x86, 0x5c, 0xc3, 0xe7, 0xf1, 0xf7, 0xd1, 0xc5, 0xe9, 0xe0, 0x9f, 0xa3, 0x8b, 0xeb, 0x51,
+    0x37, 0x49, 0x92, 0xcf, 0x10, 0x91, 0xe8, 0xa2, 0x2a, 0x8a, 0xda, 0x96, 0x92, 0x68, 0x0a, 0x75,
+    0xa6, 0xa6, 0x4b, 0x6a, 0x24, 0xea, 0x29, 0x0c, 0xd7, 0xf1, 0x90, 0x34, 0x79, 0x27, 0xa0, 0x14,
+    0x4f, 0x45, 0x8e, 0x2a, 0x79, 0x29, 0x60, 0x7a, 0xde, 0x85, 0xe3, 0xeb, 0xf9, 0xbf, 0xf8, 0x3c,
+    0x3a, 0xbd, 0x3f, 0x9a, 0x9d, 0x81, 0x2a, 0xe1, 0x7a, 0x72, 0x3e, 0x99, 0xde, 0x4c, 0x92, 0x4e,
+    0xb4, 0xa8, 0x64, 0x6a, 0x72, 0xd4, 0x1a, 0xc5, 0xf0, 0xb3, 0x03, 0xb0, 0xe6, 0xe8, 0x3d, 0x7f,
+    0x28, 0x04, 0x1c, 0x42, 0xa6, 0xd2, 0x6a, 0x25, 0xa4, 0x49, 0x1e, 0x85, 0x19, 0x15, 0x82, 0x7e,
+    0x1e, 0xbf, 0x7e, 0xcf, 0x22, 0xe6, 0x7c, 0x61, 0x68, 0xd4, 0x1d, 0x20, 0x7b, 0xaf, 0x1f, 0x1d,
+    0xb0, 0x02, 0x8d, 0x7c, 0x91, 0xcb, 0x1f, 0x1f, 0x89, 0xd3, 0x7e, 0xa0, 0x5d, 0x3d, 0x6b, 0x94,
+    0xfe, 0xb9, 0xa9, 0x17, 0xb4, 0x4a, 0x7f, 0x08, 0x83, 0x4b, 0x12, 0x81, 0x69, 0x7c, 0x30, 0xe5,
+    0xeb, 0x25, 0x09, 0x1e, 0xf4, 0xfb, 0xfd, 0x61, 0x07, 0x97, 0xdf, 0xd5, 0xbf, 0x54, 0xda, 0xb0,
+    0x38, 0x31, 0xe2, 0xc5, 0x9c, 0x28, 0x69, 0x70, 0x1d, 0x8f, 0x15, 0x2a, 0xe5, 0x84, 0x44, 0x42,
+    0xbb, 0xf6, 0xfc, 0x16, 0x1b, 0x2d, 0x64, 0x16, 0x79, 0x70, 0x1d, 0x4c, 0x00, 0xf9, 0x02, 0x22,
+    0xef, 0xc8, 0x97, 0x2f, 0xde, 0xa5, 0xa4, 0x14, 0x3c, 0x7b, 0x9d, 0x23, 0x3a, 0x08, 0xdf, 0x21,
+    0x7a, 0x52, 0x0b, 0x43, 0x2d, 0xb0, 0xa3, 0x69, 0x68, 0xf7, 0x36, 0x1d, 0xfa, 0xe2, 0x03, 0x13,
+    0x78, 0x9c, 0x4b, 0x8e, 0x3c, 0x59, 0xe4, 0xa2, 0x40, 0x2a, 0xa1, 0xdb, 0xf0, 0x50, 0x19, 0xa3,
+    0xa4, 0x1e, 0x02, 0x27, 0x2f, 0x34, 0xe6, 0x8e, 0x4b, 0xfd, 0x2c, 0x4a, 0x5d, 0xe7, 0xd0, 0xb2,
+    0xaf, 0x50, 0x1a, 0xd3, 0x8d, 0x7c, 0x58, 0x85, 0x6e, 0x23, 0x70, 0x91, 0xe4, 0x2b, 0xd1, 0x45,
+    0x80, 0x8a, 0x4a, 0xd4, 0xce, 0x10, 0x5a, 0x18, 0x72, 0x49, 0x19, 0x23, 0x6c, 0x6f, 0x49, 0xe6,
+    0x6e, 0xb8, 0x8d, 0xca, 0xee, 0x35, 0x9e, 0x23, 0xb0, 0x55, 0x29, 0xdd, 0x89, 0xc6, 0x63, 0xcf,
+    0x94, 0x12, 0x75, 0x58, 0xba, 0x24, 0xb9, 0xd4, 0xa2, 0x34, 0x33, 0x34, 0xf9, 0xfb, 0x81, 0x8f,
+    0xcc, 0x94, 0x7e, 0xf5, 0x44, 0x14, 0x05, 0x2d, 0xb7, 0x10, 0x27, 0xbb, 0x4e, 0x72, 0xdf, 0x1d,
+    0x4a, 0xb8, 0x73, 0x7b, 0xb0, 0xaf, 0xa7, 0x5b, 0xc3, 0x32, 0x80, 0xdb, 0x3b, 0xd8, 0x04, 0x3a,
+    0x12, 0x7b, 0x24, 0x49, 0x0b, 0xae, 0xf5, 0x04, 0xf5, 0xa0, 0x1a, 0x66, 0x97, 0x58, 0x13, 0x1f,
+    0xe9, 0x87, 0x4f, 0x98, 0x1e, 0x76, 0xf5, 0x6d, 0x36, 0x9a, 0x7f, 0x9b, 0x5e, 0x9c, 0x32, 0xca,
+    0x61, 0x8e, 0x27, 0x26, 0xd1, 0x13, 0x2f, 0xb5, 0x18, 0x17, 0x8a, 0x9b, 0xc8, 0xa1, 0x16, 0x37,
+    0x50, 0x50, 0xc8, 0x29, 0xfa, 0x40, 0x41, 0xb7, 0x7d, 0x1a, 0x7a, 0x99, 0x5b, 0x36, 0x9d, 0xb0,
+    0x2e, 0xb0, 0xe9, 0x78, 0x4c, 0xaf, 0xab, 0xe9, 0xd9, 0xd9, 0xc5, 0x88, 0xdd, 0x25, 0x0b, 0x55,
+    0x8e, 0x78, 0xba, 0x0c, 0x0a, 0x8e, 0xdb, 0x77, 0xa3, 0xdd, 0xe9, 0x77, 0x91, 0x85, 0xd5, 0x91,
+    0x22, 0xab, 0x8c, 0xf0, 0x04, 0x8e, 0x98, 0x13, 0x60, 0x5b, 0x83, 0xe0, 0x8f, 0xb4, 0xc0, 0x75,
+    0xda, 0xf7, 0x84, 0x94, 0x4c, 0x8b, 0x3c, 0xa5, 0xea, 0x6b, 0x57, 0x7e, 0xfd, 0x71, 0x38, 0x3e,
+    0x21, 0x51, 0x73, 0xf9, 0x68, 0x23, 0xad, 0xc4, 0x30, 0xd8, 0xb7, 0x14, 0xb6, 0x18, 0x7e, 0x05,
+    0x76, 0xcf, 0xf0, 0xe9, 0x03, 0x69, 0x84, 0x36, 0xcd, 0x4f, 0xa7, 0xcd, 0xa7, 0x2b, 0xa1, 0x56,
+    0x17, 0xb9, 0x3f, 0x81, 0x38, 0x41, 0x9a, 0xf0, 0x27, 0x32, 0x79, 0xb2, 0xcc, 0x8b, 0xac, 0x2d,
+    0xb1, 0x89, 0x43, 0xde, 0xb5, 0xf9, 0xb8, 0xd9, 0x29, 0x55, 0x25, 0x67, 0xd4, 0x6b, 0x22, 0x02,
+    0x23, 0x24, 0x7c, 0xc3, 0x35, 0x4c, 0x84, 0xe7, 0x40, 0x6e, 0x4b, 0x44, 0x37, 0xe1, 0x13, 0x3b,
+    0x1a, 0x0a, 0xd6, 0x18, 0x84, 0xf0, 0xec, 0xef, 0x12, 0x92, 0xbc, 0xd0, 0x01, 0x44, 0xa4, 0x85,
+    0xcc, 0xdb, 0x16, 0xc0, 0x7c, 0x99, 0xb2, 0x5d, 0x90, 0x03, 0x3d, 0x35, 0x36, 0xfb, 0x04, 0xf1,
+    0x30, 0x60, 0x21, 0xf8, 0xe4, 0x65, 0xb9, 0xa6, 0x5a, 0xcb, 0xea, 0xac, 0x6c, 0x91, 0x69, 0xd0,
+    0xa9, 0xdf, 0x35, 0x56, 0x88, 0x45, 0x8b, 0x18, 0x8d, 0x6b, 0xd3, 0x73, 0x06, 0xbf, 0x7e, 0xc1,
+    0xbe, 0xaf, 0xf0, 0x37, 0x30, 0x06, 0x03, 0xbb, 0xf3, 0x16, 0xc4, 0x97, 0x6e, 0x8e, 0x45, 0x62,
+    0x8d, 0x2a, 0x43, 0x94, 0x9d, 0x2a, 0x98, 0x9b, 0x12, 0x91, 0x71, 0xdb, 0x49, 0xc6, 0x0d, 0x8f,
+    0x9b, 0xea, 0x23, 0x11, 0x2c, 0x9d, 0x4c, 0xbc, 0x4c, 0x17, 0x11, 0x1b, 0x20, 0x2e, 0x7f, 0x41,
+    0xbf, 0x01, 0x67, 0x27, 0x7f, 0xc3, 0x9d, 0x16, 0x14, 0x92, 0xc0, 0x6a, 0xd1, 0x38, 0xe5, 0xb0,
+    0x20, 0xba, 0xd8, 0xca, 0xf7, 0xc1, 0xb3, 0x3d, 0xb4, 0x55, 0xba, 0xaa, 0xb0, 0x95, 0x65, 0xb7,
+    0x76, 0x7c, 0x18, 0x06, 0x52, 0xd2, 0xb5, 0x0d, 0x27, 0xa4, 0xab, 0x07, 0xed, 0x82, 0xe9, 0x77,
+    0xdd, 0xf9, 0x1d, 0x59, 0xdb, 0x21, 0xde, 0x10, 0x76, 0x96, 0xbe, 0x42, 0xd3, 0x16, 0xda, 0xbd,
+    0xd8, 0x37, 0xaa, 0xdd, 0xd4, 0xd8, 0x35, 0x1f, 0x66, 0xbc, 0x0f, 0xbc, 0x1f, 0xfc, 0xdb, 0x7a,
+    0x6d, 0xe6, 0xa0, 0x78, 0x86, 0x1b, 0xf1, 0x30, 0xb7, 0xff, 0x23, 0xf6, 0xac, 0x07, 0xbd, 0x1e,
+    0x15, 0xe6, 0xce, 0x48, 0xa3, 0x72, 0xc5, 0x3b, 0x49, 0x1d, 0xac, 0x1f, 0x48, 0x4a, 0x2a, 0x24,
+    0xf2, 0x3b, 0xed, 0x80, 0xe6, 0x70, 0xcb, 0x45, 0x76, 0xe2, 0x9c, 0x40, 0x12, 0x1a, 0x05, 0x7b,
+    0x46, 0x82, 0x8c, 0xed, 0x4c, 0xe3, 0xa0, 0x2b, 0x6c, 0x0d, 0xd7, 0xb7, 0xa1, 0xc3, 0x86, 0x51,
+    0x2d, 0x89, 0x94, 0xe6, 0xda, 0xff, 0xf0, 0x6d, 0x26, 0x3c, 0x44, 0x54, 0x97, 0x6f, 0xb9, 0x47,
+    0x18, 0xe0, 0xbd, 0x8a, 0xd5, 0x6e, 0x6a, 0x61, 0xae, 0xf2, 0x95, 0x50, 0x95, 0x89, 0xb6, 0xb7,
+    0x2a, 0xef, 0x7a, 0xbc, 0x1f, 0xca, 0x25, 0x37, 0xcb, 0x64, 0x95, 0xcb, 0xa8, 0x5e, 0xfa, 0x0d,
+    0xfe, 0xe8, 0xc2, 0x9f, 0x18, 0x60, 0x3f, 0x0e, 0x42, 0xdc, 0x7c, 0x78, 0xf7, 0x20, 0x93, 0xcb,
+    0x52, 0xe8, 0xa5, 0x2a, 0x32, 0x24, 0xee, 0x47, 0xfd, 0x38, 0x64, 0x58, 0x30, 0x96, 0xde, 0x55,
+    0x6d, 0x02, 0xbd, 0x8e, 0x65, 0x4d, 0xd9, 0x7d, 0x72, 0xd3, 0xcd, 0x8f, 0xb4, 0xe6, 0x5a, 0x42,
+    0xcd, 0x9c, 0xcd, 0x47, 0x57, 0xf7, 0xdb, 0x59, 0x38, 0x20, 0xd4, 0x3c, 0x3b, 0xd5, 0x38, 0x7f,
+    0x11, 0x59, 0x74, 0x10, 0x87, 0x77, 0x15, 0x7b, 0x37, 0xda, 0x72, 0x71, 0xd8, 0xd9, 0xc4, 0xf4,
+    0xfc, 0x0f, 0x51, 0xb0, 0xb8, 0x3e, 0x14, 0x0b, 0x00, 0x00,
+};
+
+// index.html: 1539 bytes, 942 gzipped
+const uint8_t WEB_ASSET_1[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x65, 0x54, 0xdb, 0x72, 0xe2, 0x48,
+    0x0c, 0x7d, 0xcf, 0x57, 0x68, 0xfd, 0x90, 0x22, 0x55, 0x80, 0xb9, 0x64, 0x32, 0x5b, 0x80, 0x49,
+    0x31, 0xe0, 0x81, 0x54, 0x01, 0x66, 0xb1, 0x99, 0x64, 0x9e, 0x52, 0x8d, 0x2d, 0x70, 0x6f, 0xec,
+    0x6e, 0x4f, 0x77, 0x1b, 0x96, 0xbf, 0x5f, 0xb5, 0xb9, 0xa4, 0x66, 0xf7, 0x05, 0xb0, 0x24, 0x1f,
+    0x1d, 0x1d, 0x1d, 0x34, 0xf8, 0x63, 0x12, 0x8c, 0xa3, 0x9f, 0x2b, 0x1f, 0x52, 0x93, 0x67, 0xc3,
+    0xbb, 0xc1, 0xf5, 0x0b, 0x59, 0x42, 0x5f, 0x39, 0x1a, 0x06, 0x71, 0xca, 0x94, 0x46, 0xe3, 0x39,
+    0xa5, 0xd9, 0x35, 0xfe, 0x74, 0xae, 0x61, 0xc1, 0x72, 0xf4, 0x9c, 0x03, 0xc7, 0x63, 0x21, 0x95,
+    0x71, 0x20, 0x96, 0xc2, 0xa0, 0xa0, 0xb2, 0x23, 0x4f, 0x4c, 0xea, 0x25, 0x78, 0xe0, 0x31, 0x36,
+    0xaa, 0x87, 0x3a, 0x70, 0xc1, 0x0d, 0x67, 0x59, 0x43, 0xc7, 0x2c, 0x43, 0xaf, 0x6d, 0x41, 0x0c,
+    0x37, 0x19, 0x0e, 0xfd, 0x70, 0xd5, 0xed, 0x40, 0x98, 0x33, 0x65, 0x60, 0x26, 0x73, 0x1c, 0xb8,
+    0xe7, 0xf8, 0xdd, 0x20, 0xe3, 0xe2, 0x03, 0x14, 0x66, 0x9e, 0xa3, 0xcd, 0x29, 0x43, 0x9d, 0x22,
+    0x52, 0x97, 0x54, 0xe1, 0xce, 0x73, 0xdc, 0x2a, 0xd4, 0x8c, 0xb5, 0x7e, 0x3e, 0x78, 0x5f, 0x77,
+    0x5f, 0xbe, 0x7c, 0x65, 0xdd, 0xc7, 0xa7, 0x36, 0x3e, 0x5a, 0x60, 0xf7, 0x42, 0x7e, 0x2b, 0x93,
+    0x93, 0x1d, 0xa5, 0xfd, 0xbf, 0x26, 0x10, 0xa2, 0x3a, 0xa0, 0xa2, 0xca, 0x36, 0x15, 0x14, 0xc0,
+    0x13, 0xcf, 0xb1, 0xed, 0x9c, 0xe1, 0x58, 0x0a, 0x81, 0xb1, 0xe1, 0x62, 0x0f, 0x46, 0xc2, 0x40,
+    0x17, 0x4c, 0x54, 0xd9, 0x54, 0x6a, 0xe3, 0x0c, 0x07, 0xae, 0x0d, 0x0c, 0x9b, 0xcd, 0xe6, 0xc0,
+    0x2d, 0xec, 0x08, 0x6c, 0x9b, 0x61, 0x95, 0xd7, 0x86, 0x99, 0x52, 0xdb, 0x8a, 0x2a, 0x66, 0x51,
+    0x87, 0x77, 0x00, 0x11, 0xd1, 0xd5, 0xa9, 0xcc, 0x12, 0xa8, 0xdd, 0x27, 0xb8, 0xef, 0x8f, 0x1f,
+    0x7a, 0x30, 0xe0, 0xa2, 0x28, 0x4d, 0xf5, 0x96, 0xb9, 0xa6, 0x1d, 0x30, 0xa7, 0x82, 0xd4, 0x14,
+    0x65, 0xbe, 0x45, 0xe5, 0x80, 0x36, 0x58, 0x78, 0x4e, 0xab, 0x69, 0x85, 0x02, 0x18, 0x6c, 0x4b,
+    0x63, 0xe4, 0x99, 0x08, 0x2d, 0xe2, 0x06, 0xea, 0x0c, 0x43, 0x34, 0x03, 0xf7, 0x9c, 0xb5, 0x83,
+    0x17, 0xb7, 0x69, 0x14, 0x16, 0xd9, 0xc9, 0xd2, 0xb1, 0xa1, 0xb4, 0x33, 0x9c, 0x45, 0xd1, 0x8a,
+    0xc6, 0xed, 0x54, 0xc4, 0x36, 0x1a, 0xc1, 0x0d, 0xa3, 0x51, 0xb4, 0x09, 0xed, 0x94, 0x7b, 0x34,
+    0x10, 0x97, 0x4a, 0xd1, 0xf2, 0xe0, 0x3c, 0x07, 0xd4, 0x2e, 0xe9, 0xe6, 0x96, 0x0b, 0xd8, 0x49,
+    0x05, 0x26, 0x45, 0x68, 0xb7, 0x1a, 0xdb, 0x93, 0x41, 0xa0, 0x18, 0x53, 0x27, 0xd8, 0x29, 0x32,
+    0xc0, 0x43, 0x1d, 0x28, 0xeb, 0xfa, 0x3f, 0xfc, 0x65, 0x14, 0x56, 0x95, 0x0c, 0x32, 0x7e, 0xb8,
+    0x2a, 0xdc, 0x08, 0x2d, 0xa8, 0x7f, 0xa0, 0x4f, 0x4d, 0xd8, 0x0a, 0x59, 0x7e, 0x61, 0x39, 0x0c,
+    0x04, 0x5a, 0xcb, 0x54, 0x6a, 0xd3, 0x6c, 0x05, 0x2a, 0xd0, 0xa8, 0x35, 0xfd, 0xee, 0xc1, 0x2b,
+    0x6e, 0x43, 0x19, 0x7f, 0x10, 0x2f, 0xf7, 0x95, 0x28, 0xb2, 0x0f, 0xd4, 0x54, 0x9b, 0xe7, 0x4c,
+    0x24, 0x1a, 0x98, 0x06, 0x83, 0xff, 0x98, 0x73, 0x7f, 0x7a, 0x14, 0x09, 0x14, 0x25, 0xb9, 0x43,
+    0x03, 0x52, 0xc7, 0x93, 0xb5, 0xab, 0xd8, 0xe3, 0xb5, 0xcd, 0xf8, 0xf2, 0x5a, 0x0f, 0xdc, 0xfb,
+    0xcc, 0xf4, 0x97, 0xa3, 0x85, 0x7f, 0xbf, 0x37, 0xfd, 0xf7, 0x60, 0x59, 0xff, 0x6f, 0xe4, 0xfb,
+    0xf7, 0x0a, 0xec, 0xf7, 0x68, 0x14, 0x4c, 0xa7, 0x73, 0xbf, 0x9a, 0x0c, 0x59, 0x9c, 0x5a, 0x43,
+    0xb2, 0x53, 0x55, 0x67, 0x25, 0x61, 0x19, 0x53, 0xb7, 0x89, 0x68, 0x19, 0x70, 0xdb, 0x28, 0xf5,
+    0x0b, 0xfd, 0xe8, 0x3d, 0x9a, 0xad, 0xfd, 0x70, 0x16, 0xcc, 0x27, 0xbd, 0xb7, 0xb7, 0xe6, 0xdb,
+    0x67, 0x25, 0x31, 0x65, 0x19, 0x30, 0x03, 0x52, 0xc4, 0x48, 0xb5, 0xdf, 0x46, 0xd1, 0x78, 0xd6,
+    0x9b, 0x8f, 0x16, 0x2b, 0xcb, 0x6c, 0x35, 0xdf, 0x4c, 0x2d, 0x9f, 0xfa, 0xef, 0x10, 0xdd, 0x56,
+    0xb3, 0x75, 0x85, 0xa8, 0x34, 0x85, 0x4c, 0xee, 0xa1, 0x36, 0x0e, 0x7f, 0x90, 0xad, 0xdc, 0x79,
+    0x30, 0x7d, 0xd6, 0x9c, 0xe0, 0xbc, 0xd0, 0xff, 0x0b, 0x6a, 0x89, 0x94, 0xaa, 0x7e, 0x26, 0x58,
+    0xd1, 0xbd, 0xe8, 0x67, 0x45, 0xb2, 0xcb, 0xf8, 0xc0, 0x82, 0x3c, 0x48, 0xcb, 0xcd, 0x98, 0x4e,
+    0x1f, 0xae, 0xa8, 0xa3, 0xd2, 0xc8, 0x9c, 0x55, 0x0b, 0x51, 0x25, 0xfd, 0xe7, 0x7a, 0xb0, 0x0a,
+    0xc2, 0x08, 0xdc, 0xf5, 0x66, 0xee, 0x87, 0x70, 0xe4, 0x26, 0xa5, 0xed, 0x0a, 0x92, 0x3a, 0xe3,
+    0x1f, 0x08, 0xaf, 0x33, 0x7f, 0x09, 0x93, 0x20, 0x58, 0x83, 0xe7, 0x41, 0xb0, 0xa2, 0x87, 0xd1,
+    0x72, 0x02, 0xd1, 0xcb, 0xc2, 0x07, 0xab, 0x9d, 0x07, 0x9d, 0x6e, 0xaf, 0xd5, 0x82, 0xc8, 0x96,
+    0x8d, 0xe6, 0xa3, 0xf5, 0xa2, 0x52, 0xfd, 0x32, 0x24, 0xd4, 0xa6, 0xfe, 0x0d, 0x39, 0xe3, 0x9a,
+    0x38, 0x91, 0xa2, 0xf9, 0x8d, 0x4a, 0x84, 0x39, 0x79, 0x82, 0xdc, 0xa8, 0x10, 0x52, 0x4a, 0x4b,
+    0x5a, 0xed, 0x75, 0xd4, 0xd9, 0x4b, 0x18, 0x05, 0xeb, 0x9f, 0xcf, 0x3b, 0x25, 0x73, 0xaf, 0xd1,
+    0x7d, 0x6a, 0xb5, 0xee, 0x59, 0x5e, 0xf4, 0x49, 0x7a, 0xef, 0xa9, 0x05, 0x35, 0xc3, 0xad, 0x31,
+    0x68, 0x38, 0x8d, 0xe4, 0x30, 0xb2, 0x8c, 0xdc, 0x41, 0x59, 0xd8, 0x68, 0x1d, 0x04, 0xee, 0x69,
+    0x3e, 0x32, 0xa8, 0x07, 0x5b, 0xa4, 0xad, 0x22, 0x08, 0x79, 0xec, 0xd3, 0x5a, 0x35, 0xb4, 0xeb,
+    0x40, 0x6f, 0xd3, 0xa2, 0x2d, 0xe0, 0x8d, 0xc7, 0x5c, 0xca, 0xa2, 0x12, 0x50, 0xe1, 0xaf, 0x12,
+    0x35, 0x69, 0xce, 0xe8, 0xcc, 0xc5, 0x44, 0x66, 0x45, 0xdd, 0x91, 0x38, 0x97, 0xda, 0x72, 0x5a,
+    0xf8, 0xd1, 0xfa, 0x65, 0x1c, 0xd6, 0xe1, 0x98, 0xa2, 0x80, 0x6d, 0xc9, 0x33, 0x73, 0x16, 0xec,
+    0x92, 0x78, 0xf7, 0x97, 0xa3, 0x6f, 0x73, 0x7f, 0xf2, 0x89, 0x7b, 0x6c, 0x5c, 0xa1, 0x3e, 0xbd,
+    0x4d, 0x7d, 0x12, 0xae, 0x63, 0x69, 0x9d, 0xdc, 0x83, 0xcd, 0x64, 0x05, 0xf6, 0xb8, 0xc2, 0x63,
+    0xa7, 0x4d, 0x73, 0x69, 0x44, 0x28, 0x93, 0xe2, 0xdd, 0x3a, 0x5c, 0x60, 0xd6, 0xbc, 0xee, 0x4d,
+    0xc7, 0x8a, 0xd3, 0x36, 0xb5, 0x8a, 0xe9, 0x32, 0xb2, 0xa2, 0x68, 0xfe, 0x6d, 0xcf, 0x62, 0xa7,
+    0xc5, 0x92, 0xc7, 0x2e, 0x6b, 0x63, 0x97, 0x3d, 0x55, 0xa7, 0xab, 0xaa, 0xb2, 0x67, 0xe2, 0x72,
+    0x18, 0xdd, 0xf3, 0xad, 0xff, 0x17, 0x6a, 0x8e, 0xc0, 0x55, 0x03, 0x06, 0x00, 0x00,
+};
+
+// style.css: 359 bytes, 229 gzipped
+const uint8_t WEB_ASSET_2[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x45, 0x90, 0xd1, 0x6e, 0xc3, 0x20,
+    0x0c, 0x45, 0xdf, 0xf7, 0x15, 0x96, 0xfa, 0x0c, 0x22, 0xdd, 0x26, 0x4d, 0xe4, 0x6b, 0x9c, 0x41,
+    0x12, 0x24, 0x82, 0x11, 0x90, 0x75, 0x5d, 0xd5, 0x7f, 0x9f, 0x81, 0x44, 0x7d, 0x41, 0x16, 0x3e,
+    0x5c, 0x1f, 0x33, 0x91, 0xb9, 0xc3, 0x03, 0x66, 0x0a, 0x45, 0xcc, 0xb8, 0x39, 0x7f, 0xd7, 0x90,
+    0x31, 0x64, 0x91, 0x6d, 0x72, 0xf3, 0x08, 0x1b, 0xa6, 0xc5, 0x05, 0x0d, 0x83, 0xdd, 0x00, 0xf7,
+    0x42, 0xf5, 0xe6, 0x57, 0xdc, 0x9c, 0x29, 0xab, 0x86, 0x0f, 0x65, 0xb7, 0x11, 0x22, 0x1a, 0xe3,
+    0xc2, 0xa2, 0x41, 0x55, 0x6a, 0x84, 0xe7, 0x5b, 0xc1, 0xc9, 0x5b, 0x4e, 0x9d, 0x28, 0x19, 0x9b,
+    0xc4, 0x37, 0x79, 0x8f, 0x31, 0x5b, 0x0d, 0x67, 0xd5, 0x20, 0xc3, 0xc4, 0xeb, 0xad, 0x7c, 0xe7,
+    0x09, 0x4a, 0x7e, 0xb5, 0xb3, 0xd5, 0x1d, 0x92, 0x3f, 0xe8, 0x77, 0x7b, 0x2a, 0xde, 0xac, 0x5b,
+    0xd6, 0xa2, 0x39, 0xd9, 0x1b, 0x56, 0x71, 0xe1, 0x54, 0xf9, 0xec, 0x93, 0xa7, 0xbd, 0x14, 0x0a,
+    0x4c, 0x77, 0x6f, 0x91, 0x3a, 0xde, 0x12, 0x5f, 0x7d, 0x6d, 0x5c, 0xae, 0x8a, 0xd5, 0x80, 0xcb,
+    0xe8, 0x91, 0xb7, 0x0e, 0x14, 0x9a, 0xd7, 0x7a, 0x3d, 0x87, 0x65, 0xf7, 0xc7, 0xce, 0x83, 0x6c,
+    0x5b, 0x1d, 0x81, 0x85, 0xa2, 0x86, 0x6b, 0x0f, 0xbb, 0x24, 0x1b, 0x7d, 0xfd, 0x3d, 0x5e, 0x8b,
+    0x92, 0x86, 0x0b, 0x2a, 0xd5, 0xa5, 0xd6, 0x43, 0x73, 0x90, 0x07, 0xfa, 0x0f, 0x32, 0x7c, 0x3b,
+    0x0a, 0x67, 0x01, 0x00, 0x00,
+};
+
+const WebAsset WEB_ASSETS[] = {
+    { "/app.js", "application/javascript", "\"20ad43a1e3a6\"", true, WEB_ASSET_0, 1098, 2836 },
+    { "/", "text/html", "\"48b073132760\"", false, WEB_ASSET_1, 942, 1539 },
+    { "/style.css", "text/css", "\"7f557a3461e4\"", true, WEB_ASSET_2, 229, 359 },
+};
+
+const uint8_t WEB_ASSET_COUNT = 3;
+const size_t WEB_ASSETS_GZIP_SIZE = 2269;
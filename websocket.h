@@ -0,0 +1,209 @@
+// ----------------------------------------------------
+// Smart Home Prototype - WebSocket Framing
+// ----------------------------------------------------
+// Used by esp32_main_code.cpp. When building with the Arduino IDE, keep this
+// file in the sketch folder.
+//
+// The parts of RFC 6455 the /WS endpoint needs: the handshake's
+// Sec-WebSocket-Accept value, and single-frame messages. Server frames are
+// never masked and never longer than 65535 bytes; client frames must be
+// masked and fit the caller's buffer. Fragmented messages are not accepted.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+const size_t WEBSOCKET_KEY_SIZE = 24;           // Base64 of a 16-byte nonce
+const size_t WEBSOCKET_ACCEPT_SIZE = 28;        // Base64 of a SHA-1 digest
+const size_t WEBSOCKET_HEADER_MAX = 4;          // Server frame header, payload up to 65535 bytes
+const size_t WEBSOCKET_CLIENT_HEADER_MAX = 8;   // Masked client frame header, payload up to 65535 bytes
+
+enum WebSocketOpcode : uint8_t {
+    WEBSOCKET_CONTINUATION = 0x0,
+    WEBSOCKET_TEXT = 0x1,
+    WEBSOCKET_BINARY = 0x2,
+    WEBSOCKET_CLOSE = 0x8,
+    WEBSOCKET_PING = 0x9,
+    WEBSOCKET_PONG = 0xA
+};
+
+// Close status codes sent by the device
+const uint16_t WEBSOCKET_CLOSE_NORMAL = 1000;
+const uint16_t WEBSOCKET_CLOSE_PROTOCOL_ERROR = 1002;
+const uint16_t WEBSOCKET_CLOSE_UNSUPPORTED = 1003;   // Binary or fragmented message
+const uint16_t WEBSOCKET_CLOSE_TOO_BIG = 1009;
+
+// --- Handshake ---
+
+inline uint32_t webSocketRotate(uint32_t value, uint8_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 of a message short enough for the handshake (up to 119 bytes)
+inline bool webSocketSha1(const uint8_t* message, size_t length, uint8_t digest[20]) {
+    uint8_t block[128];
+    if (length > sizeof(block) - 9) {
+        return false;
+    }
+    size_t padded = length + 9 <= 64 ? 64 : 128;
+    memset(block, 0, padded);
+    memcpy(block, message, length);
+    block[length] = 0x80;
+    uint64_t bits = (uint64_t)length * 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        block[padded - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    for (size_t chunk = 0; chunk < padded; chunk += 64) {
+        uint32_t w[80];
+        for (uint8_t i = 0; i < 16; i++) {
+            const uint8_t* word = block + chunk + 4 * i;
+            w[i] = (uint32_t)word[0] << 24 | (uint32_t)word[1] << 16 | (uint32_t)word[2] << 8 | word[3];
+        }
+        for (uint8_t i = 16; i < 80; i++) {
+            w[i] = webSocketRotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (uint8_t i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t next = webSocketRotate(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = webSocketRotate(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (uint8_t i = 0; i < 20; i++) {
+        digest[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    return true;
+}
+
+// Writes base64 of data and a NUL; out needs 4 * ((length + 2) / 3) + 1 bytes
+inline void webSocketBase64(const uint8_t* data, size_t length, char* out) {
+    static const char DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (i + 1 < length) group |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) group |= data[i + 2];
+        *out++ = DIGITS[(group >> 18) & 0x3F];
+        *out++ = DIGITS[(group >> 12) & 0x3F];
+        *out++ = i + 1 < length ? DIGITS[(group >> 6) & 0x3F] : '=';
+        *out++ = i + 2 < length ? DIGITS[group & 0x3F] : '=';
+    }
+    *out = '\0';
+}
+
+// Sec-WebSocket-Accept for the client's Sec-WebSocket-Key. Returns false
+// if the key is not the 24 characters a client sends.
+inline bool webSocketAcceptKey(const char* key, char accept[WEBSOCKET_ACCEPT_SIZE + 1]) {
+    static const char GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    if (strlen(key) != WEBSOCKET_KEY_SIZE) {
+        return false;
+    }
+
+    uint8_t message[WEBSOCKET_KEY_SIZE + sizeof(GUID) - 1];
+    memcpy(message, key, WEBSOCKET_KEY_SIZE);
+    memcpy(message + WEBSOCKET_KEY_SIZE, GUID, sizeof(GUID) - 1);
+    uint8_t digest[20];
+    webSocketSha1(message, sizeof(message), digest);
+    webSocketBase64(digest, sizeof(digest), accept);
+    return true;
+}
+
+// --- Frames ---
+
+// Writes the header of an unfragmented server frame; returns its size
+inline size_t encodeWebSocketHeader(uint8_t* header, uint8_t opcode, size_t payloadLength) {
+    header[0] = 0x80 | opcode;   // FIN
+    if (payloadLength < 126) {
+        header[1] = (uint8_t)payloadLength;
+        return 2;
+    }
+    header[1] = 126;
+    header[2] = (uint8_t)(payloadLength >> 8);
+    header[3] = (uint8_t)payloadLength;
+    return 4;
+}
+
+struct WebSocketFrame {
+    uint8_t opcode;
+    bool final;
+    uint8_t* payload;      // Unmasked in place
+    size_t payloadLength;
+};
+
+enum WebSocketDecode : uint8_t {
+    WEBSOCKET_FRAME_OK,
+    WEBSOCKET_FRAME_INCOMPLETE,   // Wait for more bytes
+    WEBSOCKET_FRAME_TOO_BIG,      // Longer than the buffer could ever hold
+    WEBSOCKET_FRAME_INVALID       // Unmasked, reserved bits, or a 64-bit length
+};
+
+// Decodes the client frame at the start of buffer. On WEBSOCKET_FRAME_OK,
+// consumed is the frame's size, header included.
+inline WebSocketDecode decodeWebSocketFrame(uint8_t* buffer, size_t length, size_t capacity,
+                                            WebSocketFrame& frame, size_t& consumed) {
+    if (length < 2) {
+        return WEBSOCKET_FRAME_INCOMPLETE;
+    }
+    if ((buffer[0] & 0x70) != 0 || (buffer[1] & 0x80) == 0) {
+        return WEBSOCKET_FRAME_INVALID;
+    }
+
+    size_t payloadLength = buffer[1] & 0x7F;
+    size_t headerLength = 6;
+    if (payloadLength == 127) {
+        return WEBSOCKET_FRAME_INVALID;
+    }
+    if (payloadLength == 126) {
+        if (length < 4) {
+            return WEBSOCKET_FRAME_INCOMPLETE;
+        }
+        payloadLength = (size_t)buffer[2] << 8 | buffer[3];
+        headerLength = WEBSOCKET_CLIENT_HEADER_MAX;
+    }
+    if (headerLength + payloadLength > capacity) {
+        return WEBSOCKET_FRAME_TOO_BIG;
+    }
+    if (length < headerLength + payloadLength) {
+        return WEBSOCKET_FRAME_INCOMPLETE;
+    }
+
+    const uint8_t* mask = buffer + headerLength - 4;
+    uint8_t* payload = buffer + headerLength;
+    for (size_t i = 0; i < payloadLength; i++) {
+        payload[i] ^= mask[i & 3];
+    }
+
+    frame.opcode = buffer[0] & 0x0F;
+    frame.final = (buffer[0] & 0x80) != 0;
+    frame.payload = payload;
+    frame.payloadLength = payloadLength;
+    consumed = headerLength + payloadLength;
+    return WEBSOCKET_FRAME_OK;
+}